@@ -0,0 +1,199 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+// 风控性能基准测试，按篮子大小、每个代码的挂单深度和帐号数量参数化；
+// 运行: ./bench_risker --benchmark_out=bench_risker.json --benchmark_out_format=json
+// 注意: 集合竞价时段防对敲不检查交叉，须在连续竞价时段运行；找不到broker.yaml时RiskMaster使用默认配置，不读取响应共享内存。
+#include <map>
+#include <benchmark/benchmark.h>
+
+#include "../../risker/risk_master.h"
+#include "../../risker/risk_options.h"
+#include "../../risker/common/anti_self_knock_risker.h"
+#include "../../risker/fancapital/fancapital_risker.h"
+using namespace co;
+
+namespace {
+const char kBenchCode[] = "600000.SH";
+
+std::string BenchFundId(int64_t index) {
+    return "BENCH_" + std::to_string(index);
+}
+
+std::shared_ptr<RiskOptions> CreateRiskOptions(const std::string& fund_id, const std::string& data) {
+    std::shared_ptr<RiskOptions> opt = std::make_shared<RiskOptions>();
+    opt->set_fund_id(fund_id);
+    opt->set_risker_id("fancapital");
+    opt->set_disabled(false);
+    opt->set_data(data);
+    return opt;
+}
+
+// 委托消息缓冲区，篮子中第i笔委托的代码为(600000+i).SH
+class OrderMessageBuffer {
+ public:
+    OrderMessageBuffer(int64_t items_size, const std::string& fund_id, int64_t bs_flag)
+        : buffer_(sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * items_size, 0) {
+        msg_ = reinterpret_cast<MemTradeOrderMessage*>(buffer_.data());
+        strncpy(msg_->fund_id, fund_id.c_str(), sizeof(msg_->fund_id) - 1);
+        msg_->bs_flag = bs_flag;
+        msg_->items_size = items_size;
+        msg_->timestamp = x::RawDateTime();
+        for (int64_t i = 0; i < items_size; ++i) {
+            MemTradeOrder* order = msg_->items + i;
+            snprintf(order->code, sizeof(order->code), "%06ld.SH", 600000 + i);
+            order->price = 10.0;
+            order->volume = 100;
+            order->price_type = kQOrderTypeLimit;
+        }
+    }
+
+    void SetId(int64_t id) {
+        snprintf(msg_->id, sizeof(msg_->id), "BENCH_MSG_%ld", id);
+    }
+
+    MemTradeOrderMessage* msg() {
+        return msg_;
+    }
+
+ private:
+    std::string buffer_;
+    MemTradeOrderMessage* msg_ = nullptr;
+};
+
+// 在kBenchCode上挂depth笔买单，价格从10.00开始逐档降低，轮流属于accounts个帐号
+void AddRestingOrders(AntiSelfKnockRisker* risker, int64_t depth, int64_t accounts) {
+    for (int64_t i = 0; i < depth; ++i) {
+        OrderMessageBuffer buffer(1, BenchFundId(i % accounts), kBsFlagBuy);
+        MemTradeOrderMessage* msg = buffer.msg();
+        buffer.SetId(i);
+        strcpy(msg->items[0].code, kBenchCode);
+        msg->items[0].price = 10.0 - 0.01 * (i % 500);
+        risker->OnTradeOrderReqPass(msg);
+        snprintf(msg->items[0].order_no, sizeof(msg->items[0].order_no), "BENCH_ORDER_%ld", i);
+        risker->HandleTradeOrderRep(msg);
+    }
+}
+
+void AddAccounts(AntiSelfKnockRisker* risker, int64_t accounts) {
+    for (int64_t i = 0; i < accounts; ++i) {
+        risker->AddOption(CreateRiskOptions(BenchFundId(i), "{\"name\":\"bench\"}"));
+    }
+}
+}  // namespace
+
+// 防对敲检查，不交叉：只需比较对手方最优价位，与挂单深度无关
+static void BM_AntiSelfKnockCheckNoCross(benchmark::State& state) {
+    int64_t depth = state.range(0);
+    int64_t accounts = state.range(1);
+    AntiSelfKnockRisker risker;
+    AddAccounts(&risker, accounts);
+    AddRestingOrders(&risker, depth, accounts);
+    OrderMessageBuffer buffer(1, BenchFundId(0), kBsFlagSell);
+    strcpy(buffer.msg()->items[0].code, kBenchCode);
+    buffer.msg()->items[0].price = 10.01;
+    for (auto _ : state) {
+        std::string error = risker.HandleTradeOrderReq(buffer.msg());
+        benchmark::DoNotOptimize(error);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AntiSelfKnockCheckNoCross)->ArgsProduct({{0, 10, 100, 1000}, {1, 10, 100}});
+
+// 防对敲检查，交叉：生成错误信息的开销
+static void BM_AntiSelfKnockCheckCross(benchmark::State& state) {
+    int64_t depth = state.range(0);
+    int64_t accounts = state.range(1);
+    AntiSelfKnockRisker risker;
+    AddAccounts(&risker, accounts);
+    AddRestingOrders(&risker, depth, accounts);
+    OrderMessageBuffer buffer(1, BenchFundId(0), kBsFlagSell);
+    strcpy(buffer.msg()->items[0].code, kBenchCode);
+    buffer.msg()->items[0].price = 9.0;
+    for (auto _ : state) {
+        std::string error = risker.HandleTradeOrderReq(buffer.msg());
+        benchmark::DoNotOptimize(error);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AntiSelfKnockCheckCross)->ArgsProduct({{10, 1000}, {1, 100}});
+
+// 防对敲委托生命周期：委托检查通过、委托响应、全部成交，篮子中每笔委托一个代码
+static void BM_AntiSelfKnockOrderLifecycle(benchmark::State& state) {
+    int64_t basket_size = state.range(0);
+    int64_t depth = state.range(1);
+    AntiSelfKnockRisker risker;
+    AddAccounts(&risker, 1);
+    AddRestingOrders(&risker, depth, 1);
+    OrderMessageBuffer buffer(basket_size, BenchFundId(0), kBsFlagBuy);
+    MemTradeOrderMessage* msg = buffer.msg();
+    MemTradeKnock knock = {};
+    strcpy(knock.fund_id, msg->fund_id);
+    knock.bs_flag = kBsFlagBuy;
+    knock.match_type = kMatchTypeOK;
+    knock.match_volume = 100;
+    knock.match_price = 10.0;
+    int64_t id = 0;
+    for (auto _ : state) {
+        buffer.SetId(++id);
+        for (int64_t i = 0; i < basket_size; ++i) {
+            msg->items[i].order_no[0] = '\0';
+        }
+        risker.OnTradeOrderReqPass(msg);
+        for (int64_t i = 0; i < basket_size; ++i) {
+            snprintf(msg->items[i].order_no, sizeof(msg->items[i].order_no), "LIFE_%ld_%ld", id, i);
+        }
+        risker.HandleTradeOrderRep(msg);
+        for (int64_t i = 0; i < basket_size; ++i) {
+            strcpy(knock.code, msg->items[i].code);
+            strcpy(knock.order_no, msg->items[i].order_no);
+            snprintf(knock.match_no, sizeof(knock.match_no), "M_%ld_%ld", id, i);
+            risker.OnTradeKnock(&knock);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * basket_size);
+}
+BENCHMARK(BM_AntiSelfKnockOrderLifecycle)->ArgsProduct({{1, 10, 100, 500}, {0, 1000}});
+
+// 帐号规则检查，按篮子大小
+static void BM_FancapitalRules(benchmark::State& state) {
+    int64_t basket_size = state.range(0);
+    FancapitalRisker risker;
+    risker.Init(CreateRiskOptions(BenchFundId(0),
+        "{\"name\":\"bench\",\"max_order_volume\":100000,\"max_order_amount\":1000000,\"min_order_price\":1,\"max_order_price\":100}"));
+    OrderMessageBuffer buffer(basket_size, BenchFundId(0), kBsFlagBuy);
+    for (auto _ : state) {
+        std::string error = risker.HandleTradeOrderReq(buffer.msg());
+        benchmark::DoNotOptimize(error);
+    }
+    state.SetItemsProcessed(state.iterations() * basket_size);
+}
+BENCHMARK(BM_FancapitalRules)->RangeMultiplier(10)->Range(1, 1000);
+
+// RiskMaster端到端，包括跨线程队列和所有帐号风控；检查通过的委托留在订单薄中，没有委托响应
+static void BM_RiskMasterHandleTradeOrderReq(benchmark::State& state) {
+    int64_t basket_size = state.range(0);
+    int64_t accounts = state.range(1);
+    static std::map<int64_t, std::shared_ptr<RiskMaster>> masters;  // RiskMaster的线程不能停止，按帐号数量复用
+    auto& risk = masters[accounts];
+    if (!risk) {
+        std::vector<std::shared_ptr<RiskOptions>> opts;
+        for (int64_t i = 0; i < accounts; ++i) {
+            opts.push_back(CreateRiskOptions(BenchFundId(i),
+                "{\"name\":\"bench\",\"enable_prevent_self_knock\":true,\"max_order_volume\":100000}"));
+        }
+        risk = std::make_shared<RiskMaster>();
+        risk->Init(opts);
+        risk->Start();
+    }
+    OrderMessageBuffer buffer(basket_size, BenchFundId(accounts - 1), kBsFlagBuy);
+    int64_t id = 0;
+    for (auto _ : state) {
+        buffer.SetId(++id);
+        std::string error;
+        risk->HandleTradeOrderReq(buffer.msg(), &error);
+        benchmark::DoNotOptimize(error);
+    }
+    state.SetItemsProcessed(state.iterations() * basket_size);
+}
+BENCHMARK(BM_RiskMasterHandleTradeOrderReq)->ArgsProduct({{1, 10, 100, 500}, {1, 100}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,273 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+// 流控容量规划工具：把历史broker_req或按参数生成的报撤单序列，用虚拟时钟回放到FlowControlQueue中，
+// 对比不同th_tps_limit下的排队延迟分位数、超时和打回笔数，以及全天报撤单额度的剩余空间。
+#include <boost/program_options.hpp>
+#include <iomanip>
+#include "x/x.h"
+#include "coral/coral.h"
+#include "../mem_broker/mem_struct.h"
+#include "../mem_broker/flow_control.h"
+
+using namespace co;
+namespace po = boost::program_options;
+
+struct PlanEvent {
+    int64_t timestamp = 0;  // 请求时间，即到达流控队列的虚拟时间
+    int64_t function_id = 0;
+    std::string raw;
+    BrokerMsgHeader header;
+};
+
+struct PlanResult {
+    int64_t th_tps_limit = 0;
+    int64_t requests = 0;  // 请求笔数
+    int64_t sent = 0;  // 放行笔数
+    int64_t timeouts = 0;  // 流控超时笔数
+    int64_t rejects = 0;  // 其他原因打回笔数（如超过全天阈值、篮子超过流控阈值）
+    int64_t total_cmd_size = 0;  // 放行的报撤单指令个数
+    std::vector<int64_t> delays;  // 放行请求的排队延迟（毫秒）
+};
+
+int64_t Percentile(const std::vector<int64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+std::string MarketCode(int64_t market) {
+    if (market == kMarketSZ) {
+        return "000001.SZ";
+    } else if (market == kMarketBJ) {
+        return "430047.BJ";
+    }
+    return "600000.SH";
+}
+
+void LoadReplayEvents(const std::string& mem_dir, const std::string& req_file, const std::string& fund_id,
+                      int64_t market, int64_t date, std::vector<PlanEvent>* events) {
+    x::MMapReader reader;
+    reader.Open(mem_dir, req_file, false);
+    const void* data = nullptr;
+    while (true) {
+        int32_t type = reader.Next(&data);
+        if (type == 0) {
+            break;
+        }
+        PlanEvent event;
+        if (type == kMemTypeTradeOrderReq) {
+            auto req = (const MemTradeOrderMessage*)data;
+            if ((!fund_id.empty() && fund_id != req->fund_id) || req->items_size <= 0) {
+                continue;
+            }
+            FlowControlQueue::ClassifyTradeOrder(req, &event.header);
+            event.raw.assign((const char*)data, sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * req->items_size);
+        } else if (type == kMemTypeTradeWithdrawReq) {
+            auto req = (const MemTradeWithdrawMessage*)data;
+            if (!fund_id.empty() && fund_id != req->fund_id) {
+                continue;
+            }
+            FlowControlQueue::ClassifyTradeWithdraw(req, &event.header);
+            event.raw.assign((const char*)data, sizeof(MemTradeWithdrawMessage));
+        } else {
+            continue;
+        }
+        if (event.header.market != market || (date > 0 && event.header.timestamp / 1000000000LL != date)) {
+            continue;
+        }
+        event.timestamp = event.header.timestamp;
+        event.function_id = type;
+        events->emplace_back(std::move(event));
+    }
+    std::stable_sort(events->begin(), events->end(), [](auto& lhs, auto& rhs) {
+        return lhs.timestamp < rhs.timestamp;
+    });
+}
+
+void GenerateProfileEvents(int64_t market, int64_t start_dt, double rate, int64_t duration_s, int64_t basket_size,
+                           double withdraw_ratio, std::vector<PlanEvent>* events) {
+    // 按固定速率生成请求，每隔1/withdraw_ratio笔插入一笔撤单
+    std::string code = MarketCode(market);
+    int64_t total = (int64_t)(rate * (double)duration_s);
+    double withdraw_acc = 0;
+    for (int64_t i = 0; i < total; ++i) {
+        int64_t timestamp = x::AddRawDateTime(start_dt, (int64_t)((double)i * 1000.0 / rate));
+        std::string id = std::to_string(i + 1);
+        PlanEvent event;
+        event.timestamp = timestamp;
+        withdraw_acc += withdraw_ratio;
+        if (withdraw_acc >= 1.0) {
+            withdraw_acc -= 1.0;
+            MemTradeWithdrawMessage req = {};
+            req.timestamp = timestamp;
+            strncpy(req.id, id.c_str(), sizeof(req.id) - 1);
+            std::string order_no = std::to_string(market) + "-" + id;
+            strncpy(req.order_no, order_no.c_str(), sizeof(req.order_no) - 1);
+            event.function_id = kMemTypeTradeWithdrawReq;
+            event.raw.assign((const char*)&req, sizeof(req));
+            FlowControlQueue::ClassifyTradeWithdraw(&req, &event.header);
+        } else {
+            event.function_id = kMemTypeTradeOrderReq;
+            event.raw.assign(sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * basket_size, '\0');
+            auto req = (MemTradeOrderMessage*)event.raw.data();
+            req->timestamp = timestamp;
+            strncpy(req->id, id.c_str(), sizeof(req->id) - 1);
+            req->bs_flag = i % 2 == 0 ? kBsFlagBuy : kBsFlagSell;
+            req->items_size = basket_size;
+            for (int64_t j = 0; j < basket_size; ++j) {
+                MemTradeOrder* order = req->items + j;
+                strncpy(order->code, code.c_str(), sizeof(order->code) - 1);
+                order->market = market;
+                order->price = 10.0;
+                order->volume = 100;
+            }
+            FlowControlQueue::ClassifyTradeOrder(req, &event.header);
+        }
+        events->emplace_back(std::move(event));
+    }
+}
+
+PlanResult Simulate(const std::vector<PlanEvent>& events, int64_t market, int64_t th_tps_limit,
+                    int64_t th_daily_limit, int64_t timeout_ms, int64_t step_ms) {
+    PlanResult result;
+    result.th_tps_limit = th_tps_limit;
+    result.requests = (int64_t)events.size();
+    if (events.empty()) {
+        return result;
+    }
+    BrokerQueue queue;
+    FlowControlQueue fc(&queue);
+    fc.set_request_timeout_ms(timeout_ms);
+    {
+        auto cfg = std::make_unique<FlowControlConfig>();
+        cfg->set_market(market);
+        cfg->set_th_tps_limit(th_tps_limit);
+        cfg->set_th_daily_limit(th_daily_limit);
+        MemBrokerOptionsPtr opt = std::make_shared<MemBrokerOptions>();
+        opt->set_request_timeout_ms(timeout_ms);
+        opt->mutable_flow_controls()->emplace_back(std::move(cfg));
+        fc.Init(opt);
+    }
+    size_t next = 0;
+    int64_t inflight = 0;
+    int64_t clock = events.front().timestamp;
+    while (next < events.size() || inflight > 0) {
+        while (next < events.size() && events[next].timestamp <= clock) {
+            auto& event = events[next++];
+            queue.Push(nullptr, event.function_id, event.raw, event.header);
+            ++inflight;
+        }
+        while (true) {
+            BrokerMsg* msg = fc.TryPop(clock);
+            if (!msg) {
+                break;
+            }
+            --inflight;
+            int64_t function_id = msg->function_id();
+            auto& raw = msg->data();
+            if (function_id == kMemTypeTradeOrderReq || function_id == kMemTypeTradeWithdrawReq) {
+                ++result.sent;
+                result.delays.emplace_back(x::SubRawDateTime(clock, msg->header().timestamp));
+            } else {
+                const char* error = function_id == kMemTypeTradeOrderRep
+                    ? ((const MemTradeOrderMessage*)raw.data())->error
+                    : ((const MemTradeWithdrawMessage*)raw.data())->error;
+                if (strncmp(error, "[FAN-Broker-TimeoutError]", 25) == 0) {
+                    ++result.timeouts;
+                } else {
+                    ++result.rejects;
+                }
+            }
+            BrokerMsg::Destory(msg);
+        }
+        if (inflight == 0 && next < events.size()) {
+            clock = events[next].timestamp;  // 队列已空，直接跳到下一个请求的到达时间
+        } else {
+            clock = x::AddRawDateTime(clock, step_ms);
+        }
+    }
+    int64_t cmd_size = 0;
+    fc.GetFlowControlQueueSize(&cmd_size, &result.total_cmd_size);
+    std::sort(result.delays.begin(), result.delays.end());
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        po::options_description desc("fc_planner options");
+        desc.add_options()
+            ("help,h", "print help message")
+            ("mode", po::value<std::string>()->default_value("replay"), "replay: 回放broker_req; profile: 按参数生成请求")
+            ("market", po::value<std::string>()->default_value(".SH"), "规划的市场后缀")
+            ("limits", po::value<std::string>()->default_value("300,350,400,450,500"), "候选th_tps_limit，逗号分隔")
+            ("daily_limit", po::value<int64_t>()->default_value(18000), "全天报撤单流控阈值th_daily_limit")
+            ("timeout_ms", po::value<int64_t>()->default_value(5000), "请求超时阈值request_timeout_ms")
+            ("step_ms", po::value<int64_t>()->default_value(1), "虚拟时钟步长（毫秒）")
+            ("mem_dir", po::value<std::string>()->default_value("../data"), "[replay] 共享内存目录")
+            ("req_file", po::value<std::string>()->default_value("broker_req"), "[replay] 请求文件名")
+            ("fund_id", po::value<std::string>()->default_value(""), "[replay] 只回放指定资金账号，默认全部")
+            ("date", po::value<int64_t>()->default_value(0), "[replay] 只回放指定日期（yyyymmdd），默认全部")
+            ("rate", po::value<double>()->default_value(400), "[profile] 每秒请求笔数")
+            ("duration_s", po::value<int64_t>()->default_value(60), "[profile] 持续秒数")
+            ("basket", po::value<int64_t>()->default_value(1), "[profile] 每笔请求的委托个数")
+            ("withdraw_ratio", po::value<double>()->default_value(0.3), "[profile] 撤单占比")
+            ("start", po::value<int64_t>()->default_value(20250618093000000), "[profile] 起始时间");
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        int64_t market = co::SuffixToMarket(vm["market"].as<std::string>());
+        if (market <= 0) {
+            throw std::invalid_argument("illegal market suffix: " + vm["market"].as<std::string>());
+        }
+        std::vector<int64_t> limits;
+        {
+            std::stringstream ss(vm["limits"].as<std::string>());
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                item = x::Trim(item);
+                if (!item.empty()) {
+                    limits.emplace_back(x::ToInt64(item));
+                }
+            }
+        }
+        std::vector<PlanEvent> events;
+        std::string mode = vm["mode"].as<std::string>();
+        if (mode == "replay") {
+            LoadReplayEvents(vm["mem_dir"].as<std::string>(), vm["req_file"].as<std::string>(), vm["fund_id"].as<std::string>(),
+                             market, vm["date"].as<int64_t>(), &events);
+        } else if (mode == "profile") {
+            GenerateProfileEvents(market, vm["start"].as<int64_t>(), vm["rate"].as<double>(), vm["duration_s"].as<int64_t>(),
+                                  vm["basket"].as<int64_t>(), vm["withdraw_ratio"].as<double>(), &events);
+        } else {
+            throw std::invalid_argument("illegal mode: " + mode);
+        }
+        int64_t daily_limit = vm["daily_limit"].as<int64_t>();
+        int64_t timeout_ms = vm["timeout_ms"].as<int64_t>();
+        int64_t step_ms = std::max(vm["step_ms"].as<int64_t>(), (int64_t)1);
+        std::cout << "[" << co::MarketToSuffix(market) << "] requests: " << events.size()
+                  << ", daily_limit: " << daily_limit << ", timeout: " << timeout_ms << "ms" << std::endl;
+        std::cout << std::setw(10) << "tps_limit" << std::setw(10) << "sent" << std::setw(10) << "timeout"
+                  << std::setw(10) << "reject" << std::setw(10) << "p50(ms)" << std::setw(10) << "p90(ms)"
+                  << std::setw(10) << "p99(ms)" << std::setw(10) << "max(ms)" << std::setw(12) << "daily_used"
+                  << std::setw(12) << "headroom" << std::endl;
+        for (auto limit : limits) {
+            auto result = Simulate(events, market, limit, daily_limit, timeout_ms, step_ms);
+            auto& delays = result.delays;
+            std::cout << std::setw(10) << limit << std::setw(10) << result.sent << std::setw(10) << result.timeouts
+                      << std::setw(10) << result.rejects << std::setw(10) << Percentile(delays, 0.5)
+                      << std::setw(10) << Percentile(delays, 0.9) << std::setw(10) << Percentile(delays, 0.99)
+                      << std::setw(10) << (delays.empty() ? 0 : delays.back()) << std::setw(12) << result.total_cmd_size
+                      << std::setw(12) << (daily_limit > 0 ? daily_limit - result.total_cmd_size : -1) << std::endl;
+        }
+    } catch (std::exception& e) {
+        LOG_ERROR << "fc_planner failed: " << e.what();
+        std::cerr << "fc_planner failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
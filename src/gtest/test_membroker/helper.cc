@@ -7,7 +7,7 @@ std::string FCCreateQueryAsset(const std::string& id, const std::string& fund_id
     req->timestamp = timestamp;
     strncpy(req->id, id.c_str(), id.length());
     strncpy(req->fund_id, fund_id.c_str(), fund_id.length());
-    std::string raw = string(static_cast<const char*>(buffer), sizeof(co::MemTradeWithdrawMessage));
+    std::string raw = string(static_cast<const char*>(buffer), sizeof(co::MemGetTradeAssetMessage));
     return raw;
 }
 
@@ -1,4 +1,5 @@
 #include <string>
+#include <filesystem>
 #include <gtest/gtest.h>
 
 #include "../../mem_broker/flow_control.h"
@@ -315,6 +316,494 @@ TEST(FlowControlTPSLimit, Priority) {
     ASSERT_EQ(test_line, ok_line);
 }
 
+TEST(FlowControlTPSLimit, UpdateLimits) {
+    //【测试目的】运行时调低流控阈值后，已排队且超过新阈值的批量委托不能一直阻塞队头
+    //【测试参数】流控阈值：10，运行时改为5，超时阈值：0-无超时
+    //【测试输入】[1-批量买入（8个子委托），2-批量买入（8个子委托）]，1发出后调低阈值，再加入[3-批量买入（5个子委托）]
+    //【测试步骤】按流控窗口依次弹出请求，观察返回结果
+    //【预期输出】[1-通过，none，2-窗口清空后单独通过，none，3-通过]
+    //【测试结果】
+    std::string code = "510300.SH";
+    co::BrokerQueue queue;
+    co::FlowControlQueue fc(&queue);
+    {
+        auto cfg = std::make_unique<co::FlowControlConfig>();
+        cfg->set_market(co::kMarketSH);
+        cfg->set_th_tps_limit(10);
+        co::MemBrokerOptionsPtr opt = std::make_shared<co::MemBrokerOptions>();
+        opt->set_request_timeout_ms(0);
+        opt->mutable_flow_controls()->emplace_back(std::move(cfg));
+        fc.Init(opt);
+    }
+    int64_t now = 20250618093000000;
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateBatchOrder(8, "1", "S1", now, code, co::kBsFlagBuy, 1.0, 100));
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateBatchOrder(8, "2", "S1", now, code, co::kBsFlagBuy, 1.0, 100));
+    std::vector<std::string> test_rows;
+    auto pop = [&](int64_t delay) {
+        co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, delay));
+        if (!msg) {
+            test_rows.emplace_back("none");
+            return;
+        }
+        co::MemTradeOrderMessage *req = (co::MemTradeOrderMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+        test_rows.emplace_back(string(req->id) + (msg->function_id() == co::kMemTypeTradeOrderReq ? "=ok" : "=error"));
+    };
+    pop(0);
+    co::FlowControlLimit limit;
+    limit.market = co::kMarketSH;
+    limit.th_tps_limit = 5;
+    fc.UpdateLimits({limit});
+    pop(0);
+    pop(1550);
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateBatchOrder(5, "3", "S1", now, code, co::kBsFlagBuy, 1.0, 100));
+    pop(1550);
+    pop(3100);
+    std::vector<std::string> ok_rows = {"1=ok", "none", "2=ok", "none", "3=ok"};
+    std::string ok_line = x::ToString(ok_rows);
+    std::string test_line = x::ToString(test_rows);
+    if (ok_line != test_line) {
+        std::cerr << "[  ok] " << ok_line << std::endl;
+        std::cerr << "[test] " << test_line << std::endl;
+    }
+    ASSERT_EQ(test_line, ok_line);
+}
+
+TEST(FlowControlTPSLimit, BasketSplit) {
+    //【测试目的】启用篮子拆分后，超过流控阈值的批量委托拆成子篮子分批发送，子篮子响应合并成原id的响应
+    //【测试参数】流控阈值：10，超时阈值：0-无超时，enable_basket_split: true
+    //【测试输入】[1-批量买入（25个子委托）]，子篮子发出后按乱序返回响应
+    //【测试步骤】按流控窗口依次弹出子篮子，再把子篮子响应放回队列，观察合并结果
+    //【预期输出】[1#0-10笔，1#1-10笔，1#2-5笔，1-合并响应25笔]
+    //【测试结果】
+    std::string code = "510300.SH";
+    co::BrokerQueue queue;
+    co::FlowControlQueue fc(&queue);
+    {
+        auto cfg = std::make_unique<co::FlowControlConfig>();
+        cfg->set_market(co::kMarketSH);
+        cfg->set_th_tps_limit(10);
+        co::MemBrokerOptionsPtr opt = std::make_shared<co::MemBrokerOptions>();
+        opt->set_request_timeout_ms(0);
+        opt->set_enable_basket_split(true);
+        opt->mutable_flow_controls()->emplace_back(std::move(cfg));
+        fc.Init(opt);
+    }
+    int64_t now = 20250618093000000;
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateBatchOrder(25, "1", "S1", now, code, co::kBsFlagBuy, 1.0, 100));
+    std::vector<std::string> test_rows;
+    std::vector<std::string> reps;
+    for (int64_t delay : {0, 0, 1550, 3100}) {
+        co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, delay));
+        if (!msg) {
+            test_rows.emplace_back("none");
+            continue;
+        }
+        std::string raw = msg->data();
+        co::MemTradeOrderMessage *rep = (co::MemTradeOrderMessage *)raw.data();
+        test_rows.emplace_back(string(rep->id) + "=" + std::to_string(rep->items_size));
+        std::string batch_no = "1-" + std::to_string(rep->items_size) + "-" + std::to_string(reps.size());
+        strncpy(rep->batch_no, batch_no.c_str(), batch_no.length());
+        reps.emplace_back(raw);
+    }
+    queue.Push(nullptr, co::kMemTypeTradeOrderRep, reps[2]);
+    queue.Push(nullptr, co::kMemTypeTradeOrderRep, reps[0]);
+    queue.Push(nullptr, co::kMemTypeTradeOrderRep, reps[1]);
+    while (true) {
+        co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, 3200));
+        if (!msg) {
+            break;
+        }
+        co::MemTradeOrderMessage *rep = (co::MemTradeOrderMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+        test_rows.emplace_back(string(rep->id) + "=" + std::to_string(rep->items_size) + "|" + rep->batch_no);
+    }
+    std::vector<std::string> ok_rows = {"1#0=10", "none", "1#1=10", "1#2=5", "1=25|1-10-0,1-10-1,1-5-2"};
+    std::string ok_line = x::ToString(ok_rows);
+    std::string test_line = x::ToString(test_rows);
+    if (ok_line != test_line) {
+        std::cerr << "[  ok] " << ok_line << std::endl;
+        std::cerr << "[test] " << test_line << std::endl;
+    }
+    ASSERT_EQ(test_line, ok_line);
+}
+
+TEST(FlowControlTPSLimit, BasketSplitPartTimeout) {
+    //【测试目的】拆分后的子篮子按排队的流控窗口数顺延超时阈值，后面的子篮子不会因为等待前面的子篮子而超时
+    //【测试参数】流控阈值：10，超时阈值：5000ms，enable_basket_split: true
+    //【测试输入】[1-批量买入（45个子委托）]，拆成5个子篮子，最后一个子篮子在6200ms放行
+    //【测试步骤】按流控窗口依次弹出子篮子，观察是否有超时废单
+    //【预期输出】[1#0-10笔，1#1-10笔，1#2-10笔，1#3-10笔，1#4-5笔]，均无错误
+    //【测试结果】
+    std::string code = "510300.SH";
+    co::BrokerQueue queue;
+    co::FlowControlQueue fc(&queue);
+    fc.set_request_timeout_ms(5000);
+    {
+        auto cfg = std::make_unique<co::FlowControlConfig>();
+        cfg->set_market(co::kMarketSH);
+        cfg->set_th_tps_limit(10);
+        co::MemBrokerOptionsPtr opt = std::make_shared<co::MemBrokerOptions>();
+        opt->set_enable_basket_split(true);
+        opt->mutable_flow_controls()->emplace_back(std::move(cfg));
+        fc.Init(opt);
+    }
+    int64_t now = 20250618093000000;
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateBatchOrder(45, "1", "S1", now, code, co::kBsFlagBuy, 1.0, 100));
+    std::vector<std::string> test_rows;
+    for (int64_t delay : {0, 1550, 3100, 4650, 6200}) {
+        co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, delay));
+        if (!msg) {
+            test_rows.emplace_back("none");
+            continue;
+        }
+        co::MemTradeOrderMessage *rep = (co::MemTradeOrderMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+        test_rows.emplace_back(string(rep->id) + "=" + std::to_string(rep->items_size) + (rep->error[0] ? "|error" : ""));
+    }
+    std::vector<std::string> ok_rows = {"1#0=10", "1#1=10", "1#2=10", "1#3=10", "1#4=5"};
+    std::string ok_line = x::ToString(ok_rows);
+    std::string test_line = x::ToString(test_rows);
+    if (ok_line != test_line) {
+        std::cerr << "[  ok] " << ok_line << std::endl;
+        std::cerr << "[test] " << test_line << std::endl;
+    }
+    ASSERT_EQ(test_line, ok_line);
+}
+
+TEST(FlowControlTPSLimit, BasketSplitExpire) {
+    //【测试目的】子篮子响应丢失时，拆分篮子到期后返回已收到的部分，已发出的子篮子不按废单处理，迟到的响应改为原id返回
+    //【测试参数】流控阈值：10，超时阈值：1000ms，enable_basket_split: true
+    //【测试输入】[1-批量买入（25个子委托）]，只返回1#0和1#2的响应，到期后再返回1#1的响应
+    //【测试步骤】依次弹出子篮子，放回部分响应，在截止时间前后分别弹出消息
+    //【预期输出】截止时间（1000 * 2 + 2 * 1500ms）前无响应，到期后返回原id的15笔委托，都有合同号，迟到的1#1改为原id返回10笔
+    //【测试结果】
+    std::string code = "510300.SH";
+    co::BrokerQueue queue;
+    co::FlowControlQueue fc(&queue);
+    fc.set_request_timeout_ms(1000);
+    {
+        auto cfg = std::make_unique<co::FlowControlConfig>();
+        cfg->set_market(co::kMarketSH);
+        cfg->set_th_tps_limit(10);
+        co::MemBrokerOptionsPtr opt = std::make_shared<co::MemBrokerOptions>();
+        opt->set_enable_basket_split(true);
+        opt->mutable_flow_controls()->emplace_back(std::move(cfg));
+        fc.Init(opt);
+    }
+    int64_t now = 20250618093000000;
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateBatchOrder(25, "1", "S1", now, code, co::kBsFlagBuy, 1.0, 100));
+    std::vector<std::string> test_rows;
+    std::vector<std::string> reps;
+    for (int64_t delay : {0, 1550, 3100}) {
+        co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, delay));
+        ASSERT_TRUE(msg);
+        std::string raw = msg->data();
+        co::MemTradeOrderMessage *rep = (co::MemTradeOrderMessage *)raw.data();
+        ASSERT_EQ(rep->error[0], '\0');
+        std::string batch_no = "1-" + std::to_string(reps.size());
+        strncpy(rep->batch_no, batch_no.c_str(), batch_no.length());
+        for (int64_t i = 0; i < rep->items_size; ++i) {
+            strcpy(rep->items[i].order_no, "1");
+        }
+        reps.emplace_back(raw);
+    }
+    queue.Push(nullptr, co::kMemTypeTradeOrderRep, reps[0]);
+    queue.Push(nullptr, co::kMemTypeTradeOrderRep, reps[2]);
+    for (int64_t delay : {4900, 5000, 5100}) {
+        if (delay == 5100) {
+            queue.Push(nullptr, co::kMemTypeTradeOrderRep, reps[1]);
+        }
+        co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, delay));
+        if (!msg) {
+            test_rows.emplace_back("none");
+            continue;
+        }
+        co::MemTradeOrderMessage *rep = (co::MemTradeOrderMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+        int64_t order_nos = 0;
+        for (int64_t i = 0; i < rep->items_size; ++i) {
+            order_nos += rep->items[i].order_no[0] != '\0' ? 1 : 0;
+        }
+        bool is_timeout = string(rep->error).find("TimeoutError") != std::string::npos;
+        test_rows.emplace_back(string(rep->id) + "=" + std::to_string(rep->items_size) + "|" + std::to_string(order_nos)
+            + "|" + rep->batch_no + (is_timeout ? "|timeout" : ""));
+    }
+    EXPECT_EQ(fc.GetBasketId("1#1"), "1#1");  // 迟到的响应到齐后删除墓碑
+    std::vector<std::string> ok_rows = {"none", "1=15|15|1-0,1-2", "1=10|10|1-1"};
+    std::string ok_line = x::ToString(ok_rows);
+    std::string test_line = x::ToString(test_rows);
+    if (ok_line != test_line) {
+        std::cerr << "[  ok] " << ok_line << std::endl;
+        std::cerr << "[test] " << test_line << std::endl;
+    }
+    ASSERT_EQ(test_line, ok_line);
+}
+
+TEST(FlowControlTPSLimit, BasketSplitCancel) {
+    //【测试目的】拆分篮子到期时还在排队的子篮子作废，按废单返回且不再发出，已发出的子篮子等待迟到的响应
+    //【测试参数】流控阈值：10，超时阈值：0-无超时，enable_basket_split: true
+    //【测试输入】[1-批量买入（25个子委托）]，只弹出1#0，到期后再返回1#0的响应
+    //【测试步骤】截止时间（60000 + 2 * 1500ms）后连续弹出消息，再放回1#0的响应
+    //【预期输出】到期后返回原id的15笔废单，作废的1#1、1#2不再发出，迟到的1#0改为原id返回10笔
+    //【测试结果】
+    std::string code = "510300.SH";
+    co::BrokerQueue queue;
+    co::FlowControlQueue fc(&queue);
+    {
+        auto cfg = std::make_unique<co::FlowControlConfig>();
+        cfg->set_market(co::kMarketSH);
+        cfg->set_th_tps_limit(10);
+        co::MemBrokerOptionsPtr opt = std::make_shared<co::MemBrokerOptions>();
+        opt->set_request_timeout_ms(0);
+        opt->set_enable_basket_split(true);
+        opt->mutable_flow_controls()->emplace_back(std::move(cfg));
+        fc.Init(opt);
+    }
+    int64_t now = 20250618093000000;
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateBatchOrder(25, "1", "S1", now, code, co::kBsFlagBuy, 1.0, 100));
+    co::BrokerMsg* sent = fc.TryPop(now);
+    ASSERT_TRUE(sent);
+    std::string raw = sent->data();
+    co::MemTradeOrderMessage* part = (co::MemTradeOrderMessage*)raw.data();
+    for (int64_t i = 0; i < part->items_size; ++i) {
+        strcpy(part->items[i].order_no, "1");
+    }
+    std::vector<std::string> test_rows;
+    auto pop = [&](int64_t delay) {
+        co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, delay));
+        if (!msg) {
+            test_rows.emplace_back("none");
+            return;
+        }
+        co::MemTradeOrderMessage *rep = (co::MemTradeOrderMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+        int64_t order_nos = 0;
+        for (int64_t i = 0; i < rep->items_size; ++i) {
+            order_nos += rep->items[i].order_no[0] != '\0' ? 1 : 0;
+        }
+        bool is_timeout = string(rep->error).find("TimeoutError") != std::string::npos;
+        test_rows.emplace_back(string(rep->id) + (msg->function_id() == co::kMemTypeTradeOrderReq ? "=req" : "=rep")
+            + std::to_string(rep->items_size) + "|" + std::to_string(order_nos) + (is_timeout ? "|timeout" : ""));
+    };
+    for (int64_t delay : {63000, 63000, 64550, 66100}) {
+        pop(delay);
+    }
+    queue.Push(nullptr, co::kMemTypeTradeOrderRep, raw);
+    pop(66200);
+    pop(66200);
+    std::vector<std::string> ok_rows = {"1=rep15|0|timeout", "none", "none", "none", "1=rep10|10", "none"};
+    std::string ok_line = x::ToString(ok_rows);
+    std::string test_line = x::ToString(test_rows);
+    if (ok_line != test_line) {
+        std::cerr << "[  ok] " << ok_line << std::endl;
+        std::cerr << "[test] " << test_line << std::endl;
+    }
+    ASSERT_EQ(test_line, ok_line);
+}
+
+TEST(FlowControlTPSLimit, PreClassified) {
+    //【测试目的】读线程预先计算的消息头与流控队列内部解析的结果一致，带消息头的请求按消息头分组
+    //【测试参数】流控阈值：3，超时阈值：0-无超时
+    //【测试输入】[1-批量买入（2个子委托），2-批量撤单（2个子委托），3-非标准合同号撤单]
+    //【测试步骤】预先分类后入队，观察消息头和返回结果
+    //【预期输出】[2-通过，1-通过，3-撤单失败]
+    //【测试结果】
+    std::string code = "510300.SH";
+    co::BrokerQueue queue;
+    co::FlowControlQueue fc(&queue);
+    {
+        auto cfg = std::make_unique<co::FlowControlConfig>();
+        cfg->set_market(co::kMarketSH);
+        cfg->set_th_tps_limit(3);
+        co::MemBrokerOptionsPtr opt = std::make_shared<co::MemBrokerOptions>();
+        opt->set_request_timeout_ms(0);
+        opt->mutable_flow_controls()->emplace_back(std::move(cfg));
+        fc.Init(opt);
+    }
+    int64_t now = 20250618093000000;
+    std::string order = FCCreateBatchOrder(2, "1", "S1", now, code, co::kBsFlagBuy, 2.0, 100);
+    co::BrokerMsgHeader order_header;
+    co::FlowControlQueue::ClassifyTradeOrder((co::MemTradeOrderMessage*)order.data(), &order_header);
+    ASSERT_EQ(order_header.market, co::kMarketSH);
+    ASSERT_EQ(order_header.cmd_size, 2);
+    ASSERT_EQ(order_header.priority, co::kFlowControlPriorityOthers);
+    ASSERT_DOUBLE_EQ(order_header.order_amount, 400.0);
+    ASSERT_EQ(order_header.timestamp, now);
+    std::string withdraw = FCCreateBatchWithdraw("2", "S1", now, "1-2-A");
+    co::BrokerMsgHeader withdraw_header;
+    co::FlowControlQueue::ClassifyTradeWithdraw((co::MemTradeWithdrawMessage*)withdraw.data(), &withdraw_header);
+    ASSERT_EQ(withdraw_header.market, co::kMarketSH);
+    ASSERT_EQ(withdraw_header.cmd_size, 2);
+    ASSERT_EQ(withdraw_header.priority, co::kFlowControlPriorityWithdraw);
+    std::string bad_withdraw = FCCreateWithdraw("3", "S1", now, "A");
+    co::BrokerMsgHeader bad_header;
+    co::FlowControlQueue::ClassifyTradeWithdraw((co::MemTradeWithdrawMessage*)bad_withdraw.data(), &bad_header);
+    ASSERT_EQ(bad_header.market, 0);
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, order, order_header);
+    queue.Push(nullptr, co::kMemTypeTradeWithdrawReq, withdraw, withdraw_header);
+    queue.Push(nullptr, co::kMemTypeTradeWithdrawReq, bad_withdraw, bad_header);
+    std::vector<std::string> test_rows;
+    for (int64_t delay : {0, 1550}) {
+        while (true) {
+            co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, delay));
+            if (!msg) {
+                break;
+            }
+            if (msg->function_id() == co::kMemTypeTradeOrderReq) {
+                co::MemTradeOrderMessage *req = (co::MemTradeOrderMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+                test_rows.emplace_back(string(req->id) + "=ok");
+            } else if (msg->function_id() == co::kMemTypeTradeWithdrawReq) {
+                co::MemTradeWithdrawMessage *req = (co::MemTradeWithdrawMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+                test_rows.emplace_back(string(req->id) + "=ok");
+            } else if (msg->function_id() == co::kMemTypeTradeWithdrawRep) {
+                co::MemTradeWithdrawMessage *req = (co::MemTradeWithdrawMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+                test_rows.emplace_back(string(req->id) + "=error");
+            } else {
+                throw std::runtime_error("unknown function_id: " + std::to_string(msg->function_id()));
+            }
+        }
+    }
+    std::vector<std::string> ok_rows = {"2=ok", "3=error", "1=ok"};
+    std::string ok_line = x::ToString(ok_rows);
+    std::string test_line = x::ToString(test_rows);
+    if (ok_line != test_line) {
+        std::cerr << "[  ok] " << ok_line << std::endl;
+        std::cerr << "[test] " << test_line << std::endl;
+    }
+    ASSERT_EQ(test_line, ok_line);
+}
+
+TEST(FlowControlTPSLimit, WeightedSchedule) {
+    //【测试目的】按权重轮转调度，积压的报单不会一直阻塞查询等其他消息，并统计排队等待时长
+    //【测试参数】流控阈值：0-不限制，超时阈值：0-无超时，权重：SH=2，其他消息=1
+    //【测试输入】[1-查询资金，2-查询持仓，3-买入300，4-买入200，5-买入100]
+    //【测试步骤】一次性将请求全部发送，观察返回顺序
+    //【预期输出】[3-买入300，4-买入200，1-查询资金，5-买入100，2-查询持仓]，SH放行3笔
+    //【测试结果】
+    std::string code = "510300.SH";
+    co::BrokerQueue queue;
+    co::FlowControlQueue fc(&queue);
+    {
+        auto cfg = std::make_unique<co::FlowControlConfig>();
+        cfg->set_market(co::kMarketSH);
+        cfg->set_th_tps_limit(0);
+        cfg->set_weight(2);
+        co::MemBrokerOptionsPtr opt = std::make_shared<co::MemBrokerOptions>();
+        opt->set_request_timeout_ms(0);
+        opt->set_flow_control_normal_weight(1);
+        opt->mutable_flow_controls()->emplace_back(std::move(cfg));
+        fc.Init(opt);
+    }
+    ASSERT_TRUE(fc.enable_weighted_schedule());
+    int64_t now = 20240730093000000;
+    queue.Push(nullptr, co::kMemTypeQueryTradeAssetReq, FCCreateQueryAsset("1", "S1", now));
+    queue.Push(nullptr, co::kMemTypeQueryTradePositionReq, FCCreateQueryPosition("2", "S1", now));
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateOrder("3", "S1", now, code, co::kBsFlagBuy, 1.0, 300));
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateOrder("4", "S1", now, code, co::kBsFlagBuy, 1.0, 200));
+    queue.Push(nullptr, co::kMemTypeTradeOrderReq, FCCreateOrder("5", "S1", now, code, co::kBsFlagBuy, 1.0, 100));
+    std::vector<int64_t> test_rows;
+    while (true) {
+        co::BrokerMsg* msg = fc.TryPop(x::AddRawDateTime(now, 10));
+        if (!msg) {
+            break;
+        }
+        if (msg->function_id() == co::kMemTypeTradeOrderReq) {
+            co::MemTradeOrderMessage *req = (co::MemTradeOrderMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+            test_rows.emplace_back(x::ToInt64(req->id));
+        } else if (msg->function_id() == co::kMemTypeQueryTradeAssetReq) {
+            co::MemGetTradeAssetMessage *req = (co::MemGetTradeAssetMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+            test_rows.emplace_back(x::ToInt64(req->id));
+        } else if (msg->function_id() == co::kMemTypeQueryTradePositionReq) {
+            co::MemGetTradePositionMessage *req = (co::MemGetTradePositionMessage *)(reinterpret_cast<const void*>(msg->data().data()));
+            test_rows.emplace_back(x::ToInt64(req->id));
+        } else {
+            throw std::runtime_error("unknown function_id: " + std::to_string(msg->function_id()));
+        }
+    }
+    std::vector<int64_t> ok_rows = {3, 4, 1, 5, 2};
+    std::string ok_line = x::ToString(ok_rows);
+    std::string test_line = x::ToString(test_rows);
+    if (ok_line != test_line) {
+        std::cerr << "[  ok] " << ok_line << std::endl;
+        std::cerr << "[test] " << test_line << std::endl;
+    }
+    ASSERT_EQ(test_line, ok_line);
+    co::FlowControlWaitStats stats;
+    ASSERT_TRUE(fc.GetWaitStats(co::kMarketSH, &stats));
+    ASSERT_EQ(stats.count, 3);
+    ASSERT_EQ(stats.max_ms, 0);
+}
+
+TEST(FlowControlState, SlotStore) {
+    //【测试目的】流控状态按(fund_id, market)占用固定槽位原地更新，重启后恢复当天状态，跨日自动清零
+    //【测试步骤】占用槽位并更新指令个数，重新打开文件后再次占用，再以下一交易日占用
+    //【预期输出】同日恢复为100，其他账号/市场互不影响，跨日清零
+    std::string filename = "../data/test.fc_state/state.slots";
+    std::filesystem::remove(filename);
+    int64_t now = 20250618093000000;
+    {
+        co::FlowControlStateStore store;
+        ASSERT_TRUE(store.Open(filename));
+        auto sh = store.Acquire("S1", co::kMarketSH, now);
+        auto sz = store.Acquire("S1", co::kMarketSZ, now);
+        auto other = store.Acquire("S2", co::kMarketSH, now);
+        ASSERT_NE(sh, sz);
+        ASSERT_NE(sh, other);
+        sh->total_cmd_size = 100;
+        sz->total_cmd_size = 20;
+    }
+    {
+        co::FlowControlStateStore store;
+        ASSERT_FALSE(store.Open(filename));
+        ASSERT_EQ(store.Acquire("S1", co::kMarketSH, x::AddRawDateTime(now, 60000))->total_cmd_size, 100);
+        ASSERT_EQ(store.Acquire("S1", co::kMarketSZ, now)->total_cmd_size, 20);
+        ASSERT_EQ(store.Acquire("S2", co::kMarketSH, now)->total_cmd_size, 0);
+        ASSERT_EQ(store.Acquire("S1", co::kMarketSH, 20250619093000000)->total_cmd_size, 0);
+    }
+    std::filesystem::remove(filename);
+}
+
+TEST(FlowControlState, SlotRefresh) {
+    //【测试目的】跨日运行的broker定期刷新槽位时间，其他broker在新的一天占用槽位时不会复用仍在使用的槽位
+    //【测试步骤】1. broker A占用槽位，跨日后还没有刷新时，broker B在新的一天占用另一个账号的槽位；A关闭后B再占用第三个账号的槽位
+    //          2. broker A占用槽位后跨日刷新，broker B在新的一天占用另一个账号的槽位
+    //【预期输出】1. A未关闭时B占用新的槽位，A关闭后B复用A的过期槽位
+    //          2. B占用新的槽位，A的槽位保持不变
+    std::string filename = "../data/test.fc_state/state.refresh.slots";
+    std::filesystem::remove(filename);
+    int64_t now = 20250618235900000;
+    int64_t next_day = 20250619000100000;
+    {
+        co::FlowControlStateStore a;
+        co::FlowControlStateStore b;
+        a.Open(filename);
+        b.Open(filename);
+        auto state = a.Acquire("S1", co::kMarketSH, now);
+        state->total_cmd_size = 100;
+        auto other = b.Acquire("S2", co::kMarketSH, next_day);
+        ASSERT_NE(other->fund_id, state->fund_id);
+        ASSERT_EQ(other->total_cmd_size, 0);
+        ASSERT_EQ(string(state->fund_id), "S1");  // 未刷新时仍被A的记录锁保护
+        ASSERT_EQ(state->total_cmd_size, 100);
+        a.Close();
+        auto third = b.Acquire("S3", co::kMarketSH, next_day);
+        ASSERT_EQ(string(third->fund_id), "S3");
+        ASSERT_EQ(third->total_cmd_size, 0);
+        ASSERT_EQ(string(other->fund_id), "S2");
+    }
+    std::filesystem::remove(filename);
+    {
+        co::FlowControlStateStore a;
+        co::FlowControlStateStore b;
+        a.Open(filename);
+        b.Open(filename);
+        auto state = a.Acquire("S1", co::kMarketSH, now);
+        state->total_cmd_size = 100;
+        a.Refresh(next_day);
+        auto other = b.Acquire("S2", co::kMarketSH, next_day);
+        ASSERT_EQ(other->total_cmd_size, 0);
+        ASSERT_EQ(string(state->fund_id), "S1");
+        ASSERT_EQ(state->timestamp, next_day);
+    }
+    std::filesystem::remove(filename);
+}
+
 //TEST(FlowControlTPSLimit, Speed) {
 //    //【测试目的】测试流控速度
 //    //【测试参数】流控阈值：2-每秒2笔报撤单，超时阈值：0-无超时
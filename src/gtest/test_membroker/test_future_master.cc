@@ -1,7 +1,9 @@
 #include <string>
+#include <filesystem>
 #include <gtest/gtest.h>
 #include "../../mem_broker/utils.h"
 #include "../../mem_broker/inner_future_master.h"
+#include "../../mem_broker/position_journal.h"
 
 using namespace co;
 
@@ -1196,4 +1198,260 @@ TEST(InnerFutureMaster, TestGetCloseYesterdayFlag) {
         oc_flag = master.GetCloseYesterdayFlag(bs_flag, order);
         EXPECT_EQ(oc_flag, co::kOcFlagOpen);
     }
-}
\ No newline at end of file
+}
+// 持仓表扩容后，之前取得的持仓指针仍然有效
+TEST(InnerFutureMaster, TestPositionTable) {
+    string fund_id = "S1";
+    int total_pos_num = 1000;
+    int length = sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition) * total_pos_num;
+    std::string buffer(length, '\0');
+    MemGetTradePositionMessage* msg = (MemGetTradePositionMessage*) buffer.data();
+    strcpy(msg->fund_id, fund_id.c_str());
+    msg->items_size = total_pos_num;
+    for (int i = 0; i < total_pos_num; i++) {
+        MemTradePosition *pos = msg->items + i;
+        string code = "cu" + std::to_string(2000 + i) + ".SHFE";
+        strcpy(pos->code, code.c_str());
+        pos->long_volume = i + 1;
+        pos->long_pre_volume = i + 1;
+    }
+    InnerFutureMaster master;
+    master.InitPositions(msg);
+    InnerFuturePositionPtr first = master.GetPosition("cu2000.SHFE", co::kBsFlagBuy, co::kOcFlagOpen);
+    for (int i = 0; i < 5000; i++) {
+        master.GetPosition("ag" + std::to_string(2000 + i) + ".SHFE", co::kBsFlagBuy, co::kOcFlagOpen);
+    }
+    EXPECT_EQ(first, master.GetPosition("cu2000.SHFE", co::kBsFlagBuy, co::kOcFlagOpen));
+    EXPECT_EQ(first->yd_init_volume_, 1);
+    for (int i = 0; i < total_pos_num; i++) {
+        string code = "cu" + std::to_string(2000 + i) + ".SHFE";
+        InnerFuturePositionPtr pos = master.GetPosition(code, co::kBsFlagBuy, co::kOcFlagOpen);
+        EXPECT_EQ(pos->yd_init_volume_, i + 1);
+        EXPECT_EQ(pos->marker_, co::kMarketSHFE);
+    }
+}
+
+TEST(InnerFutureMaster, TestPositionJournal) {
+    //【测试目的】内部持仓日志重放后与原内部持仓一致，柜台持仓只用于核对
+    //【测试步骤】初始化持仓并写入快照，平昨委托2手、成交1手并写入日志；新建内部持仓管理重放日志，再核对柜台持仓
+    //【预期输出】重放后平昨冻结1手、已平昨仓1手；柜台总持仓7手时一致，8手时不一致；其他日期没有快照
+    std::string dir = "../data/test.position_journal";
+    std::filesystem::remove_all(dir);
+    string code = "cu2508.SHFE";
+    int length = sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition);
+    std::string buffer(length, '\0');
+    MemGetTradePositionMessage* msg = (MemGetTradePositionMessage*) buffer.data();
+    strcpy(msg->fund_id, "S1");
+    msg->items_size = 1;
+    strcpy(msg->items[0].code, code.c_str());
+    msg->items[0].long_volume = 8;
+    msg->items[0].long_pre_volume = 3;
+
+    InnerFutureMaster master;
+    {
+        PositionJournal journal;
+        journal.Open(dir, "journal");
+        master.InitPositions(msg);
+        journal.AppendSnapshot(msg, kTradeTypeFuture);
+
+        MemTradeOrder order {};
+        strcpy(order.code, code.c_str());
+        order.volume = 2;
+        order.oc_flag = master.GetAutoOcFlag(kBsFlagSell, order);
+        EXPECT_EQ(order.oc_flag, kOcFlagCloseYesterday);
+        master.HandleOrderReq(kBsFlagSell, order);
+        journal.AppendOrderReq(kBsFlagSell, order);
+
+        MemTradeKnock knock {};
+        strcpy(knock.fund_id, "S1");
+        strcpy(knock.code, code.c_str());
+        strcpy(knock.inner_match_no, "FUTURE_1");
+        knock.bs_flag = kBsFlagSell;
+        knock.oc_flag = order.oc_flag;
+        knock.match_type = kMatchTypeOK;
+        knock.match_volume = 1;
+        master.HandleKnock(knock);
+        journal.AppendKnock(knock);
+    }
+
+    InnerFutureMaster restored;
+    PositionJournal journal;
+    bool loaded = journal.Load(dir, "journal", x::RawDate(), [&](int32_t type, const void* data) {
+        if (type == kMemTypeInnerPositionSnapshot) {
+            restored.InitPositions((MemGetTradePositionMessage*)((const InnerJournalSnapshot*)data + 1));
+        } else if (type == kMemTypeInnerOrderReq) {
+            auto item = (const InnerJournalOrder*)data;
+            restored.HandleOrderReq(item->bs_flag, item->order);
+        } else if (type == kMemTypeInnerKnock) {
+            restored.HandleKnock(*(const MemTradeKnock*)data);
+        }
+    });
+    EXPECT_TRUE(loaded);
+    InnerFuturePositionPtr pos = restored.GetPosition(code, kBsFlagSell, kOcFlagCloseYesterday);
+    EXPECT_EQ(pos->yd_closing_volume_, 1);
+    EXPECT_EQ(pos->yd_close_volume_, 1);
+    EXPECT_EQ(pos->ToString(code), master.GetPosition(code, kBsFlagSell, kOcFlagCloseYesterday)->ToString(code));
+
+    msg->items[0].long_volume = 7;
+    msg->items[0].long_pre_volume = 2;
+    EXPECT_EQ(restored.Reconcile(msg), 0);
+    msg->items[0].long_volume = 8;
+    EXPECT_EQ(restored.Reconcile(msg), 1);
+
+    EXPECT_FALSE(journal.Load(dir, "journal", x::RawDate() - 1, [](int32_t, const void*) {}));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(InnerFutureMaster, TestHandleBasketReq) {
+    //【测试目的】篮子委托一次处理的开平标记和冻结结果与逐笔处理一致，股指开仓数超限时撤销已冻结的委托
+    //【测试步骤】1. 两个内部持仓管理初始化相同持仓，分别按篮子和逐笔处理同一代码的2笔卖出和1笔无持仓的卖出
+    //          2. 股指最大开仓数为1，篮子中2笔买开IF
+    //【预期输出】1. 开平标记依次为平昨、平今、开仓，持仓一致
+    //          2. 第2笔失败，撤销第1笔的冻结，返回0；之后单笔开仓1手通过，再开1手失败
+    string code = "cu2508.SHFE";
+    int length = sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition);
+    std::string buffer(length, '\0');
+    MemGetTradePositionMessage* msg = (MemGetTradePositionMessage*) buffer.data();
+    strcpy(msg->fund_id, "S1");
+    msg->items_size = 1;
+    strcpy(msg->items[0].code, code.c_str());
+    msg->items[0].long_volume = 8;
+    msg->items[0].long_pre_volume = 3;
+
+    InnerFutureMaster basket_master;
+    InnerFutureMaster single_master;
+    basket_master.InitPositions(msg);
+    single_master.InitPositions(msg);
+    MemTradeOrder orders[3] = {};
+    strcpy(orders[0].code, code.c_str());
+    strcpy(orders[1].code, code.c_str());
+    strcpy(orders[2].code, "rb2510.SHFE");
+    orders[0].volume = 2;
+    orders[1].volume = 2;
+    orders[2].volume = 1;
+    for (auto& order : orders) {
+        order.oc_flag = kOcFlagAuto;
+        MemTradeOrder single = order;
+        single.oc_flag = single_master.GetAutoOcFlag(kBsFlagSell, single);
+        single_master.HandleOrderReq(kBsFlagSell, single);
+    }
+    std::string error;
+    EXPECT_EQ(basket_master.HandleBasketReq(kBsFlagSell, orders, 3, &error), 3);
+    EXPECT_TRUE(error.empty());
+    EXPECT_EQ(orders[0].oc_flag, kOcFlagCloseYesterday);
+    EXPECT_EQ(orders[1].oc_flag, kOcFlagCloseToday);
+    EXPECT_EQ(orders[2].oc_flag, kOcFlagOpen);
+    for (auto& order : orders) {
+        EXPECT_EQ(basket_master.GetPosition(order.code, kBsFlagSell, order.oc_flag)->ToString(order.code),
+                  single_master.GetPosition(order.code, kBsFlagSell, order.oc_flag)->ToString(order.code));
+    }
+
+    auto service = ConfigService::Instance();
+    auto old_config = service->Get();
+    auto config = std::make_shared<BrokerConfig>(*old_config);
+    config->cffex.forbid_closing_today = true;
+    config->cffex.max_today_opening_volume = 1;
+    service->Publish(config);
+    msg->items_size = 0;
+    InnerFutureMaster cffex_master;
+    cffex_master.InitPositions(msg);
+    MemTradeOrder cffex_orders[2] = {};
+    for (auto& order : cffex_orders) {
+        strcpy(order.code, "IF2509.CFFEX");
+        order.volume = 1;
+        order.oc_flag = kOcFlagOpen;
+    }
+    EXPECT_EQ(cffex_master.HandleBasketReq(kBsFlagBuy, cffex_orders, 2, &error), 0);
+    EXPECT_FALSE(error.empty());
+    // 第1笔的开仓冻结已撤销，单笔开仓仍可通过，之后达到开仓上限
+    error.clear();
+    EXPECT_EQ(cffex_master.HandleBasketReq(kBsFlagBuy, cffex_orders, 1, &error), 1);
+    EXPECT_TRUE(error.empty());
+    EXPECT_EQ(cffex_master.HandleBasketReq(kBsFlagBuy, cffex_orders + 1, 1, &error), 0);
+    EXPECT_FALSE(error.empty());
+    service->Publish(std::make_shared<BrokerConfig>(*old_config));
+}
+
+// 中金所品种的当日开仓统计
+// 1 启动时的今仓计入已开仓数
+// 2 开仓委托增加冻结，成交转为已开仓，撤单释放冻结
+// 3 股指期货使用max_today_opening_volume，国债期货使用product_limits，股指期权不限制
+TEST(InnerFutureMaster, TestCffexProductLimit) {
+    auto service = ConfigService::Instance();
+    auto old_config = service->Get();
+    auto config = std::make_shared<BrokerConfig>(*old_config);
+    config->cffex.forbid_closing_today = true;
+    config->cffex.max_today_opening_volume = 5;
+    config->cffex.product_limits = {{"T", 2}};
+    service->Publish(config);
+
+    int length = sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition);
+    char buffer[length] = "";
+    MemGetTradePositionMessage* msg = (MemGetTradePositionMessage*) buffer;
+    strcpy(msg->fund_id, "S1");
+    msg->items_size = 1;
+    strcpy(msg->items[0].code, "IF2509.CFFEX");
+    msg->items[0].long_volume = 2;
+    InnerFutureMaster master;
+    master.InitPositions(msg);
+    // 新品种追加时统计数组可能重新分配，每次重新查找
+    auto counter = [&]() {
+        return master.GetCffexProduct("IF");
+    };
+    ASSERT_NE(counter(), nullptr);
+    EXPECT_TRUE(counter()->index_future);
+    EXPECT_EQ(counter()->open_volume, 2);
+    EXPECT_EQ(counter()->max_open_volume, 5);
+
+    auto open = [&](const char* code, int64_t volume) {
+        MemTradeOrder order {};
+        strcpy(order.code, code);
+        order.volume = volume;
+        order.oc_flag = master.GetAutoOcFlag(kBsFlagBuy, order);
+        master.HandleOrderReq(kBsFlagBuy, order);
+        return order;
+    };
+    auto knock = [&](const MemTradeOrder& order, int64_t match_type, int64_t volume) {
+        MemTradeKnock knock {};
+        strcpy(knock.fund_id, "S1");
+        strcpy(knock.code, order.code);
+        strcpy(knock.inner_match_no, x::UUID().c_str());
+        knock.match_volume = volume;
+        knock.match_type = match_type;
+        knock.bs_flag = kBsFlagBuy;
+        knock.oc_flag = order.oc_flag;
+        master.HandleKnock(knock);
+    };
+    // 同品种的其他合约共用开仓数
+    MemTradeOrder order = open("IF2512.CFFEX", 3);
+    EXPECT_EQ(order.oc_flag, kOcFlagOpen);
+    EXPECT_EQ(counter()->opening_volume, 3);
+    EXPECT_THROW(open("IF2509.CFFEX", 1), std::runtime_error);
+    knock(order, kMatchTypeOK, 1);
+    EXPECT_EQ(counter()->opening_volume, 2);
+    EXPECT_EQ(counter()->open_volume, 3);
+    knock(order, kMatchTypeWithdrawOK, 2);
+    EXPECT_EQ(counter()->opening_volume, 0);
+    EXPECT_EQ(counter()->total(), 3);
+    open("IH2509.CFFEX", 5);
+    EXPECT_EQ(master.GetCffexProduct("IH")->total(), 5);
+    EXPECT_EQ(counter()->total(), 3);
+
+    open("T2509.CFFEX", 2);
+    EXPECT_THROW(open("T2512.CFFEX", 1), std::runtime_error);
+    EXPECT_FALSE(master.GetCffexProduct("T")->index_future);
+    open("IO2509-C-4000.CFFEX", 100);
+    EXPECT_EQ(master.GetCffexProduct("IO")->opening_volume, 100);
+    EXPECT_EQ(counter()->total(), 3);
+
+    // 配置更新后在下一笔委托生效，重新初始化时清空开仓数
+    config = std::make_shared<BrokerConfig>(*config);
+    config->cffex.product_limits = {{"T", 3}};
+    service->Publish(config);
+    open("T2512.CFFEX", 1);
+    msg->items_size = 0;
+    master.InitPositions(msg);
+    EXPECT_EQ(counter()->total(), 0);
+    EXPECT_EQ(master.GetCffexProduct("T")->total(), 0);
+    service->Publish(std::make_shared<BrokerConfig>(*old_config));
+}
@@ -1,4 +1,7 @@
 #include <string>
+#include <atomic>
+#include <filesystem>
+#include <thread>
 #include <gtest/gtest.h>
 #include "../../mem_broker/utils.h"
 #include "../../mem_broker/inner_option_master.h"
@@ -385,3 +388,148 @@ TEST(InnerOptionMaster, TestBuyClose) {
     }
 }
 
+// 增量核对：只比较有变化的代码，在途委托造成的暂时不一致不报告，连续两次一致的偏差才报告并按柜台修正
+TEST(InnerOptionMaster, TestReconcile) {
+    int length = sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition);
+    std::string buffer(length, '\0');
+    MemGetTradePositionMessage* msg = (MemGetTradePositionMessage*) buffer.data();
+    strcpy(msg->fund_id, "S1");
+    msg->items_size = 1;
+    strcpy(msg->items[0].code, code_0.c_str());
+    msg->items[0].long_can_close = 10;
+    InnerOptionMaster master;
+    master.InitPositions(msg);
+
+    PositionReconciler reconciler;
+    std::vector<HoldingPair> mismatches;
+    auto reconcile = [&](int64_t long_can_close) {
+        msg->items[0].long_can_close = long_can_close;
+        return master.Reconcile(&reconciler, msg, true, [&](const Instrument* instrument, const HoldingPair& inner, const HoldingPair& broker, bool corrected) {
+            EXPECT_EQ(instrument->code, code_0);
+            EXPECT_TRUE(corrected);
+            mismatches.push_back(inner);
+            mismatches.push_back(broker);
+        });
+    };
+    EXPECT_EQ(reconcile(10), 1);
+    EXPECT_EQ(reconcile(10), 0);
+
+    // 卖平3手，柜台下一次查询才扣减可平数量
+    MemTradeOrder order {};
+    strcpy(order.code, code_0.c_str());
+    order.volume = 3;
+    order.oc_flag = kOcFlagClose;
+    master.HandleOrderReq(kBsFlagSell, order);
+    EXPECT_EQ(reconcile(10), 1);
+    EXPECT_EQ(reconcile(7), 1);
+    EXPECT_TRUE(mismatches.empty());
+
+    // 柜台可平数量变为5，连续两次不一致后修正
+    EXPECT_EQ(reconcile(5), 1);
+    EXPECT_TRUE(mismatches.empty());
+    EXPECT_EQ(reconcile(5), 1);
+    ASSERT_EQ(mismatches.size(), 2);
+    EXPECT_EQ(mismatches[0], HoldingPair(7, 0));
+    EXPECT_EQ(mismatches[1], HoldingPair(5, 0));
+    EXPECT_EQ(master.GetPosition(code_0, kBsFlagBuy)->GetAvailableVolume(), 5);
+    EXPECT_EQ(reconcile(5), 0);
+    EXPECT_EQ(master.Reconcile(msg), 0);
+}
+
+// 只读视图：每次更新内部持仓后发布，其它线程和其它进程（映射同一个文件）无锁读取
+// 1 匿名内存，初始化和委托冻结后读到最新持仓
+// 2 共享内存文件，只读打开后按代码查找
+// 3 读取线程与调度线程同时运行，不会读到写了一半的数据
+TEST(InnerOptionMaster, TestPositionView) {
+    int length = sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition);
+    std::string buffer(length, '\0');
+    MemGetTradePositionMessage* msg = (MemGetTradePositionMessage*) buffer.data();
+    strcpy(msg->fund_id, "S1");
+    msg->items_size = 1;
+    strcpy(msg->items[0].code, code_0.c_str());
+    msg->items[0].long_can_close = 10;
+    msg->items[0].short_can_close = 4;
+    InnerOptionMaster master;
+    master.OpenView("");
+    master.InitPositions(msg);
+    const PositionView& view = master.view();
+    EXPECT_STREQ(view.header()->name, "option");
+    EXPECT_STREQ(view.header()->holding_names[0], "long_can_close");
+    PositionViewItem item {};
+    ASSERT_TRUE(view.Find(code_0, &item));
+    EXPECT_EQ(item.holding[0], 10);
+    EXPECT_EQ(item.holding[1], 4);
+    EXPECT_FALSE(view.Find(code_1, &item));
+
+    MemTradeOrder order {};
+    strcpy(order.code, code_0.c_str());
+    order.volume = 3;
+    order.oc_flag = kOcFlagClose;
+    master.HandleOrderReq(kBsFlagSell, order);
+    ASSERT_TRUE(view.Read(0, &item));
+    EXPECT_EQ(item.holding[0], 7);
+    master.HandleOrderRep(kBsFlagSell, order);
+
+    std::string dir = "../data/test.position_view";
+    std::filesystem::remove_all(dir);
+    InnerOptionMaster shared_master;
+    shared_master.InitPositions(msg);
+    shared_master.OpenView(dir + "/position_view_S1_option");
+    PositionView reader;
+    reader.OpenReadOnly(dir + "/position_view_S1_option");
+    ASSERT_TRUE(reader.Find(code_0, &item));
+    EXPECT_EQ(item.holding[0], 10);
+    int64_t generation = reader.generation();
+    shared_master.InitPositions(msg);
+    EXPECT_EQ(reader.generation(), generation + 1);
+    EXPECT_EQ(reader.size(), 1);
+
+    std::atomic<bool> running = true;
+    int64_t reads = 0;
+    int64_t errors = 0;
+    std::thread thread([&]() {
+        PositionViewItem out {};
+        while (running.load()) {
+            if (view.Read(0, &out)) {
+                ++reads;
+                if (code_0 != out.code || (out.holding[0] != 7 && out.holding[0] != 10) || out.holding[1] != 4) {
+                    ++errors;
+                }
+            }
+        }
+    });
+    for (int i = 0; i < 10000; ++i) {
+        master.HandleOrderReq(kBsFlagSell, order);
+        master.HandleOrderRep(kBsFlagSell, order);
+    }
+    running = false;
+    thread.join();
+    EXPECT_GT(reads, 0);
+    EXPECT_EQ(errors, 0);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(InnerOptionMaster, TestPositionViewClear) {
+    //【测试目的】重新初始化后，之前发布、尚未重新发布的低编号槽位不能读成有效数据
+    //【测试步骤】发布槽位0和1，Clear后只重新发布槽位1，size恢复为2
+    //【预期输出】槽位0读取失败、按代码查找不到，槽位1读到新数据
+    const char* const holding_names[2] = {"long_can_close", "short_can_close"};
+    PositionView view;
+    view.Open("", "option", holding_names);
+    view.Publish(0, code_0, HoldingPair(10, 4));
+    view.Publish(1, code_1, HoldingPair(5, 1));
+    PositionViewItem item {};
+    ASSERT_TRUE(view.Read(0, &item));
+    view.Clear();
+    EXPECT_EQ(view.size(), 0);
+    view.Publish(1, code_1, HoldingPair(6, 2));
+    EXPECT_EQ(view.size(), 2);
+    EXPECT_FALSE(view.Read(0, &item));
+    EXPECT_FALSE(view.Find(code_0, &item));
+    ASSERT_TRUE(view.Read(1, &item));
+    EXPECT_EQ(item.holding[0], 6);
+    EXPECT_EQ(item.holding[1], 2);
+    view.Publish(0, code_0, HoldingPair(8, 3));
+    ASSERT_TRUE(view.Find(code_0, &item));
+    EXPECT_EQ(item.holding[0], 8);
+}
@@ -3,6 +3,7 @@
 
 #include "../../mem_broker/utils.h"
 #include "../../mem_broker/inner_stock_master.h"
+#include "../../risker/common/instrument_dict.h"
 #include "helper.h"
 using namespace co;
 
@@ -234,7 +235,11 @@ TEST(InnerStockMaster, T0Trade) {
     InnerStockMaster master;
     master.InitPositions(msg);
     master.AddT0Code(code);
+    // T+0代码只对本master生效，不写入共享的代码字典
+    const Instrument* instrument = InstrumentDict::Instance()->Get(code);
+    EXPECT_TRUE(instrument == nullptr || !instrument->t0());
     InnerStockPositionPtr pos = master.GetPosition(code);
+    EXPECT_TRUE(pos->t0_);
     // 1 普通卖, 报单失败
     {
         MemTradeOrder order{};
@@ -434,3 +439,38 @@ TEST(InnerStockMaster, T0Trade) {
     }
 }
 
+// 篮子委托：普通卖出额度不足的委托自动转为融券卖出，冻结后与柜台持仓核对
+TEST(InnerStockMaster, HandleBasketReq) {
+    string code = "600000.SH";
+    int length = sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition);
+    char buffer[length] = {};
+    MemGetTradePositionMessage *msg = (MemGetTradePositionMessage *) buffer;
+    strcpy(msg->fund_id, "S1");
+    msg->items_size = 1;
+    strcpy(msg->items[0].code, code.c_str());
+    msg->items[0].long_can_close = 1000;
+    msg->items[0].short_can_open = 500;
+    InnerStockMaster master;
+    master.InitPositions(msg);
+    EXPECT_EQ(master.Reconcile(msg), 0);
+
+    MemTradeOrder orders[2] {};
+    strcpy(orders[0].code, code.c_str());
+    orders[0].volume = 800;
+    strcpy(orders[1].code, code.c_str());
+    orders[1].volume = 300;
+    std::string error;
+    EXPECT_EQ(master.HandleBasketReq(co::kBsFlagSell, orders, 2, &error), 2);
+    EXPECT_TRUE(error.empty());
+    EXPECT_EQ(orders[0].oc_flag, co::kOcFlagAuto);
+    EXPECT_EQ(orders[1].oc_flag, co::kOcFlagOpen);
+    InnerStockPositionPtr pos = master.GetPosition(code);
+    EXPECT_EQ(pos->selling_volume_, 800);
+    EXPECT_EQ(pos->borrowing_volume_, 300);
+
+    msg->items[0].long_can_close = 200;
+    msg->items[0].short_can_open = 200;
+    EXPECT_EQ(master.Reconcile(msg), 0);
+    msg->items[0].short_can_open = 500;
+    EXPECT_EQ(master.Reconcile(msg), 1);
+}
@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 
 #include "../../mem_broker/utils.h"
+#include "../../mem_broker/knock_deduper.h"
 #include "helper.h"
 using namespace co;
 
@@ -161,3 +162,31 @@ TEST(UNITS, CheckTradeWithdrawMessage) {
     LOG_INFO << out;
     EXPECT_FALSE(out.empty());
 }
+
+TEST(UNITS, KnockDeduper) {
+    // 【测试目的】重复的成交编号只通过一次，日期变化后上一日的成交编号仍然去重，再次变化后清空
+    // 【测试步骤】插入大量成交编号并重复插入，再两次切换日期后重新插入
+    KnockDeduper deduper;
+    deduper.Reset(20250101);
+    for (int i = 0; i < 10000; i++) {
+        EXPECT_TRUE(deduper.Insert("KNOCK_" + std::to_string(i)));
+    }
+    for (int i = 0; i < 10000; i++) {
+        EXPECT_FALSE(deduper.Insert("KNOCK_" + std::to_string(i)));
+    }
+    EXPECT_TRUE(deduper.Insert(""));
+    EXPECT_FALSE(deduper.Insert(""));
+    EXPECT_EQ(deduper.size(), 10001);
+
+    deduper.Reset(20250101);
+    EXPECT_FALSE(deduper.Insert("KNOCK_0"));
+    deduper.Reset(20250102);  // 夜盘跨0点，0点前的成交回报重放
+    EXPECT_EQ(deduper.size(), 10001);
+    EXPECT_EQ(deduper.day(), 20250102);
+    EXPECT_FALSE(deduper.Insert("KNOCK_0"));
+    EXPECT_TRUE(deduper.Insert("KNOCK_NEW"));
+    deduper.Reset(20250103);
+    EXPECT_EQ(deduper.size(), 1);
+    EXPECT_TRUE(deduper.Insert("KNOCK_0"));
+    EXPECT_FALSE(deduper.Insert("KNOCK_NEW"));
+}
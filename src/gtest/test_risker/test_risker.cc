@@ -1,9 +1,18 @@
 #include <gtest/gtest.h>
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "yaml-cpp/yaml.h"
 
 #include "../../risker/risk_master.h"
 #include "../../risker/risk_options.h"
 #include "../../risker/common/order_book.h"
+#include "../../risker/common/shared_order_book.h"
+#include "../../risker/fancapital/fancapital_risker.h"
+#include "../../risker/common/exposure_risker.h"
+#include "../../risker/config_service.h"
+#include "../../risker/common/instrument_dict.h"
 using namespace co;
 
 std::string fund_id = "S1";
@@ -647,6 +656,66 @@ TEST(Risker, OtherOrder) {
     }
 }
 
+/*
+【测试目的】多个价位的挂单，只有与对手方最优价位交叉时才报错，最优价位结束后由次优价位继续检查
+【测试步骤】1. 依次报买单 9.90、9.95、9.93，并给报单回报
+          2. 报卖单 9.96, 报单成功
+          3. 报卖单 9.94, 与 9.95 的买单交叉, 报单失败
+          4. 给 9.95 的买单全部成交回报
+          5. 再报卖单 9.94, 报单成功; 报卖单 9.93, 报单失败
+*/
+TEST(Risker, PriceLevels) {
+    Init();
+
+    std::string code = "600006.SH";
+    std::vector<double> prices = {9.90, 9.95, 9.93};
+    int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder);
+    std::vector<std::string> buffers;
+    for (size_t i = 0; i < prices.size(); ++i) {
+        std::string buffer(length, '\0');
+        MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer.data();
+        GenerateTradeOrderMessage(msg, code, prices[i], kBsFlagBuy, 100, kOcFlagOpen);
+        std::string out;
+        risk->HandleTradeOrderReq(msg, &out);
+        EXPECT_TRUE(out.empty());
+        std::string order_no = "6-" + std::to_string(i);
+        strcpy(msg->items[0].order_no, order_no.c_str());
+        risk->HandleTradeOrderRep(msg);
+        buffers.emplace_back(std::move(buffer));
+    }
+
+    auto sell = [&](double price) {
+        int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder);
+        char buffer[length] = "";
+        MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+        GenerateTradeOrderMessage(msg, code, price, kBsFlagSell, 100, kOcFlagOpen);
+        std::string out;
+        risk->HandleTradeOrderReq(msg, &out);
+        LOG_INFO << "报单结果: " << (out.empty() ? "成功" : out);
+        return out;
+    };
+    EXPECT_TRUE(sell(9.96).empty());
+    EXPECT_FALSE(sell(9.94).empty());
+
+    {
+        MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffers[1].data();
+        MemTradeOrder* order = msg->items;
+        MemTradeKnock knock = {};
+        knock.timestamp = x::RawDateTime();
+        strcpy(knock.fund_id, msg->fund_id);
+        strcpy(knock.code, order->code);
+        strcpy(knock.order_no, order->order_no);
+        knock.bs_flag = msg->bs_flag;
+        knock.match_volume = order->volume;
+        knock.match_price = order->price;
+        knock.match_type = co::kMatchTypeOK;
+        risk->OnTradeKnock(&knock);
+    }
+
+    EXPECT_TRUE(sell(9.94).empty());
+    EXPECT_FALSE(sell(9.93).empty());
+}
+
 TEST(Risker, OnTick) {
     Init();
 
@@ -693,6 +762,511 @@ TEST(Risker, OnTick) {
     }
 }
 
+/*
+【测试目的】平凡风控规则在Init时编译，按单笔数量、金额和价格区间检查委托
+【测试步骤】1. 配置单笔最大数量1000、最大金额50000、价格区间[1, 100]
+          2. 报单数量和金额都在限额内, 价格在区间内, 报单成功
+          3. 分别超出数量、金额、价格上下限, 报单失败
+          4. 市价委托价格为0, 不检查价格区间, 报单成功; 超出数量报单失败
+*/
+TEST(Risker, FancapitalRules) {
+    std::shared_ptr<RiskOptions> opt = std::make_shared<RiskOptions>();
+    opt->set_risker_id("fancapital");
+    opt->set_fund_id(fund_id);
+    opt->set_data("{\"name\":\"规则测试帐号\",\"max_order_volume\":1000,\"max_order_amount\":50000,"
+                  "\"min_order_price\":1,\"max_order_price\":100,\"withdraw_ratio\":0.5}");
+    FancapitalRisker risker;
+    risker.Init(opt);
+    EXPECT_EQ(risker.rules().max_order_volume, 1000);
+    EXPECT_EQ(risker.rules().withdraw_ratio, 0.5);
+    EXPECT_EQ(risker.rules().knock_ratio, 0);
+
+    auto check = [&](double price, int64_t volume) {
+        int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder);
+        char buffer[length] = "";
+        MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+        GenerateTradeOrderMessage(msg, "600007.SH", price, kBsFlagBuy, volume, kOcFlagOpen);
+        std::string out = risker.HandleTradeOrderReq(msg);
+        LOG_INFO << "报单结果: " << (out.empty() ? "成功" : out);
+        return out;
+    };
+    EXPECT_TRUE(check(10, 1000).empty());
+    EXPECT_FALSE(check(10, 1100).empty());
+    EXPECT_FALSE(check(60, 900).empty());
+    EXPECT_FALSE(check(0.5, 100).empty());
+    EXPECT_FALSE(check(101, 100).empty());
+
+    // 市价委托价格为0，不检查价格区间，数量仍然检查
+    int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder);
+    char buffer[length] = "";
+    MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+    GenerateTradeOrderMessage(msg, "600007.SH", 0, kBsFlagBuy, 100, kOcFlagOpen);
+    msg->items[0].price_type = 0;
+    EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+    msg->items[0].volume = 1100;
+    EXPECT_FALSE(risker.HandleTradeOrderReq(msg).empty());
+}
+
+/*
+【测试目的】滑动窗口内撤单比例、废单比例超限后禁止报单
+【测试步骤】1. 配置撤单比例0.5、废单比例0.2, 委托笔数达到10笔后检查
+          2. 10笔委托响应、5笔撤单成功, 报单成功
+          3. 再有1笔撤单成功, 撤单比例超限, 报单失败
+          4. 按证券代码检查时, 其它代码的废单比例超限, 当前代码报单成功
+*/
+TEST(Risker, FancapitalRatios) {
+    auto generate = [](const std::string& data) {
+        std::shared_ptr<RiskOptions> opt = std::make_shared<RiskOptions>();
+        opt->set_risker_id("fancapital");
+        opt->set_fund_id(fund_id);
+        opt->set_data(data);
+        return opt;
+    };
+    int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder);
+    char buffer[length] = "";
+    MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+    {
+        FancapitalRisker risker;
+        risker.Init(generate("{\"withdraw_ratio\":0.5,\"failure_ratio\":0.2,\"ratio_min_orders\":10}"));
+        GenerateTradeOrderMessage(msg, "600008.SH", 10.0, kBsFlagBuy, 100, kOcFlagOpen);
+        for (int i = 0; i < 10; i++) {
+            strcpy(msg->items[0].order_no, std::to_string(i).c_str());
+            risker.OnTradeOrderReqPass(msg);
+            risker.HandleTradeOrderRep(msg);
+        }
+        MemTradeWithdrawMessage withdraw = {};
+        strcpy(withdraw.fund_id, fund_id.c_str());
+        for (int i = 0; i < 5; i++) {
+            risker.HandleTradeWithdrawRep(&withdraw);
+        }
+        EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+        risker.HandleTradeWithdrawRep(&withdraw);
+        std::string out = risker.HandleTradeOrderReq(msg);
+        LOG_INFO << "报单结果: " << (out.empty() ? "成功" : out);
+        EXPECT_FALSE(out.empty());
+        EXPECT_EQ(risker.counts(x::UnixMilli()).withdraws, 6);
+    }
+    {
+        FancapitalRisker risker;
+        risker.Init(generate("{\"failure_ratio\":0.2,\"ratio_min_orders\":10,\"ratio_by_code\":true}"));
+        GenerateTradeOrderMessage(msg, "600009.SH", 10.0, kBsFlagBuy, 100, kOcFlagOpen);
+        msg->items[0].order_no[0] = '\0';
+        for (int i = 0; i < 10; i++) {
+            risker.OnTradeOrderReqPass(msg);
+            risker.HandleTradeOrderRep(msg);  // 没有合同号，废单
+        }
+        for (int i = 0; i < 40; i++) {
+            strcpy(msg->items[0].code, "600010.SH");
+            strcpy(msg->items[0].order_no, std::to_string(i).c_str());
+            risker.OnTradeOrderReqPass(msg);
+            risker.HandleTradeOrderRep(msg);
+        }
+        EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+        strcpy(msg->items[0].code, "600009.SH");
+        EXPECT_FALSE(risker.HandleTradeOrderReq(msg).empty());
+    }
+}
+
+/*
+【测试目的】撤单和成交按委托计数, 委托结束后不再跟踪
+【测试步骤】1. 批量委托4笔, 批量撤单响应重复返回2次
+          2. 第1笔分2次成交, 其余3笔撤单完成, 第1笔剩余部分成交
+【预期输出】撤单笔数为4, 成交笔数为1, 全部结束后跟踪的委托个数为0
+*/
+TEST(Risker, FancapitalRatioEvents) {
+    std::shared_ptr<RiskOptions> opt = std::make_shared<RiskOptions>();
+    opt->set_risker_id("fancapital");
+    opt->set_fund_id(fund_id);
+    opt->set_data("{\"withdraw_ratio\":0.5,\"knock_ratio\":0.1,\"ratio_min_orders\":10,\"ratio_by_code\":true}");
+    FancapitalRisker risker;
+    risker.Init(opt);
+    int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * 4;
+    char buffer[length] = "";
+    MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+    GenerateTradeOrderMessage(msg, "600011.SH", 10.0, kBsFlagBuy, 100, kOcFlagOpen);
+    msg->items_size = 4;
+    strcpy(msg->batch_no, "B1");
+    for (int i = 0; i < 4; i++) {
+        msg->items[i] = msg->items[0];
+        strcpy(msg->items[i].order_no, ("b" + std::to_string(i)).c_str());
+    }
+    risker.OnTradeOrderReqPass(msg);
+    risker.HandleTradeOrderRep(msg);
+    EXPECT_EQ(risker.tracked_orders(), 4);
+
+    MemTradeWithdrawMessage withdraw = {};
+    strcpy(withdraw.fund_id, fund_id.c_str());
+    strcpy(withdraw.batch_no, "B1");
+    risker.HandleTradeWithdrawRep(&withdraw);
+    risker.HandleTradeWithdrawRep(&withdraw);
+    EXPECT_EQ(risker.counts(x::UnixMilli()).orders, 4);
+    EXPECT_EQ(risker.counts(x::UnixMilli()).withdraws, 4);
+
+    auto knock = [&](const char* order_no, int64_t match_type, int64_t volume) {
+        MemTradeKnock k = {};
+        strcpy(k.fund_id, fund_id.c_str());
+        strcpy(k.code, "600011.SH");
+        strcpy(k.order_no, order_no);
+        k.match_type = match_type;
+        k.match_volume = volume;
+        risker.OnTradeKnock(&k);
+    };
+    knock("b0", kMatchTypeOK, 50);
+    knock("b0", kMatchTypeOK, 30);
+    EXPECT_EQ(risker.counts(x::UnixMilli()).knocks, 1);
+    knock("b1", kMatchTypeWithdrawOK, 100);
+    knock("b2", kMatchTypeWithdrawOK, 100);
+    knock("b3", kMatchTypeWithdrawOK, 100);
+    EXPECT_EQ(risker.tracked_orders(), 1);
+    knock("b0", kMatchTypeOK, 20);
+    EXPECT_EQ(risker.counts(x::UnixMilli()).knocks, 1);
+    EXPECT_EQ(risker.tracked_orders(), 0);
+}
+
+/*
+【测试目的】只有风控检查通过的请求的响应计入委托笔数和废单笔数，本进程生成的拒单不计数
+【测试步骤】1. 配置废单比例0.2, 委托笔数达到10笔后检查
+          2. 10笔委托中3笔柜台废单, 废单比例超限, 报单失败
+          3. 风控拒单的响应、流控拒单的响应重复返回多次
+【预期输出】委托笔数和废单笔数不变, 等待响应的请求个数为0
+*/
+TEST(Risker, FancapitalLocalRejects) {
+    std::shared_ptr<RiskOptions> opt = std::make_shared<RiskOptions>();
+    opt->set_risker_id("fancapital");
+    opt->set_fund_id(fund_id);
+    opt->set_data("{\"failure_ratio\":0.2,\"ratio_min_orders\":10}");
+    FancapitalRisker risker;
+    risker.Init(opt);
+    int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder);
+    char buffer[length] = "";
+    MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+    for (int i = 0; i < 10; i++) {
+        GenerateTradeOrderMessage(msg, "600012.SH", 10.0, kBsFlagBuy, 100, kOcFlagOpen);
+        EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+        risker.OnTradeOrderReqPass(msg);
+        if (i < 3) {
+            strcpy(msg->error, "柜台废单");
+        } else {
+            strcpy(msg->items[0].order_no, std::to_string(i).c_str());
+        }
+        risker.HandleTradeOrderRep(msg);
+        memset(msg->error, 0, sizeof(msg->error));
+    }
+    EXPECT_EQ(risker.counts(x::UnixMilli()).orders, 10);
+    EXPECT_EQ(risker.counts(x::UnixMilli()).failures, 3);
+
+    GenerateTradeOrderMessage(msg, "600012.SH", 10.0, kBsFlagBuy, 100, kOcFlagOpen);
+    msg->items[0].order_no[0] = '\0';
+    std::string error = risker.HandleTradeOrderReq(msg);
+    EXPECT_FALSE(error.empty());
+    strcpy(msg->error, error.c_str());
+    for (int i = 0; i < 5; i++) {
+        risker.HandleTradeOrderRep(msg);  // 风控拒单后的重试
+    }
+    GenerateTradeOrderMessage(msg, "600012.SH", 10.0, kBsFlagBuy, 100, kOcFlagOpen);
+    risker.OnTradeOrderReqPass(msg);
+    strcpy(msg->error, "[FAN-Broker-FlowControlError] 流控拒单");
+    risker.HandleTradeOrderRep(msg);
+    EXPECT_EQ(risker.counts(x::UnixMilli()).orders, 10);
+    EXPECT_EQ(risker.counts(x::UnixMilli()).failures, 3);
+    EXPECT_EQ(risker.pending_requests(), 0);
+}
+
+/*
+【测试目的】根据资金和持仓快照增量维护可用资金和可卖数量, 事前拒绝超限的委托
+【测试步骤】1. 资金快照可用资金10000, 持仓快照可卖300股
+          2. 篮子中同一代码买入2笔共12000元, 可用资金不足, 报单失败
+          3. 买入8000元报单成功, 再买入3000元可用资金不足, 报单失败
+          4. 买单撤单800股后, 再买入3000元报单成功
+          5. 卖出400股可卖数量不足, 报单失败; 卖出300股报单成功
+*/
+TEST(Risker, Exposure) {
+    std::shared_ptr<RiskOptions> opt = std::make_shared<RiskOptions>();
+    opt->set_fund_id(fund_id);
+    opt->set_data("{\"name\":\"敞口测试帐号\",\"enable_exposure\":true,\"check_usable\":true,\"check_can_close\":true}");
+    ExposureRisker risker;
+    risker.Init(opt);
+    std::string code = "600011.SH";
+    MemTradeAsset asset = {};
+    strcpy(asset.fund_id, fund_id.c_str());
+    asset.usable = 10000;
+    risker.OnTradeAsset(&asset);
+    MemTradePosition position = {};
+    strcpy(position.fund_id, fund_id.c_str());
+    strcpy(position.code, code.c_str());
+    position.long_volume = 300;
+    position.long_can_close = 300;
+    risker.OnTradePosition(&position);
+
+    int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * 2;
+    char buffer[length] = "";
+    MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+    GenerateTradeOrderMessage(msg, code, 10.0, kBsFlagBuy, 600, kOcFlagAuto);
+    msg->items_size = 2;
+    memcpy(msg->items + 1, msg->items, sizeof(MemTradeOrder));
+    EXPECT_FALSE(risker.HandleTradeOrderReq(msg).empty());
+
+    GenerateTradeOrderMessage(msg, code, 10.0, kBsFlagBuy, 800, kOcFlagAuto);
+    EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+    risker.OnTradeOrderReqPass(msg);
+    strcpy(msg->items[0].order_no, "EXPOSURE_1");
+    risker.HandleTradeOrderRep(msg);
+    EXPECT_EQ(risker.usable(), 2000);
+    {
+        int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder);
+        char buffer[length] = "";
+        MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+        GenerateTradeOrderMessage(msg, code, 10.0, kBsFlagBuy, 300, kOcFlagAuto);
+        EXPECT_FALSE(risker.HandleTradeOrderReq(msg).empty());
+
+        MemTradeKnock knock = {};
+        strcpy(knock.fund_id, fund_id.c_str());
+        strcpy(knock.code, code.c_str());
+        strcpy(knock.order_no, "EXPOSURE_1");
+        knock.bs_flag = kBsFlagBuy;
+        knock.match_type = kMatchTypeWithdrawOK;
+        knock.match_volume = 800;
+        risker.OnTradeKnock(&knock);
+        EXPECT_EQ(risker.usable(), 10000);
+        EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+
+        GenerateTradeOrderMessage(msg, code, 10.0, kBsFlagSell, 400, kOcFlagAuto);
+        EXPECT_FALSE(risker.HandleTradeOrderReq(msg).empty());
+        msg->items[0].volume = 300;
+        EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+
+        // 成交回报先于委托响应到达，收到委托响应时再处理
+        GenerateTradeOrderMessage(msg, code, 10.0, kBsFlagBuy, 300, kOcFlagAuto);
+        EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+        risker.OnTradeOrderReqPass(msg);
+        EXPECT_DOUBLE_EQ(risker.usable(), 7000);
+        strcpy(knock.order_no, "EXPOSURE_2");
+        knock.match_type = kMatchTypeOK;
+        knock.match_volume = 100;
+        knock.match_amount = 990;
+        risker.OnTradeKnock(&knock);
+        EXPECT_DOUBLE_EQ(risker.usable(), 7000);
+        strcpy(msg->items[0].order_no, "EXPOSURE_2");
+        risker.HandleTradeOrderRep(msg);
+        EXPECT_DOUBLE_EQ(risker.usable(), 7010);
+        EXPECT_DOUBLE_EQ(risker.GetExposure(code)->open_notional, 2000);
+        knock.match_type = kMatchTypeWithdrawOK;
+        knock.match_volume = 200;
+        risker.OnTradeKnock(&knock);
+        EXPECT_DOUBLE_EQ(risker.usable(), 9010);
+        EXPECT_DOUBLE_EQ(risker.GetExposure(code)->open_notional, 0);
+    }
+}
+
+/*
+【测试目的】拆分篮子到期后，同一请求的委托响应分多次返回，每次响应都释放对应委托的冻结
+【测试步骤】1. 可用资金10000, 篮子买入3笔各1000元, 报单成功
+          2. 到期的合并响应只有2笔: 1笔有合同号, 1笔作废
+          3. 迟到的子篮子响应改为原id返回最后1笔
+【预期输出】等待响应的买单金额为0, 作废的1笔释放可用资金, 可用资金为8000
+*/
+TEST(Risker, ExposureSplitRep) {
+    std::shared_ptr<RiskOptions> opt = std::make_shared<RiskOptions>();
+    opt->set_fund_id(fund_id);
+    opt->set_data("{\"name\":\"敞口测试帐号\",\"enable_exposure\":true,\"check_usable\":true}");
+    ExposureRisker risker;
+    risker.Init(opt);
+    std::string code = "600011.SH";
+    MemTradeAsset asset = {};
+    strcpy(asset.fund_id, fund_id.c_str());
+    asset.usable = 10000;
+    risker.OnTradeAsset(&asset);
+
+    int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * 3;
+    char buffer[length] = "";
+    MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+    GenerateTradeOrderMessage(msg, code, 10.0, kBsFlagBuy, 100, kOcFlagAuto);
+    msg->items_size = 3;
+    msg->items[1] = msg->items[0];
+    msg->items[2] = msg->items[0];
+    EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+    risker.OnTradeOrderReqPass(msg);
+    EXPECT_DOUBLE_EQ(risker.usable(), 7000);
+    EXPECT_DOUBLE_EQ(risker.pending_notional(), 3000);
+
+    strcpy(msg->items[0].order_no, "SPLIT_1");
+    msg->items_size = 2;
+    risker.HandleTradeOrderRep(msg);
+    EXPECT_DOUBLE_EQ(risker.usable(), 8000);
+    EXPECT_DOUBLE_EQ(risker.pending_notional(), 1000);
+
+    msg->items_size = 1;
+    strcpy(msg->items[0].order_no, "SPLIT_3");
+    risker.HandleTradeOrderRep(msg);
+    EXPECT_DOUBLE_EQ(risker.usable(), 8000);
+    EXPECT_DOUBLE_EQ(risker.pending_notional(), 0);
+}
+
+/*
+【测试目的】配置文件只解析一次, 修改后发布新的快照, 风控规则在运行中更新
+【测试步骤】1. 解析临时配置文件, 检查流控阈值、股指参数和帐号风控配置
+          2. 流控阈值配置错误时解析失败
+          3. 发布新的快照后版本号加1, ConfigSnapshot只在版本变化时返回true
+          4. 帐号风控更新单笔最大数量后, 原来通过的委托报单失败
+*/
+TEST(Risker, ConfigService) {
+    std::string filename = "config_service_test.yaml";
+    auto write = [&](const std::string& th_tps_limit, int64_t max_order_volume) {
+        std::ofstream out(filename);
+        out << "broker:\n"
+            << "  mem_dir: ../data\n"
+            << "  mem_rep_file: broker_rep\n"
+            << "  flow_control:\n"
+            << "    - market: .SH\n"
+            << "      th_tps_limit: " << th_tps_limit << "\n"
+            << "      th_daily_warning: 1000\n"
+            << "      th_daily_limit: 2000\n"
+            << "cffex:\n"
+            << "  forbid_closing_today: true\n"
+            << "  max_today_opening_volume: 20\n"
+            << "  product_limits:\n"
+            << "    T: 2\n"
+            << "risk:\n"
+            << "  accounts:\n"
+            << "    - fund_id: " << fund_id << "\n"
+            << "      risker_id: fancapital\n"
+            << "      name: 配置测试帐号\n"
+            << "      data: '\"max_order_volume\":" << max_order_volume << "'\n";
+    };
+    write("100", 1000);
+    auto config = ConfigService::Parse(filename);
+    ASSERT_EQ(config->flow_controls.size(), 1);
+    EXPECT_EQ(config->flow_controls[0].market, kMarketSH);
+    EXPECT_EQ(config->flow_controls[0].th_tps_limit, 100);
+    EXPECT_TRUE(config->cffex.forbid_closing_today);
+    EXPECT_EQ(config->cffex.max_today_opening_volume, 20);
+    EXPECT_EQ(config->cffex.product_limits.size(), 1);
+    EXPECT_EQ(config->cffex.product_limits.at("T"), 2);
+    EXPECT_EQ(config->tick_batch_size, 1000);
+    ASSERT_EQ(config->risk_accounts.size(), 1);
+
+    write("1500", 1000);
+    EXPECT_THROW(ConfigService::Parse(filename), std::invalid_argument);
+
+    ConfigService* service = ConfigService::Instance();
+    service->Publish(config);
+    ConfigSnapshot snapshot;
+    EXPECT_TRUE(snapshot.Refresh());
+    EXPECT_FALSE(snapshot.Refresh());
+    int64_t version = service->version();
+    EXPECT_EQ(snapshot->version, version);
+    write("100", 500);
+    service->Publish(ConfigService::Parse(filename));
+    EXPECT_EQ(service->version(), version + 1);
+    EXPECT_TRUE(snapshot.Refresh());
+    EXPECT_EQ(snapshot->flow_controls[0].th_tps_limit, 100);
+
+    FancapitalRisker risker;
+    risker.Init(config->risk_accounts[0]);
+    int length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder);
+    char buffer[length] = "";
+    MemTradeOrderMessage* msg = (MemTradeOrderMessage*)buffer;
+    GenerateTradeOrderMessage(msg, "600012.SH", 10.0, kBsFlagBuy, 800, kOcFlagOpen);
+    EXPECT_TRUE(risker.HandleTradeOrderReq(msg).empty());
+    risker.UpdateRules(*snapshot->risk_accounts[0]);
+    EXPECT_EQ(risker.rules().max_order_volume, 500);
+    EXPECT_FALSE(risker.HandleTradeOrderReq(msg).empty());
+    std::remove(filename.c_str());
+}
+
+/*
+【测试目的】证券代码字典推导的品种、ETF和回购期限正确, 同一代码编号不变
+【测试步骤】1. 查找ETF、回购、股指期货和空代码
+          2. 重复查找同一代码, 按编号反查, 设置T+0标记
+【预期输出】属性正确, 同一代码返回同一条目, 无法识别的代码返回nullptr
+*/
+TEST(Risker, InstrumentDict) {
+    InstrumentDict dict;
+    const Instrument* etf = dict.Get("510300.SH");
+    ASSERT_NE(etf, nullptr);
+    EXPECT_TRUE(etf->etf());
+    EXPECT_FALSE(etf->repo());
+    EXPECT_DOUBLE_EQ(etf->tick_size, 0.001);
+    const Instrument* repo = dict.Get("204001.SH");
+    ASSERT_NE(repo, nullptr);
+    EXPECT_TRUE(repo->repo());
+    EXPECT_EQ(repo->repo_days, 1);
+    EXPECT_EQ(dict.Get("204007.SH")->repo_days, 7);
+    const Instrument* future = dict.Get("IF2509.CFFEX");
+    ASSERT_NE(future, nullptr);
+    EXPECT_EQ(future->product_view(), "IF");
+    EXPECT_TRUE(future->t0());
+    EXPECT_EQ(dict.Get(""), nullptr);
+
+    EXPECT_EQ(dict.Get("510300.SH"), etf);
+    EXPECT_EQ(dict.size(), 4);
+    EXPECT_EQ(dict.At(etf->id), etf);
+    EXPECT_EQ(dict.At(dict.size()), nullptr);
+    EXPECT_FALSE(dict.Get("600000.SH")->t0());
+    dict.SetT0("600000.SH");
+    EXPECT_TRUE(dict.Get("600000.SH")->t0());
+}
+
+/*
+【测试目的】共享挂单表的桶写满后拒绝新的委托, 加锁进程异常退出后遗留的锁可以被接管
+【测试步骤】1. 桶容量为4, 同一代码写入4笔挂单后再写入第5笔
+          2. 删除1笔后再检查和写入
+          3. 模拟存活的进程和已退出的进程分别锁住槽位
+          4. 以不同的桶容量重新打开已存在的文件
+【预期输出】第5笔写入失败且检查返回桶已满, 删除后检查通过并可以写入,
+          存活进程的锁导致检查失败, 已退出进程的锁被接管, 重新打开时使用文件中的桶容量
+*/
+TEST(Risker, SharedOrderBook) {
+    std::string filename = "../data/test.shared_book/anti_self_knock_book";
+    std::filesystem::remove(filename);
+    int64_t date = 20250618;
+    int64_t timestamp = 20250618093000000;
+    const char* code = "600036.SH";
+    SharedOrderBook book;
+    book.Open(filename, 4);
+    ASSERT_EQ(book.slots(), 4);
+    std::vector<SharedBookEntry*> entries;
+    std::vector<int64_t> serials;
+    for (int i = 0; i < 4; ++i) {
+        int64_t serial = 0;
+        SharedBookEntry* entry = book.Insert("S1", code, kBsFlagBuy, 10000 + i, 100, timestamp, date, &serial);
+        ASSERT_NE(entry, nullptr);
+        entries.emplace_back(entry);
+        serials.emplace_back(serial);
+    }
+    int64_t serial = 0;
+    SharedBookOrder hit;
+    ASSERT_EQ(book.Insert("S1", code, kBsFlagBuy, 10000, 100, timestamp, date, &serial), nullptr);
+    ASSERT_EQ(book.FindCross(code, kBsFlagSell, 10000, date, &hit), kSharedBookFull);
+    book.Remove(entries[0], serials[0]);
+    ASSERT_EQ(book.FindCross(code, kBsFlagSell, 10000, date, &hit), kSharedBookPass);
+    entries[0] = book.Insert("S1", code, kBsFlagBuy, 10000, 100, timestamp, date, &serials[0]);
+    ASSERT_NE(entries[0], nullptr);
+
+    // 存活的进程一直锁住槽位
+    entries[1]->locker = ::getppid();
+    entries[1]->seq.fetch_add(1);
+    ASSERT_EQ(book.FindCross(code, kBsFlagSell, 10000, date, &hit), kSharedBookBusy);
+    entries[1]->seq.fetch_add(1);
+    // 已退出的进程遗留的锁
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        _exit(0);
+    }
+    ::waitpid(pid, nullptr, 0);
+    entries[1]->locker = pid;
+    entries[1]->seq.fetch_add(1);
+    book.Remove(entries[1], serials[1]);
+    EXPECT_EQ(entries[1]->seq.load() & 1, 0);
+    EXPECT_EQ(entries[1]->order.live, 0);
+    book.Close();
+
+    book.Open(filename, 8);
+    EXPECT_EQ(book.slots(), 4);
+    book.Close();
+    std::filesystem::remove(filename);
+}
+
 TEST(Risker, Wait) {
     x::Sleep(10000);
 }
@@ -1,9 +1,10 @@
 // Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <filesystem>
 #include "flow_control.h"
+#include "../risker/common/instrument_dict.h"
 
 namespace co {
-FlowControlStateHolder::FlowControlStateHolder(std::shared_ptr<x::MMapFrame> frame): frame_(std::move(frame)) {
-    state_ = (MemFlowControlState*)frame_->mutable_data();
+FlowControlStateHolder::FlowControlStateHolder(MemFlowControlState* state): state_(state) {
 }
 
 FlowControlItem::FlowControlItem(int64_t timestamp, int64_t priority, int64_t cmd_size, double order_amount, double total_amount, int64_t timeout, BrokerMsg* msg):
@@ -15,6 +16,20 @@ void FlowControlMarketQueue::InitState(std::shared_ptr<FlowControlStateHolder> s
     total_cmd_size_ = state_holder_->state()->total_cmd_size;
 }
 
+void FlowControlMarketQueue::RollState(int64_t now_dt) {
+    if (!state_holder_) {
+        return;
+    }
+    auto state = state_holder_->state();
+    if (state->timestamp / 1000000000LL != now_dt / 1000000000LL) {
+        LOG_INFO << "[FlowControl] day changed, reset state, fund_id: " << state->fund_id << ", market: " << market_
+                 << ", total_cmd_size: " << total_cmd_size_ << ", timestamp: " << state->timestamp << " -> " << now_dt;
+        total_cmd_size_ = 0;
+        pre_warning_total_cmd_size_ = 0;
+        state->total_cmd_size = 0;
+    }
+}
+
 BrokerMsg* FlowControlMarketQueue::TryPop(int64_t now_dt) {
     BrokerMsg* ret = TryPopPrimary(now_dt);
     if (!ret) {
@@ -65,8 +80,16 @@ BrokerMsg* FlowControlMarketQueue::TryPopPrimary(int64_t now_dt) {
                 // 只要出现新的请求被打回，就需要持续播放警告，以防交易员漏听。通过设置pre_warning_total_cmd_size_为零来实现；
                 pre_warning_total_cmd_size_ = 0;
             } else {
-                if (th_tps_limit_ <= 0 || tps <= th_tps_limit_) {
+                // 运行时调低流控阈值后，已排队的请求可能超过新阈值，等窗口清空后单独发出，避免一直阻塞队头
+                bool oversize = th_tps_limit_ > 0 && sub_size > th_tps_limit_ && sent_ns_queue_.empty();
+                if (th_tps_limit_ <= 0 || tps <= th_tps_limit_ || oversize) {
                     ret = item->msg();
+                    if (item->enqueue_dt() > 0) {
+                        int64_t wait_ms = x::SubRawDateTime(now_dt, item->enqueue_dt());
+                        ++wait_stats_.count;
+                        wait_stats_.total_ms += wait_ms;
+                        wait_stats_.max_ms = std::max(wait_stats_.max_ms, wait_ms);
+                    }
                     for (int i = 0; i < sub_size; ++i) {
                         sent_ns_queue_.emplace_back(now_dt);
                     }
@@ -214,6 +237,209 @@ BrokerMsg* FlowControlMarketQueue::CreateErrorRep(BrokerMsg* msg, const std::str
     return msg;
 }
 
+// ============================================================================================
+
+std::string FlowControlBasketStitcher::CreateSubBasketId(const std::string& id, int64_t index) {
+    return id + "#" + std::to_string(index);
+}
+
+void FlowControlBasketStitcher::Register(const MemTradeOrderMessage* req, int64_t part_size, int64_t expire_dt) {
+    int64_t length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * req->items_size;
+    SplitBasket basket;
+    basket.raw.assign(reinterpret_cast<const char*>(req), length);
+    basket.part_size = part_size;
+    basket.parts = (req->items_size + part_size - 1) / part_size;
+    basket.expire_dt = expire_dt;
+    basket.batch_nos.resize(basket.parts);
+    basket.states.resize(basket.parts, kPartQueued);
+    if (baskets_.empty() || expire_dt < next_expire_dt_) {
+        next_expire_dt_ = expire_dt;
+    }
+    baskets_[req->id] = std::move(basket);
+}
+
+std::string FlowControlBasketStitcher::GetBasketId(const std::string& sub_id) const {
+    auto pos = sub_id.rfind('#');
+    if (pos != std::string::npos) {
+        std::string id = sub_id.substr(0, pos);
+        if (baskets_.find(id) != baskets_.end()) {
+            return id;
+        }
+    }
+    return sub_id;
+}
+
+FlowControlBasketStitcher::BasketMap::iterator FlowControlBasketStitcher::FindPart(const char* sub_id, int64_t* index) {
+    const char* pos = strrchr(sub_id, '#');
+    if (!pos) {
+        return baskets_.end();
+    }
+    auto itr = baskets_.find(std::string(sub_id, pos - sub_id));
+    if (itr != baskets_.end()) {
+        *index = std::strtoll(pos + 1, nullptr, 10);
+        if (*index < 0 || *index >= itr->second.parts) {
+            return baskets_.end();
+        }
+    }
+    return itr;
+}
+
+BrokerMsg* FlowControlBasketStitcher::Send(BrokerMsg* msg) {
+    auto req = reinterpret_cast<const MemTradeOrderMessage*>(msg->data().data());
+    int64_t index = 0;
+    auto itr = FindPart(req->id, &index);
+    if (itr == baskets_.end()) {
+        return msg;
+    }
+    char& state = itr->second.states[index];
+    if (state == kPartCancelled) {
+        LOG_WARN << "[FlowControl] drop cancelled sub basket, id: " << req->id;
+        BrokerMsg::Destory(msg);
+        return nullptr;
+    }
+    state = kPartSent;
+    return msg;
+}
+
+BrokerMsg* FlowControlBasketStitcher::Stitch(BrokerMsg* msg) {
+    // 非拆分篮子的响应原样返回；子篮子的响应被合并后销毁，全部到齐时返回合并后的响应，否则返回nullptr；
+    auto rep = reinterpret_cast<const MemTradeOrderMessage*>(msg->data().data());
+    int64_t index = 0;
+    auto itr = FindPart(rep->id, &index);
+    if (itr == baskets_.end()) {
+        return msg;
+    }
+    auto& basket = itr->second;
+    char& state = basket.states[index];
+    if (state == kPartDone || state == kPartCancelled) {  // 重复的响应，或作废的子篮子在队列中超时的废单
+        LOG_WARN << "[FlowControl] drop sub basket rep, id: " << rep->id << ", state: " << (int)state;
+        BrokerMsg::Destory(msg);
+        return nullptr;
+    }
+    state = kPartDone;
+    ++basket.done;
+    basket.batch_nos[index] = rep->batch_no[0] != '\0' ? rep->batch_no : "-";
+    if (basket.expired) {
+        // 墓碑：迟到的子篮子响应改为原id单独返回
+        std::string raw = msg->data();
+        auto part = reinterpret_cast<MemTradeOrderMessage*>(raw.data());
+        memset(part->id, 0, sizeof(part->id));
+        strncpy(part->id, itr->first.c_str(), sizeof(part->id) - 1);
+        BrokerMsg::Destory(msg);
+        LOG_INFO << "[FlowControl] late sub basket rep, id: " << itr->first << ", part: " << index
+                 << ", parts: " << basket.done << "/" << basket.parts;
+        if (basket.done >= basket.parts) {
+            baskets_.erase(itr);
+        }
+        return BrokerMsg::Create(nullptr, kMemTypeTradeOrderRep, raw);
+    }
+    auto merged = reinterpret_cast<MemTradeOrderMessage*>(basket.raw.data());
+    int64_t offset = index * basket.part_size;
+    int64_t size = std::min(rep->items_size, merged->items_size - offset);
+    if (size > 0) {
+        memcpy(merged->items + offset, rep->items, sizeof(MemTradeOrder) * size);
+    }
+    if (rep->error[0] != '\0' && merged->error[0] == '\0') {
+        memcpy(merged->error, rep->error, sizeof(merged->error));
+    }
+    BrokerMsg::Destory(msg);
+    if (basket.done < basket.parts) {
+        return nullptr;
+    }
+    BrokerMsg* ret = CreateMergedRep(&basket);
+    LOG_INFO << "[FlowControl] stitch basket ok, id: " << itr->first << ", parts: " << basket.parts;
+    baskets_.erase(itr);
+    return ret;
+}
+
+void FlowControlBasketStitcher::Expire(int64_t now_dt, std::deque<BrokerMsg*>* reps) {
+    if (baskets_.empty() || now_dt < next_expire_dt_) {
+        return;
+    }
+    next_expire_dt_ = 0;
+    for (auto itr = baskets_.begin(); itr != baskets_.end();) {
+        auto& basket = itr->second;
+        if (now_dt >= basket.expire_dt && basket.expired) {
+            LOG_WARN << "[FlowControl] drop split basket tombstone, id: " << itr->first
+                     << ", received parts: " << basket.done << "/" << basket.parts;
+            itr = baskets_.erase(itr);
+            continue;
+        }
+        if (now_dt >= basket.expire_dt) {
+            // 还没有发出的子篮子作废，按废单返回；已经发出的子篮子可能已经报到柜台，等待迟到的响应
+            int64_t cancelled = 0;
+            for (auto& state : basket.states) {
+                if (state == kPartQueued) {
+                    state = kPartCancelled;
+                    ++cancelled;
+                }
+            }
+            basket.done += cancelled;
+            auto merged = reinterpret_cast<MemTradeOrderMessage*>(basket.raw.data());
+            std::stringstream ss;
+            ss << "[FAN-Broker-TimeoutError] split basket rep timeout, received parts: " << basket.done - cancelled
+               << "/" << basket.parts << ", cancelled parts: " << cancelled << ", now: " << now_dt << ", expire: " << basket.expire_dt;
+            std::string error = ss.str();
+            if (cancelled > 0) {
+                memset(merged->error, 0, sizeof(merged->error));
+                strncpy(merged->error, error.c_str(), sizeof(merged->error) - 1);
+            }
+            LOG_WARN << "[FlowControl] split basket expired, id: " << itr->first << ", " << error;
+            BrokerMsg* rep = CreateMergedRep(&basket);
+            if (rep) {
+                reps->emplace_back(rep);
+            }
+            if (basket.done >= basket.parts) {
+                itr = baskets_.erase(itr);
+                continue;
+            }
+            basket.expired = true;
+            basket.expire_dt = x::AddRawDateTime(now_dt, kFlowControlTombstoneMS);
+        }
+        if (next_expire_dt_ == 0 || basket.expire_dt < next_expire_dt_) {
+            next_expire_dt_ = basket.expire_dt;
+        }
+        ++itr;
+    }
+}
+
+BrokerMsg* FlowControlBasketStitcher::CreateMergedRep(SplitBasket* basket) {
+    // 合并后的批次号为各子篮子批次号以逗号拼接，超长时置空，撤单需按委托合同号进行；
+    std::string raw = basket->raw;
+    auto src = reinterpret_cast<const MemTradeOrderMessage*>(basket->raw.data());
+    auto merged = reinterpret_cast<MemTradeOrderMessage*>(raw.data());
+    int64_t size = 0;
+    for (int64_t i = 0; i < basket->parts; ++i) {
+        if (basket->states[i] == kPartSent) {
+            continue;
+        }
+        int64_t offset = i * basket->part_size;
+        int64_t part_size = std::min(basket->part_size, src->items_size - offset);
+        memcpy(merged->items + size, src->items + offset, sizeof(MemTradeOrder) * part_size);
+        size += part_size;
+    }
+    if (size == 0) {
+        return nullptr;
+    }
+    merged->items_size = size;
+    raw.resize(sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * size);
+    merged = reinterpret_cast<MemTradeOrderMessage*>(raw.data());
+    std::string batch_no;
+    for (auto& no : basket->batch_nos) {
+        if (!no.empty() && no != "-") {
+            batch_no += batch_no.empty() ? no : "," + no;
+        }
+    }
+    memset(merged->batch_no, 0, sizeof(merged->batch_no));
+    if (batch_no.length() < sizeof(merged->batch_no)) {
+        strncpy(merged->batch_no, batch_no.c_str(), sizeof(merged->batch_no) - 1);
+    } else {
+        LOG_WARN << "[FlowControl] stitched batch_no exceed length limit, id: " << merged->id << ", batch_no: " << batch_no;
+    }
+    LOG_INFO << "[FlowControl] merge basket rep, id: " << merged->id << ", parts: " << basket->done << "/" << basket->parts
+             << ", orders: " << merged->items_size << ", batch_no: " << batch_no;
+    return BrokerMsg::Create(nullptr, kMemTypeTradeOrderRep, raw);
+}
 
 // ============================================================================================
 
@@ -221,6 +447,7 @@ FlowControlQueue::FlowControlQueue(BrokerQueue* broker_queue): broker_queue_(bro
 }
 
 void FlowControlQueue::Init(MemBrokerOptionsPtr opt) {
+    enable_basket_split_ = opt->enable_basket_split();
     for (auto& cfg : opt->flow_controls()) {
         auto market = cfg->market();
         auto queue = std::make_unique<FlowControlMarketQueue>();
@@ -231,6 +458,37 @@ void FlowControlQueue::Init(MemBrokerOptionsPtr opt) {
         queue->set_th_daily_limit(cfg->th_daily_limit());
         market_to_queue_[queue->market()] = queue.get();
         fc_queues_.emplace_back(std::move(queue));
+        lane_weights_.emplace_back(cfg->weight());
+    }
+    lane_weights_.emplace_back(opt->flow_control_normal_weight());
+    // 只要配置了任一权重就启用轮转调度，未配置权重的通道按1处理；全部未配置时保持按配置顺序严格优先
+    enable_weighted_schedule_ = std::any_of(lane_weights_.begin(), lane_weights_.end(), [](int64_t w) { return w > 0; });
+    for (auto& weight : lane_weights_) {
+        weight = std::max(weight, (int64_t)1);
+    }
+    lane_deficits_.assign(lane_weights_.size(), 0);
+    lane_cursor_ = 0;
+}
+
+void FlowControlQueue::UpdateLimits(const std::vector<FlowControlLimit>& limits) {
+    for (auto& limit : limits) {
+        auto itr = market_to_queue_.find(limit.market);
+        if (itr == market_to_queue_.end()) {
+            LOG_WARN << "[FlowControl] market not in flow control queues, restart required, market: " << limit.market;
+            continue;
+        }
+        auto queue = itr->second;
+        if (queue->th_tps_limit() == limit.th_tps_limit && queue->th_daily_warning() == limit.th_daily_warning
+            && queue->th_daily_limit() == limit.th_daily_limit) {
+            continue;
+        }
+        queue->set_th_tps_limit(limit.th_tps_limit);
+        queue->set_th_daily_warning(limit.th_daily_warning);
+        queue->set_th_daily_limit(limit.th_daily_limit);
+        LOG_INFO << "[FlowControl] update limits, market: " << limit.market
+                 << ", th_tps_limit: " << limit.th_tps_limit
+                 << ", th_daily_warning: " << limit.th_daily_warning
+                 << ", th_daily_limit: " << limit.th_daily_limit;
     }
 }
 
@@ -239,63 +497,77 @@ void FlowControlQueue::InitState(const std::string& fund_id) {
     LOG_INFO << "[FlowControl] init state, fund_id: " << fund_id << " ...";
     int64_t now_dt = x::RawDateTime();
     int64_t now_date = now_dt / 1000000000LL;
-    // -----------------------------------------------------
-    // 加载历史状态
-    std::unordered_map<std::string, std::unique_ptr<MemFlowControlState>> history_states;
-    x::MMapReader reader;
-    reader.Open(state_path_, "meta");
-    reader.SeekToEnd();
-    while (true) {
-        const void *data = nullptr;
-        int64_t type = reader.Prev(&data);
-        if (type == 0) {
-            break;
+    bool created = state_store_.Open(state_path_ + "/state.slots");
+    std::unordered_map<int64_t, int64_t> history;  // market -> total_cmd_size
+    if (created) {  // 首次使用槽位文件时，从旧版本的追加式状态日志中迁移当天的状态
+        LoadLegacyState(fund_id, now_date, &history);
+    }
+    for (auto &queue : fc_queues_) {
+        auto state = state_store_.Acquire(fund_id, queue->market(), now_dt);
+        auto itr = history.find(queue->market());
+        if (itr != history.end() && itr->second > state->total_cmd_size) {
+            state->total_cmd_size = itr->second;
         }
-        if (type == kMemTypeFlowControlState) {
-            auto q = (MemFlowControlState *) data;
-            int64_t state_date = q->timestamp / 1000000000LL;
-            if (state_date == now_date && q->total_cmd_size > 0) {
-                std::string key = std::string(q->fund_id) + "\t" + std::to_string(q->market);
-                auto itr = history_states.find(key);
-                if (itr == history_states.end()) {
-                    auto state = std::make_unique<MemFlowControlState>();
-                    memcpy(state.get(), q, sizeof(*q));
-                    history_states[key] = std::move(state);
-                }
-            } else if (state_date < now_date) {
+        LOG_INFO << "[FlowControl] load state ok, fund_id: " << state->fund_id
+                 << ", market: " << state->market << ", total_cmd_size: " << state->total_cmd_size;
+        queue->InitState(std::make_shared<FlowControlStateHolder>(state));
+    }
+    LOG_INFO << "[FlowControl] init state ok";
+}
+
+void FlowControlQueue::LoadLegacyState(const std::string& fund_id, int64_t now_date, std::unordered_map<int64_t, int64_t>* history) {
+    bool exists = false;
+    if (std::filesystem::is_directory(state_path_)) {
+        for (auto& file : std::filesystem::directory_iterator(state_path_)) {
+            if (file.path().filename().string().find("meta") == 0) {
+                exists = true;
                 break;
             }
         }
     }
-    // --------------------------------------------------------------
-    meta_writer_.Open(state_path_, "meta", 64 << 20);
-    for (auto &queue : fc_queues_) {
-        int64_t history_total_cmd_size = 0;
-        std::string key = fund_id + "\t" + std::to_string(queue->market());
-        auto itr = history_states.find(key);
-        if (itr != history_states.end()) {
-            auto &state = itr->second;
-            history_total_cmd_size = state->total_cmd_size;
-            LOG_INFO << "[FlowControl] load history state ok, fund_id: " << state->fund_id
-                     << ", market: " << state->market << ", total_cmd_size: " << state->total_cmd_size;
-        }
-        auto frame = meta_writer_.OpenSharedFrame(sizeof(MemFlowControlState));
-        auto state = (MemFlowControlState *) frame->mutable_data();
-        memset(state, 0, sizeof(*state));
-        state->timestamp = now_dt;
-        if (fund_id.size() >= sizeof(state->fund_id)) {
-            std::stringstream ss;
-            ss << "fund_id exceed length limit(" << sizeof(state->fund_id) << "): " << fund_id.size();
-            throw std::runtime_error(ss.str());
+    if (!exists) {
+        return;
+    }
+    try {
+        x::MMapReader reader;
+        reader.Open(state_path_, "meta");
+        reader.SeekToEnd();
+        while (true) {
+            const void *data = nullptr;
+            int64_t type = reader.Prev(&data);
+            if (type == 0) {
+                break;
+            }
+            if (type == kMemTypeFlowControlState) {
+                auto q = (MemFlowControlState *) data;
+                int64_t state_date = q->timestamp / 1000000000LL;
+                if (state_date == now_date && q->total_cmd_size > 0 && fund_id == q->fund_id) {
+                    int64_t market = q->market;
+                    int64_t total_cmd_size = q->total_cmd_size;
+                    history->emplace(market, total_cmd_size);  // 倒序读取，先读到的是最新状态
+                } else if (state_date < now_date) {
+                    break;
+                }
+            }
         }
-        strncpy(state->fund_id, fund_id.c_str(), sizeof(state->fund_id) - 1);
-        state->market = queue->market();
-        state->total_cmd_size = history_total_cmd_size;
-        meta_writer_.CloseFrame(kMemTypeFlowControlState);
-        auto state_holder = std::make_shared<FlowControlStateHolder>(frame);
-        queue->InitState(state_holder);
+    } catch (std::exception& e) {
+        LOG_WARN << "[FlowControl] load legacy state failed: " << e.what();
     }
-    LOG_INFO << "[FlowControl] init state ok";
+}
+
+void FlowControlQueue::FlushState(int64_t now_dt) {
+    // 与TryPop在同一个调度线程中调用，跨日清零后刷新槽位时间，再异步刷盘
+    if (!state_store_.is_open()) {
+        return;
+    }
+    if (now_dt <= 0) {
+        now_dt = x::RawDateTime();
+    }
+    for (auto& queue : fc_queues_) {
+        queue->RollState(now_dt);
+    }
+    state_store_.Refresh(now_dt);
+    state_store_.Flush();
 }
 
 BrokerMsg* FlowControlQueue::Pop() {
@@ -321,9 +593,34 @@ BrokerMsg* FlowControlQueue::TryPop(int64_t now_dt) {
             if (!msg) {
                 break;
             }
-            Push(msg);
+            Push(msg, now_dt);
+        }
+    }
+    if (!stitcher_.empty()) {
+        stitcher_.Expire(now_dt, &normal_queue_);
+    }
+    while (true) {
+        ret = TryPopNext(now_dt);
+        if (!ret || stitcher_.empty()) {
+            break;
+        }
+        if (ret->function_id() == kMemTypeTradeOrderRep) {
+            ret = stitcher_.Stitch(ret);  // 子篮子的响应先合并，到齐后再返回
+        } else if (ret->function_id() == kMemTypeTradeOrderReq) {
+            ret = stitcher_.Send(ret);  // 到期作废的子篮子不再发出
+        }
+        if (ret) {
+            break;
         }
     }
+    return ret;
+}
+
+BrokerMsg* FlowControlQueue::TryPopNext(int64_t now_dt) {
+    if (enable_weighted_schedule_) {
+        return TryPopWeighted(now_dt);
+    }
+    BrokerMsg* ret = nullptr;
     for (auto& queue: fc_queues_) {
         ret = queue->TryPopPrimary(now_dt);
         if (ret) {
@@ -342,100 +639,200 @@ BrokerMsg* FlowControlQueue::TryPop(int64_t now_dt) {
     return ret;
 }
 
-void FlowControlQueue::Push(BrokerMsg* msg) {
-    int64_t function_id = msg->function_id();
-    if (function_id == kMemTypeTradeOrderReq) {
-        string raw = msg->data();
-        MemTradeOrderMessage *req = reinterpret_cast<MemTradeOrderMessage*>(raw.data());
-        int64_t items_size = req->items_size;
-        int64_t market = 0;
-        MemTradeOrder* items = req->items;
-        if (items_size > 0) {
-            MemTradeOrder* first = items;
-            market = first->market;
-            if (market <= 0) {
-                market = co::CodeToMarket(first->code ? first->code : "");
-            }
+BrokerMsg* FlowControlQueue::TryPopWeighted(int64_t now_dt) {
+    // 按权重轮转：每个通道每轮最多放行weight个消息，空闲或被流控阻塞的通道直接跳过且不累积额度，
+    // 避免一个市场的积压或一批查询响应阻塞其他市场的报撤单；
+    size_t lanes = lane_weights_.size();
+    for (size_t n = 0; n < lanes; ++n) {
+        size_t lane = lane_cursor_;
+        if (lane_deficits_[lane] <= 0) {
+            lane_deficits_[lane] += lane_weights_[lane];
         }
-        auto itr = market_to_queue_.find(market);
-        if (itr != market_to_queue_.end()) {
-            auto& queue = itr->second;
-            int64_t timestamp = req->timestamp;
-            int64_t priority_type = 0;
-            double order_amount = 0;
-            int64_t bs_flag = req->bs_flag;
-            if (bs_flag == kBsFlagCreate || bs_flag == kBsFlagRedeem) {
-                priority_type = kFlowControlPriorityCreateRedeem;
-            } else {
-                priority_type = kFlowControlPriorityOthers;
-                for (int64_t i = 0; i < items_size; ++i) {
-                    auto item = items + i;
-                    // 不考虑期货期权品种，期货期权broker暂不会启用流控功能；
-                    order_amount += item->price * (double)item->volume;
-                }
-            }
-            double total_amount = priority_type * kItemMultiple + order_amount;
-            int64_t timeout = req->timeout > 0 && req->timeout < request_timeout_ms_ ? req->timeout : request_timeout_ms_;
-            auto item = std::make_unique<FlowControlItem>(timestamp, priority_type, items_size, order_amount, total_amount, timeout, msg);
-            queue->Push(std::move(item));
-        } else {
-            bool is_required = FlowControlQueue::IsFlowControlRequiredMarket(market);
-            if (is_required) {
-                std::string error = "[FAN-Broker-FlowControlError] no flow control config for market: " + std::to_string(market);
-                msg = FlowControlMarketQueue::CreateErrorRep(msg, error);
-                normal_queue_.emplace_back(msg);
-            } else {
-                normal_queue_.emplace_back(msg);
+        BrokerMsg* ret = TryPopLane(lane, now_dt);
+        if (ret) {
+            if (--lane_deficits_[lane] <= 0) {
+                lane_cursor_ = (lane_cursor_ + 1) % lanes;
             }
+            return ret;
+        }
+        lane_deficits_[lane] = 0;
+        lane_cursor_ = (lane_cursor_ + 1) % lanes;
+    }
+    return nullptr;
+}
+
+BrokerMsg* FlowControlQueue::TryPopLane(size_t lane, int64_t now_dt) {
+    BrokerMsg* ret = nullptr;
+    if (lane < fc_queues_.size()) {
+        auto& queue = fc_queues_[lane];
+        ret = queue->TryPopPrimary(now_dt);
+        if (!ret) {
+            ret = queue->TryPopSecondary(now_dt);
         }
-    } else if (function_id == kMemTypeTradeWithdrawReq) {
-        auto raw = msg->data();
-        MemTradeWithdrawMessage *req = reinterpret_cast<MemTradeWithdrawMessage*>(raw.data());
-        int64_t market = 0;
-        int64_t batch_size = 0;
+    } else if (!normal_queue_.empty()) {
+        ret = normal_queue_.front();
+        normal_queue_.pop_front();
+    }
+    return ret;
+}
+
+void FlowControlQueue::ClassifyTradeOrder(const MemTradeOrderMessage* req, BrokerMsgHeader* header) {
+    int64_t items_size = req->items_size;
+    const MemTradeOrder* items = req->items;
+    header->market = 0;
+    if (items_size > 0) {
+        header->market = items->market;
+        if (header->market <= 0) {
+            const Instrument* instrument = InstrumentDict::Instance()->Get(items->code);
+            header->market = instrument ? instrument->market : 0;
+        }
+    }
+    header->cmd_size = items_size;
+    header->order_amount = 0;
+    if (req->bs_flag == kBsFlagCreate || req->bs_flag == kBsFlagRedeem) {
+        header->priority = kFlowControlPriorityCreateRedeem;
+    } else {
+        header->priority = kFlowControlPriorityOthers;
+        for (int64_t i = 0; i < items_size; ++i) {
+            auto item = items + i;
+            // 不考虑期货期权品种，期货期权broker暂不会启用流控功能；
+            header->order_amount += item->price * (double)item->volume;
+        }
+    }
+    header->timestamp = req->timestamp;
+    header->timeout = req->timeout;
+}
+
+void FlowControlQueue::ClassifyTradeWithdraw(const MemTradeWithdrawMessage* req, BrokerMsgHeader* header) {
+    int64_t market = 0;
+    int64_t batch_size = 0;
+    try {
         if (req->order_no[0] != '\0') {
             ParseStandardOrderNo(req->order_no, &market);
             batch_size = 1;
         } else if (req->batch_no[0] != '\0') {
             ParseStandardBatchNo(req->batch_no, &market, &batch_size);
         }
-        if (market <= 0) {  // 解析委托合同号/批次号失败
-            std::stringstream ss;
-            ss << "[FAN-Broker-FlowControlError] non-standard ";
-            if (req->order_no[0] != '\0') {
-                ss << "order_no is forbidden: " << req->order_no;
-            } else {
-                ss << "batch_no is forbidden: " << req->batch_no;
-            }
-            std::string error = ss.str();
-            msg = FlowControlMarketQueue::CreateErrorRep(msg, error);
-            normal_queue_.emplace_back(msg);
+    } catch (std::exception& e) {
+        market = 0;  // 非标准合同号/批次号，由流控队列打回
+    }
+    header->market = market;
+    header->cmd_size = batch_size;
+    header->priority = kFlowControlPriorityWithdraw;
+    header->order_amount = 0;
+    header->timestamp = req->timestamp;
+    header->timeout = 0;
+}
+
+void FlowControlQueue::Push(BrokerMsg* msg, int64_t now_dt) {
+    int64_t function_id = msg->function_id();
+    if (function_id != kMemTypeTradeOrderReq && function_id != kMemTypeTradeWithdrawReq) {
+        normal_queue_.emplace_back(msg);
+        return;
+    }
+    if (!msg->has_header()) {  // 未经预分类直接入队的消息（如单元测试），在这里补充解析
+        BrokerMsgHeader header;
+        if (function_id == kMemTypeTradeOrderReq) {
+            ClassifyTradeOrder(reinterpret_cast<const MemTradeOrderMessage*>(msg->data().data()), &header);
         } else {
-            auto itr = market_to_queue_.find(market);
-            if (itr != market_to_queue_.end()) {
-                auto& queue = itr->second;
-                int64_t timestamp = 0;
-                int64_t priority_type = kFlowControlPriorityWithdraw;
-                double order_amount = 0;
-                double total_amount = priority_type * kItemMultiple + order_amount;
-                auto item = std::make_unique<FlowControlItem>(timestamp, priority_type, batch_size, order_amount, total_amount, 0, msg);
-                queue->Push(std::move(item));
-            } else {
-                bool is_required = FlowControlQueue::IsFlowControlRequiredMarket(market);
-                if (is_required) {
-                    std::string error = "[FAN-Broker-FlowControlError] no flow control config for market: " + std::to_string(market);
-                    msg = FlowControlMarketQueue::CreateErrorRep(msg, error);
-                    normal_queue_.emplace_back(msg);
-                } else {
-                    normal_queue_.emplace_back(msg);
-                }
-            }
+            ClassifyTradeWithdraw(reinterpret_cast<const MemTradeWithdrawMessage*>(msg->data().data()), &header);
+        }
+        msg->set_header(header);
+    }
+    const BrokerMsgHeader& header = msg->header();
+    int64_t market = header.market;
+    if (function_id == kMemTypeTradeWithdrawReq && market <= 0) {  // 解析委托合同号/批次号失败
+        auto req = reinterpret_cast<const MemTradeWithdrawMessage*>(msg->data().data());
+        std::stringstream ss;
+        ss << "[FAN-Broker-FlowControlError] non-standard ";
+        if (req->order_no[0] != '\0') {
+            ss << "order_no is forbidden: " << req->order_no;
+        } else {
+            ss << "batch_no is forbidden: " << req->batch_no;
+        }
+        std::string error = ss.str();
+        msg = FlowControlMarketQueue::CreateErrorRep(msg, error);
+        normal_queue_.emplace_back(msg);
+        return;
+    }
+    auto itr = market_to_queue_.find(market);
+    if (itr == market_to_queue_.end()) {
+        bool is_required = FlowControlQueue::IsFlowControlRequiredMarket(market);
+        if (is_required) {
+            std::string error = "[FAN-Broker-FlowControlError] no flow control config for market: " + std::to_string(market);
+            msg = FlowControlMarketQueue::CreateErrorRep(msg, error);
         }
-    } else {
         normal_queue_.emplace_back(msg);
+        return;
+    }
+    auto& queue = itr->second;
+    int64_t priority_type = header.priority;
+    double total_amount = priority_type * kItemMultiple + header.order_amount;
+    if (function_id == kMemTypeTradeOrderReq) {
+        int64_t timeout = header.timeout > 0 && header.timeout < request_timeout_ms_ ? header.timeout : request_timeout_ms_;
+        if (enable_basket_split_ && queue->th_tps_limit() > 0 && header.cmd_size > queue->th_tps_limit()) {
+            PushSplitBasket(queue, msg, header.timestamp, priority_type, timeout, now_dt);
+            return;
+        }
+        auto item = std::make_unique<FlowControlItem>(header.timestamp, priority_type, header.cmd_size, header.order_amount, total_amount, timeout, msg);
+        item->set_enqueue_dt(now_dt);
+        queue->Push(std::move(item));
+    } else {
+        auto item = std::make_unique<FlowControlItem>(0, priority_type, header.cmd_size, 0, total_amount, 0, msg);
+        item->set_enqueue_dt(now_dt);
+        queue->Push(std::move(item));
     }
 }
 
+void FlowControlQueue::PushSplitBasket(FlowControlMarketQueue* queue, BrokerMsg* msg, int64_t timestamp, int64_t priority, int64_t timeout, int64_t now_dt) {
+    // 按流控阈值把篮子拆成多个子篮子，每个子篮子都能在一个流控窗口内发出，由流控队列按节奏依次放行；
+    auto req = reinterpret_cast<const MemTradeOrderMessage*>(msg->data().data());
+    int64_t part_size = queue->th_tps_limit();
+    int64_t parts = (req->items_size + part_size - 1) / part_size;
+    std::string last_id = FlowControlBasketStitcher::CreateSubBasketId(req->id, parts - 1);
+    if (last_id.length() >= sizeof(req->id)) {
+        std::stringstream ss;
+        ss << "[FAN-Broker-FlowControlError] batch order size exceed flow control threshold, orders: "
+           << req->items_size << ", th_tps_limit: " << part_size << ", id too long to split: " << req->id;
+        normal_queue_.emplace_back(FlowControlMarketQueue::CreateErrorRep(msg, ss.str()));
+        return;
+    }
+    // 第i个子篮子最早要在前面i个流控窗口之后才能放行，超时阈值按排队的窗口数顺延，否则后面的子篮子必然超时；
+    // 最后一个子篮子放行后再等待一个超时阈值的响应时间，到期未合并完成的篮子以超时错误返回；
+    int64_t queue_ms = (parts - 1) * kFlowControlWindowMS;
+    int64_t expire_dt = timeout > 0 ? x::AddRawDateTime(timestamp, timeout * 2 + queue_ms) :
+        x::AddRawDateTime(now_dt, kFlowControlStitchTimeoutMS + queue_ms);
+    stitcher_.Register(req, part_size, expire_dt);
+    for (int64_t i = 0; i < parts; ++i) {
+        int64_t offset = i * part_size;
+        int64_t size = std::min(part_size, req->items_size - offset);
+        int64_t length = sizeof(MemTradeOrderMessage) + sizeof(MemTradeOrder) * size;
+        std::string raw(length, '\0');
+        auto sub = reinterpret_cast<MemTradeOrderMessage*>(raw.data());
+        memcpy(sub, req, sizeof(MemTradeOrderMessage));
+        memcpy(sub->items, req->items + offset, sizeof(MemTradeOrder) * size);
+        sub->items_size = size;
+        std::string sub_id = FlowControlBasketStitcher::CreateSubBasketId(req->id, i);
+        memset(sub->id, 0, sizeof(sub->id));
+        strncpy(sub->id, sub_id.c_str(), sizeof(sub->id) - 1);
+        double order_amount = 0;
+        if (priority == kFlowControlPriorityOthers) {
+            for (int64_t j = 0; j < size; ++j) {
+                order_amount += sub->items[j].price * (double)sub->items[j].volume;
+            }
+        }
+        double total_amount = priority * kItemMultiple + order_amount;
+        auto sub_msg = BrokerMsg::Create(msg->worker(), kMemTypeTradeOrderReq, raw);
+        int64_t part_timeout = timeout > 0 ? timeout + i * kFlowControlWindowMS : 0;
+        auto item = std::make_unique<FlowControlItem>(timestamp, priority, size, order_amount, total_amount, part_timeout, sub_msg);
+        item->set_enqueue_dt(now_dt);
+        queue->Push(std::move(item));
+    }
+    LOG_INFO << "[FlowControl] split basket, id: " << req->id << ", orders: " << req->items_size
+             << ", parts: " << parts << ", th_tps_limit: " << part_size;
+    BrokerMsg::Destory(msg);
+}
+
 int64_t FlowControlQueue::GetNormalQueueSize() const {
     return (int64_t)normal_queue_.size();
 }
@@ -460,6 +857,31 @@ std::string FlowControlQueue::PopWarningMessage(const std::string& node_name) {
     return text;
 }
 
+std::string FlowControlQueue::PopWaitStatsMessage() {
+    // 输出并清空各市场的排队等待统计，由watch周期调用；
+    std::stringstream ss;
+    for (auto& queue : fc_queues_) {
+        auto& stats = queue->wait_stats();
+        if (stats.count > 0) {
+            ss << (ss.tellp() > 0 ? ", " : "") << co::MarketToSuffix(queue->market())
+               << ": {count: " << stats.count
+               << ", avg: " << stats.total_ms / stats.count << "ms"
+               << ", max: " << stats.max_ms << "ms}";
+            queue->clear_wait_stats();
+        }
+    }
+    return ss.str();
+}
+
+bool FlowControlQueue::GetWaitStats(int64_t market, FlowControlWaitStats* stats) const {
+    auto itr = market_to_queue_.find(market);
+    if (itr == market_to_queue_.end()) {
+        return false;
+    }
+    (*stats) = itr->second->wait_stats();
+    return true;
+}
+
 bool FlowControlQueue::IsFlowControlRequiredMarket(int64_t market) {
     return market == kMarketSH || market == kMarketSZ || market == kMarketBJ;
 }
@@ -9,6 +9,8 @@
 #include "coral/coral.h"
 #include "options.h"
 #include "queue.h"
+#include "flow_control_state.h"
+#include "../risker/config_service.h"
 
 namespace co {
 constexpr int64_t kFlowControlPriorityWithdraw = 3;
@@ -17,35 +19,19 @@ constexpr int64_t kFlowControlPriorityOthers = 1;
 constexpr int64_t kItemMultiple = 100000000;
 
 constexpr int64_t kFlowControlWindowMS = 1500;  // 流控时间窗口，1秒+500ms安全垫；
-
-constexpr int64_t kMemTypeFlowControlState = 1390001;
-#ifdef _WIN32
-#pragma pack(push, 1)
-#endif
-struct MemFlowControlState {
-    int64_t timestamp;
-    char fund_id[co::kMemFundIdSize];
-    int64_t market;
-    int64_t total_cmd_size;
-}
-#ifndef _WIN32
-        __attribute__((packed));
-#else
-};
-#pragma pack(pop)
-#endif
+constexpr int64_t kFlowControlStitchTimeoutMS = 60000;  // 未配置超时阈值时，拆分篮子等待子篮子响应的最长时间；
+constexpr int64_t kFlowControlTombstoneMS = 600000;  // 拆分篮子到期后，等待已发出子篮子迟到响应的最长时间；
 
 class FlowControlStateHolder {
  public:
-    explicit FlowControlStateHolder(std::shared_ptr<x::MMapFrame> frame);
+    explicit FlowControlStateHolder(MemFlowControlState* state);
 
     inline MemFlowControlState* state() {
         return state_;
     }
 
  private:
-    MemFlowControlState* state_ = nullptr;
-    std::shared_ptr<x::MMapFrame> frame_ = nullptr;
+    MemFlowControlState* state_ = nullptr;  // 指向FlowControlStateStore中的槽位
 };
 
 class FlowControlItem {
@@ -76,11 +62,20 @@ class FlowControlItem {
         return timeout_;
     }
 
+    [[nodiscard]] inline int64_t enqueue_dt() const {
+        return enqueue_dt_;
+    }
+
+    inline void set_enqueue_dt(int64_t enqueue_dt) {
+        enqueue_dt_ = enqueue_dt;
+    }
+
     inline BrokerMsg* msg() {
         return msg_;
     }
 
  private:
+    int64_t enqueue_dt_ = 0;  // 进入流控队列的时间，用于统计排队等待时长
     int64_t timestamp_ = 0;  // 消息时间
     int64_t priority_ = 0;  // 类型，3-撤单，2-申赎，1-其他
     int64_t cmd_size_ = 1;  // 流控个数，委托个数或撤单个数；
@@ -90,12 +85,23 @@ class FlowControlItem {
     BrokerMsg* msg_ = nullptr;  // BrokerQueue中的元素
 };
 
+/**
+ * 流控队列的排队等待统计，从进入流控队列到被放行的时长
+ */
+struct FlowControlWaitStats {
+    int64_t count = 0;  // 放行的请求个数
+    int64_t total_ms = 0;  // 等待时长之和
+    int64_t max_ms = 0;  // 最大等待时长
+};
+
 /**
  * 根据市场进行分组的流控队列
  */
 class FlowControlMarketQueue {
  public:
     void InitState(std::shared_ptr<FlowControlStateHolder> state_holder);
+    // 跨日时清零全天指令个数，由调度线程定期调用
+    void RollState(int64_t now_dt);
 
     BrokerMsg* TryPop(int64_t now_dt = 0);
     BrokerMsg* TryPopPrimary(int64_t now_dt = 0);
@@ -161,6 +167,14 @@ class FlowControlMarketQueue {
         triggered_flow_control_size_ = 0;
     }
 
+    [[nodiscard]] inline const FlowControlWaitStats& wait_stats() const {
+        return wait_stats_;
+    }
+
+    inline void clear_wait_stats() {
+        wait_stats_ = FlowControlWaitStats();
+    }
+
  protected:
     void Sort();
     bool IsTimeout(int64_t now_dt, const FlowControlItem& item, int64_t ahead_count) const;
@@ -182,11 +196,61 @@ class FlowControlMarketQueue {
 
     int64_t cmd_size_ = 0;  // 当前流控队列中的子指令数量之和；
     int64_t total_cmd_size_ = 0;  // 已发送的所有指令个数
+    FlowControlWaitStats wait_stats_;  // 排队等待统计
 
     std::atomic_int64_t triggered_flow_control_size_ = 0;  // 已触发流控的最新流控队列大小，用于报警；
     std::atomic_int64_t pre_warning_total_cmd_size_ = 0;  // 上次报警的总指令个数
 };
 
+/**
+ * 拆分篮子的响应合并器：超过流控阈值的批量委托被拆成多个子篮子分批发送，
+ * 子篮子的id为“原id#序号”，所有子篮子响应到齐后合并成一个原id的响应；
+ * 到期仍有子篮子未返回响应时，还没有发出的子篮子作废，和已收到的部分合并成原id的响应返回，作废的子委托以超时错误返回；
+ * 已经发出的子篮子可能已经报到柜台，不按废单处理，篮子保留为墓碑，迟到的响应改为原id后单独返回；
+ */
+class FlowControlBasketStitcher {
+ public:
+    static std::string CreateSubBasketId(const std::string& id, int64_t index);
+
+    void Register(const MemTradeOrderMessage* req, int64_t part_size, int64_t expire_dt);
+    BrokerMsg* Stitch(BrokerMsg* msg);
+    // 子篮子放行前记录为已发出，已作废的子篮子销毁并返回nullptr
+    BrokerMsg* Send(BrokerMsg* msg);
+    // 把到期的拆分篮子合并成响应放入reps，墓碑到期后删除
+    void Expire(int64_t now_dt, std::deque<BrokerMsg*>* reps);
+    std::string GetBasketId(const std::string& sub_id) const;
+
+    [[nodiscard]] inline bool empty() const {
+        return baskets_.empty();
+    }
+
+ private:
+    enum PartState : char {
+        kPartQueued = 0,  // 在流控队列中排队
+        kPartSent,  // 已经发出，等待响应
+        kPartDone,  // 已收到响应
+        kPartCancelled,  // 到期时还没有发出，已作废
+    };
+
+    struct SplitBasket {
+        std::string raw;  // 原始请求，子篮子的响应依次覆盖对应位置的子委托
+        int64_t part_size = 0;  // 每个子篮子的委托个数，最后一个可能不足
+        int64_t parts = 0;  // 子篮子个数
+        int64_t done = 0;  // 已收到响应或已作废的子篮子个数
+        int64_t expire_dt = 0;  // 等待子篮子响应的截止时间，成为墓碑后为墓碑的删除时间
+        bool expired = false;  // 是否已到期成为墓碑
+        std::vector<std::string> batch_nos;  // 子篮子的批次号，按序号存放
+        std::vector<char> states;  // 子篮子的状态PartState，按序号存放
+    };
+    using BasketMap = std::unordered_map<std::string, SplitBasket>;
+    BasketMap::iterator FindPart(const char* sub_id, int64_t* index);
+    // 合并已收到响应和已作废的子篮子，已发出未响应的子委托不包含在内
+    static BrokerMsg* CreateMergedRep(SplitBasket* basket);
+
+    BasketMap baskets_;  // 原id -> 拆分中的篮子和墓碑
+    int64_t next_expire_dt_ = 0;  // 最早到期的截止时间，未到期时不遍历
+};
+
 /**
  * FlowControlQueue 流控队列
  * @since 2024-07-29 16:00:32
@@ -195,15 +259,26 @@ class FlowControlQueue {
  public:
     explicit FlowControlQueue(BrokerQueue* broker_queue);
     static bool IsFlowControlRequiredMarket(int64_t market);
+    static void ClassifyTradeOrder(const MemTradeOrderMessage* req, BrokerMsgHeader* header);
+    static void ClassifyTradeWithdraw(const MemTradeWithdrawMessage* req, BrokerMsgHeader* header);
 
     void Init(MemBrokerOptionsPtr opt);
+    // 配置文件修改后更新已有市场的流控阈值，新增的市场需要重启后生效
+    void UpdateLimits(const std::vector<FlowControlLimit>& limits);
     void InitState(const std::string& fund_id);
+    void FlushState(int64_t now_dt = 0);
     BrokerMsg* Pop();
     BrokerMsg* TryPop(int64_t now_dt = 0);
 
     [[nodiscard]] int64_t GetNormalQueueSize() const;
     void GetFlowControlQueueSize(int64_t* cmd_size, int64_t* total_cmd_size) const;
     std::string PopWarningMessage(const std::string& node_name);
+    std::string PopWaitStatsMessage();
+    bool GetWaitStats(int64_t market, FlowControlWaitStats* stats) const;
+
+    [[nodiscard]] inline bool enable_weighted_schedule() const {
+        return enable_weighted_schedule_;
+    }
 
     inline void set_request_timeout_ms(int64_t request_timeout_ms) {
         request_timeout_ms_ = request_timeout_ms;
@@ -225,19 +300,36 @@ class FlowControlQueue {
         return state_path_;
     }
 
+    [[nodiscard]] inline std::string GetBasketId(const std::string& id) const {
+        return stitcher_.empty() ? id : stitcher_.GetBasketId(id);
+    }
+
  protected:
-    void Push(BrokerMsg* msg);
+    void LoadLegacyState(const std::string& fund_id, int64_t now_date, std::unordered_map<int64_t, int64_t>* history);
+    void Push(BrokerMsg* msg, int64_t now_dt = 0);
+    void PushSplitBasket(FlowControlMarketQueue* queue, BrokerMsg* msg, int64_t timestamp, int64_t priority, int64_t timeout, int64_t now_dt);
+    BrokerMsg* TryPopNext(int64_t now_dt);
+    BrokerMsg* TryPopWeighted(int64_t now_dt);
+    BrokerMsg* TryPopLane(size_t lane, int64_t now_dt);
 
  private:
     int64_t request_timeout_ms_ = 0; // 报单超时阈值
     int64_t idle_sleep_ns_ = 0;
+    bool enable_basket_split_ = false;  // 超过流控阈值的批量委托是否拆分发送
     BrokerQueue* broker_queue_ = nullptr;
+    FlowControlBasketStitcher stitcher_;
 
     std::vector<std::unique_ptr<FlowControlMarketQueue>> fc_queues_;  // 按市场分组的流控队列
     std::unordered_map<int64_t, FlowControlMarketQueue*> market_to_queue_;
     std::deque<BrokerMsg*> normal_queue_;  // 不需要进行流控的其他消息队列
 
+    // 按权重轮转调度（Deficit Round Robin），通道依次为各市场流控队列和normal_queue_
+    bool enable_weighted_schedule_ = false;
+    std::vector<int64_t> lane_weights_;  // 每轮可放行的消息个数
+    std::vector<int64_t> lane_deficits_;  // 本轮剩余额度
+    size_t lane_cursor_ = 0;  // 当前轮到的通道
+
     std::string state_path_ = "../data/state.broker.mem";  // 状态持久化路径
-    x::MMapWriter meta_writer_;
+    FlowControlStateStore state_store_;
 };
 }  // namespace co
@@ -0,0 +1,160 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <filesystem>
+#include "flow_control_state.h"
+
+namespace co {
+FlowControlStateStore::~FlowControlStateStore() {
+    Close();
+}
+
+bool FlowControlStateStore::Open(const std::string& filename) {
+    // 打开或创建状态文件，返回文件是否为新建
+    Close();
+    std::filesystem::path path(filename);
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("open flow control state file failed: " + filename);
+    }
+    size_ = sizeof(FlowControlStateFileHeader) + sizeof(MemFlowControlState) * kFlowControlStateSlots;
+    ::flock(fd_, LOCK_EX);
+    struct stat st = {};
+    ::fstat(fd_, &st);
+    bool created = st.st_size == 0;
+    if (created && ::ftruncate(fd_, (off_t)size_) != 0) {
+        ::flock(fd_, LOCK_UN);
+        throw std::runtime_error("resize flow control state file failed: " + filename);
+    }
+    if (!created && st.st_size != (off_t)size_) {
+        ::flock(fd_, LOCK_UN);
+        throw std::runtime_error("illegal flow control state file size: " + std::to_string(st.st_size) + ", file: " + filename);
+    }
+    addr_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr_ == MAP_FAILED) {
+        addr_ = nullptr;
+        ::flock(fd_, LOCK_UN);
+        throw std::runtime_error("mmap flow control state file failed: " + filename);
+    }
+    auto header = (FlowControlStateFileHeader*)addr_;
+    if (created) {
+        header->slots = kFlowControlStateSlots;
+        header->magic = kFlowControlStateMagic;
+    } else if (header->magic != kFlowControlStateMagic || header->slots != kFlowControlStateSlots) {
+        ::flock(fd_, LOCK_UN);
+        throw std::runtime_error("illegal flow control state file header: " + filename);
+    }
+    slots_ = (MemFlowControlState*)((char*)addr_ + sizeof(FlowControlStateFileHeader));
+    ::flock(fd_, LOCK_UN);
+    return created;
+}
+
+MemFlowControlState* FlowControlStateStore::Acquire(const std::string& fund_id, int64_t market, int64_t now_dt) {
+    // 查找当前账号和市场的槽位，跨日的槽位清零后复用；找不到时占用空槽位或过期槽位
+    if (!slots_) {
+        throw std::runtime_error("flow control state store is not opened");
+    }
+    if (fund_id.size() >= sizeof(MemFlowControlState::fund_id)) {
+        std::stringstream ss;
+        ss << "fund_id exceed length limit(" << sizeof(MemFlowControlState::fund_id) << "): " << fund_id.size();
+        throw std::runtime_error(ss.str());
+    }
+    int64_t now_date = now_dt / 1000000000LL;
+    MemFlowControlState* found = nullptr;
+    MemFlowControlState* free_slot = nullptr;
+    ::flock(fd_, LOCK_EX);
+    for (int64_t i = 0; i < kFlowControlStateSlots; ++i) {
+        auto slot = slots_ + i;
+        if (slot->fund_id[0] != '\0' && slot->market == market && fund_id == slot->fund_id) {
+            found = slot;
+            break;
+        }
+        if (!free_slot && (slot->fund_id[0] == '\0' || slot->timestamp / 1000000000LL < now_date) &&
+            std::find(acquired_.begin(), acquired_.end(), slot) == acquired_.end() && !IsSlotLocked(slot)) {
+            free_slot = slot;  // 跨日的槽位只有在所属broker已经退出时才复用
+        }
+    }
+    if (!found && free_slot) {
+        found = free_slot;
+        memset(found, 0, sizeof(*found));
+        strncpy(found->fund_id, fund_id.c_str(), sizeof(found->fund_id) - 1);
+        found->market = market;
+        found->timestamp = now_dt;
+    }
+    if (found && found->timestamp / 1000000000LL != now_date) {
+        found->total_cmd_size = 0;
+        found->timestamp = now_dt;
+    }
+    ::flock(fd_, LOCK_UN);
+    if (!found) {
+        throw std::runtime_error("flow control state slots exhausted: " + std::to_string(kFlowControlStateSlots));
+    }
+    if (std::find(acquired_.begin(), acquired_.end(), found) == acquired_.end()) {
+        if (!LockSlot(found)) {
+            LOG_WARN << "[FlowControl] state slot is locked by another broker, fund_id: " << fund_id << ", market: " << market;
+        }
+        acquired_.emplace_back(found);
+    }
+    return found;
+}
+
+bool FlowControlStateStore::LockSlot(MemFlowControlState* slot) {
+    struct flock lock = {};
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = (off_t)((char*)slot - (char*)addr_);
+    lock.l_len = sizeof(MemFlowControlState);
+    return ::fcntl(fd_, F_OFD_SETLK, &lock) == 0;
+}
+
+bool FlowControlStateStore::IsSlotLocked(MemFlowControlState* slot) {
+    struct flock lock = {};
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = (off_t)((char*)slot - (char*)addr_);
+    lock.l_len = sizeof(MemFlowControlState);
+    if (::fcntl(fd_, F_OFD_GETLK, &lock) != 0) {
+        return true;  // 无法确认时不复用
+    }
+    return lock.l_type != F_UNLCK;
+}
+
+void FlowControlStateStore::Refresh(int64_t now_dt) {
+    // 与Acquire使用同一把文件锁，其他broker不会在刷新过程中判断槽位过期
+    if (!slots_ || acquired_.empty()) {
+        return;
+    }
+    ::flock(fd_, LOCK_EX);
+    for (auto slot : acquired_) {
+        slot->timestamp = now_dt;
+    }
+    ::flock(fd_, LOCK_UN);
+}
+
+void FlowControlStateStore::Flush() {
+    if (addr_) {
+        ::msync(addr_, size_, MS_ASYNC);
+    }
+}
+
+void FlowControlStateStore::Close() {
+    if (addr_) {
+        ::msync(addr_, size_, MS_SYNC);
+        ::munmap(addr_, size_);
+        addr_ = nullptr;
+        slots_ = nullptr;
+        acquired_.clear();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+}  // namespace co
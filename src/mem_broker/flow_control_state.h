@@ -0,0 +1,72 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <string>
+#include <memory>
+#include <vector>
+
+#include "x/x.h"
+#include "coral/coral.h"
+
+namespace co {
+constexpr int64_t kMemTypeFlowControlState = 1390001;
+constexpr int64_t kFlowControlStateMagic = 0x4643535441544531;  // "FCSTATE1"
+constexpr int64_t kFlowControlStateSlots = 1024;  // 每台服务器所有broker共用的状态槽位数，按(fund_id, market)占用
+#ifdef _WIN32
+#pragma pack(push, 1)
+#endif
+struct MemFlowControlState {
+    int64_t timestamp;
+    char fund_id[co::kMemFundIdSize];
+    int64_t market;
+    int64_t total_cmd_size;
+}
+#ifndef _WIN32
+        __attribute__((packed));
+#else
+};
+#pragma pack(pop)
+#endif
+
+struct FlowControlStateFileHeader {
+    int64_t magic;
+    int64_t slots;
+};
+
+/**
+ * 流控状态存储：固定大小的共享内存文件，每个(fund_id, market)占用一个槽位并原地更新，
+ * 启动时只需扫描固定个数的槽位，与历史交易日和报撤单笔数无关；跨日的槽位在下次占用时自动清零复用。
+ * 槽位分配通过文件锁在同一台服务器的多个broker之间互斥，分配后只由所属broker写入，并由所属broker定期刷新时间。
+ * 占用的槽位同时加记录锁（随文件关闭或进程退出释放），跨日后所属broker还没有刷新时间时，其他broker也不会复用。
+ */
+class FlowControlStateStore {
+ public:
+    FlowControlStateStore() = default;
+    ~FlowControlStateStore();
+    FlowControlStateStore(const FlowControlStateStore&) = delete;
+    FlowControlStateStore& operator=(const FlowControlStateStore&) = delete;
+
+    bool Open(const std::string& filename);
+    MemFlowControlState* Acquire(const std::string& fund_id, int64_t market, int64_t now_dt);
+    // 刷新已占用槽位的时间，长时间运行（如跨日）的broker的槽位不会被其他broker当作过期槽位复用
+    void Refresh(int64_t now_dt);
+    void Flush();
+    void Close();
+
+    [[nodiscard]] inline bool is_open() const {
+        return slots_ != nullptr;
+    }
+
+ private:
+    // 在槽位上加记录锁，其他打开方不能复用
+    bool LockSlot(MemFlowControlState* slot);
+    // 槽位是否被其他打开方加了记录锁
+    bool IsSlotLocked(MemFlowControlState* slot);
+
+ private:
+    int fd_ = -1;
+    void* addr_ = nullptr;
+    size_t size_ = 0;
+    MemFlowControlState* slots_ = nullptr;
+    std::vector<MemFlowControlState*> acquired_;  // 本进程占用的槽位
+};
+}  // namespace co
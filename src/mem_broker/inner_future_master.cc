@@ -1,192 +1,107 @@
 // Copyright 2025 Fancapital Inc.  All rights reserved.
 
-#include "yaml-cpp/yaml.h"
 #include "inner_future_master.h"
-constexpr int kCFFEXOptionLength = 14;
 
 namespace co {
-void InnerFutureMaster::InitCffexParam() {
-    auto getBool = [&](const YAML::Node& node, const std::string& name) {
-        try {
-            return node[name] && !node[name].IsNull() ? node[name].as<bool>() : false;
-        } catch (std::exception& e) {
-            LOG_ERROR << "load configuration failed: name = " << name << ", error = " << e.what();
-            throw std::runtime_error(e.what());
-        }
-    };
-    auto getInt = [&](const YAML::Node& node, const std::string& name, const int64_t& default_value = 0) {
-        try {
-            return node[name] && !node[name].IsNull() ? node[name].as<int64_t>() : default_value;
-        } catch (std::exception& e) {
-            LOG_ERROR << "load configuration failed: name = " << name << ", error = " << e.what();
-            throw std::runtime_error(e.what());
+constexpr const char* kCffexIndexFutures[] = {"IF", "IH", "IC", "IM"};
+
+const CffexConfig& InnerFutureMaster::cffex() {
+    if (config_.Refresh()) {
+        const CffexConfig& config = config_->cffex;
+        LOG_INFO << "股指特定参数 forbid_closing_today: " << config.forbid_closing_today
+                 << ", max_today_opening_volume: " << config.max_today_opening_volume
+                 << ", product_limits: " << config.product_limits.size()
+                 << ", version: " << config_->version;
+        for (auto& counter : products_) {
+            counter.max_open_volume = GetMaxOpenVolume(config, counter);
         }
-    };
-    try {
-        auto filename = x::FindFile("broker.yaml");
-        YAML::Node root = YAML::LoadFile(filename);
-        auto param = root["cffex"];
-        forbid_closing_today_ = getBool(param, "forbid_closing_today");
-        max_today_opening_volume_ = getInt(param, "max_today_opening_volume");
-        LOG_INFO << "股指特定参数 forbid_closing_today: " << forbid_closing_today_ << ", max_today_opening_volume: " << max_today_opening_volume_;
-    } catch (std::exception& e) {
-        LOG_ERROR << "InitCffexParam, " << e.what();
     }
+    return config_->cffex;
 }
 
-void InnerFutureMaster::InitPositions(MemGetTradePositionMessage* rep) {
-    LOG_INFO << "set init future position, size: " << rep->items_size;
-    InitCffexParam();
-    positions_.clear();
-    open_cache_.insert(std::make_pair("IF", 0));
-    open_cache_.insert(std::make_pair("IH", 0));
-    open_cache_.insert(std::make_pair("IC", 0));
-    open_cache_.insert(std::make_pair("IM", 0));
-    if (rep->items_size > 0) {
-        string fund_id = rep->fund_id;
-        auto first = (MemTradePosition*)((char*)rep + sizeof(MemGetTradePositionMessage));
-        for (int i = 0; i < rep->items_size; i++) {
-            MemTradePosition *position = first + i;
-            string code = position->code;
-            InnerFuturePositionPtr long_pos = GetPosition(code, kBsFlagBuy, kOcFlagOpen);
-            InnerFuturePositionPtr short_pos = GetPosition(code, kBsFlagSell, kOcFlagOpen);
-            long_pos->yd_init_volume_ = position->long_pre_volume;
-            long_pos->td_init_volume_ = position->long_volume - position->long_pre_volume;
-            short_pos->yd_init_volume_ = position->short_pre_volume;
-            short_pos->td_init_volume_ = position->short_volume - position->short_pre_volume;
-            if (long_pos->marker_ == kMarketCFFEX && long_pos->td_init_volume_) {
-                string type = code.length() > 2 ? code.substr(0, 2) : "";
-                if (auto it = open_cache_.find(type); it != open_cache_.end()) {
-                    it->second += long_pos->td_init_volume_;
-                }
-            }
-            if (short_pos->marker_ == kMarketCFFEX && short_pos->td_init_volume_) {
-                string type = code.length() > 2 ? code.substr(0, 2) : "";
-                if (auto it = open_cache_.find(type); it != open_cache_.end()) {
-                    it->second += short_pos->td_init_volume_;
-                }
-            }
-        }
-    }
-    init_flag_ = true;
-    LOG_INFO << "[AutoOpenClose] OnInit";
-    for (auto it : positions_) {
-        LOG_INFO << it.first << ", long:  " << it.second->first->ToString();
-        LOG_INFO << it.first << ", short: " << it.second->second->ToString();
+int64_t InnerFutureMaster::GetMaxOpenVolume(const CffexConfig& config, const CffexProductCounter& counter) {
+    if (auto it = config.product_limits.find(counter.product); it != config.product_limits.end()) {
+        return it->second;
     }
+    return counter.index_future ? config.max_today_opening_volume : -1;
 }
 
-void InnerFutureMaster::HandleOrderReq(int64_t bs_flag, const MemTradeOrder& order) {
-    // 处理委托请求，冻结数量
-    std::string code = order.code;
-    int64_t market = order.market;
-    if (market == 0) {
-        market = co::CodeToMarket(code);
-    }
-    if (bs_flag != kBsFlagBuy && bs_flag != kBsFlagSell) {
-        return;
-    }
-    int64_t oc_flag = order.oc_flag;
-    if (oc_flag <= 0) {
-        return;
+int32_t InnerFutureMaster::GetProductIndex(const Instrument* instrument) {
+    std::string_view product = instrument->product_view();
+    for (size_t i = 0; i < products_.size(); ++i) {
+        if (product == products_[i].product) {
+            return (int32_t)i;
+        }
     }
-    if (!IsAccountInitialized()) {
-        return;
+    CffexProductCounter& counter = products_.emplace_back();
+    memcpy(counter.product, instrument->product, sizeof(counter.product));
+    for (auto index_future : kCffexIndexFutures) {
+        if (product == index_future) {
+            counter.index_future = true;
+        }
     }
+    counter.max_open_volume = GetMaxOpenVolume(cffex(), counter);
+    LOG_INFO << "cffex product: " << product << ", index: " << products_.size() - 1
+             << ", index_future: " << counter.index_future << ", max_open_volume: " << counter.max_open_volume;
+    return (int32_t)products_.size() - 1;
+}
 
-    InnerFuturePositionPtr pos = GetPosition(code, bs_flag, oc_flag);
-    if (pos) {
-        std::string before = pos->ToString();
-        Update(pos, oc_flag, order.volume, 0, 0);
-        std::string after = pos->ToString();
-        LOG_INFO << "[AutoOpenClose]["
-            << code << ", bs_flag: " << bs_flag << "] OnOrderReq: "
-            << "oc_flag: " << oc_flag
-            << ", order_volume: " << order.volume
-            << ", before " << before << ", after " << after;
+const CffexProductCounter* InnerFutureMaster::GetCffexProduct(std::string_view product) const {
+    for (auto& counter : products_) {
+        if (product == counter.product) {
+            return &counter;
+        }
     }
+    return nullptr;
 }
 
-void InnerFutureMaster::HandleOrderRep(int64_t bs_flag, const MemTradeOrder& order) {
-    // 处理委托废单响应，解冻数量
-    if (strlen(order.order_no) > 0) {
-        LOG_INFO << "报单成功, 不处理, code: " << order.code
-                        << ", bs_flag: " << bs_flag
-                        << ", oc_flag: " << order.oc_flag
-                        << ", order_no: " << order.order_no
-                        << ", price: " << order.price
-                        << ", volume: " << order.volume;
-        return;
-    }
-    std::string code = order.code;
-    int64_t oc_flag = order.oc_flag;
-    if (bs_flag != kBsFlagBuy && bs_flag != kBsFlagSell) {
-        return;
-    }
-    if (!IsAccountInitialized()) {
-        return;
-    }
-    InnerFuturePositionPtr pos = GetPosition(code, bs_flag, oc_flag);
-    if (pos) {
-        std::string before = pos->ToString();
-        Update(pos, oc_flag, 0, 0, order.volume);
-        std::string after = pos->ToString();
-        LOG_INFO << "[AutoOpenClose]["
-            << code << ", bs_flag: " << bs_flag << "] OnOrderRep: "
-            << "oc_flag: " << oc_flag
-            << ", withdraw_volume: " << order.volume
-            << ", before " << before << ", after " << after;
+void InnerFutureMaster::OnInit() {
+    cffex();
+    // 品种编号保留，重新统计开仓数
+    for (auto& counter : products_) {
+        counter.opening_volume = 0;
+        counter.open_volume = 0;
     }
 }
 
-void InnerFutureMaster::HandleKnock(const MemTradeKnock& knock) {
-    // 更新内部持仓
-    std::string fund_id = knock.fund_id;
-    std::string inner_match_no = knock.inner_match_no;
-    std::string code = knock.code;
-    int64_t bs_flag = knock.bs_flag;
-    int64_t oc_flag = knock.oc_flag;
-    if (fund_id.empty() || inner_match_no.empty() || code.empty()) {
-        return;
-    }
-    if (bs_flag != kBsFlagBuy && bs_flag != kBsFlagSell) {
-        return;
-    }
-    if (knock.match_volume <= 0) {
-        return;
+void InnerFutureMaster::OnCreate(std::string_view code, Entry* entry) {
+    const Instrument* instrument = InstrumentDict::Instance()->Get(code);
+    int32_t market = instrument ? (int32_t)instrument->market : 0;
+    int32_t product_index = market == kMarketCFFEX && instrument->product[0] != '\0' ? GetProductIndex(instrument) : -1;
+    for (auto pos : {&entry->long_pos, &entry->short_pos}) {
+        pos->marker_ = market;
+        pos->product_index_ = product_index;
+        pos->instrument_ = instrument;
     }
-    if (!IsAccountInitialized()) {
-        return;
-    }
-    auto itr = knocks_.find(inner_match_no);
-    if (itr != knocks_.end()) {
-        return;  // 该成交回报已处理过，忽略
-    }
-    knocks_.insert(inner_match_no);
-    int64_t match_volume = 0;
-    int64_t withdraw_volume = 0;
-    if (knock.match_type == kMatchTypeOK) {
-        match_volume = knock.match_volume;
-    } else if (knock.match_type == kMatchTypeWithdrawOK || knock.match_type == kMatchTypeFailed) {
-        withdraw_volume = knock.match_volume;
-    }
-    InnerFuturePositionPtr pos = GetPosition(code, bs_flag, oc_flag);
-    if (pos && (match_volume > 0 || withdraw_volume > 0)) {
-        std::string before = pos->ToString();
-        Update(pos, oc_flag, 0, match_volume, withdraw_volume);
-        std::string after = pos->ToString();
-        LOG_INFO << "[AutoOpenClose]["
-            << code << ", bs_flag: " << bs_flag << "] OnKnock: "
-            << "oc_flag: " << oc_flag
-            << ", order_no: " << knock.order_no
-            << ", match_no: " << knock.match_no
-            << ", match_type: " << knock.match_type
-            << ", match_volume: " << knock.match_volume
-            << ", before " << before << ", after " << after;
+}
+
+void InnerFutureMaster::InitEntry(std::string_view code, Entry* entry, const MemTradePosition& position) {
+    InnerFuturePositionPtr long_pos = &entry->long_pos;
+    InnerFuturePositionPtr short_pos = &entry->short_pos;
+    long_pos->yd_init_volume_ = position.long_pre_volume;
+    long_pos->td_init_volume_ = position.long_volume - position.long_pre_volume;
+    short_pos->yd_init_volume_ = position.short_pre_volume;
+    short_pos->td_init_volume_ = position.short_volume - position.short_pre_volume;
+    if (long_pos->product_index_ >= 0) {
+        products_[long_pos->product_index_].open_volume += long_pos->td_init_volume_ + short_pos->td_init_volume_;
     }
 }
 
-void InnerFutureMaster::Update(InnerFuturePositionPtr pos, int64_t oc_flag, int64_t order_volume, int64_t match_volume, int64_t withdraw_volume) {
+std::pair<int64_t, int64_t> InnerFutureMaster::Holding(const Entry& entry) const {
+    return {entry.long_pos.GetTotalVolume(), entry.short_pos.GetTotalVolume()};
+}
+
+std::pair<int64_t, int64_t> InnerFutureMaster::Holding(const MemTradePosition& position) const {
+    return {position.long_volume, position.short_volume};
+}
+
+void InnerFutureMaster::Correct(Entry* entry, const HoldingPair& diff) {
+    entry->long_pos.yd_init_volume_ += diff.first;
+    entry->short_pos.yd_init_volume_ += diff.second;
+}
+
+void InnerFutureMaster::Update(std::string_view code, InnerFuturePositionPtr pos, int64_t bs_flag, int64_t oc_flag,
+                               int64_t order_volume, int64_t match_volume, int64_t withdraw_volume) {
     if (!pos) {
         return;
     }
@@ -222,20 +137,18 @@ void InnerFutureMaster::Update(InnerFuturePositionPtr pos, int64_t oc_flag, int6
                 pos->td_opening_volume_ -= withdraw_volume;
             }
         }
-        // 风控策略：更新当前期货类型的已开仓数和开仓冻结数之和
-        if (forbid_closing_today_ && pos->marker_ == co::kMarketCFFEX) {
-            string code = pos->code_;
-            if (code.length() > kCFFEXOptionLength) {
-                return;
+        // 风控策略：按品种编号更新中金所品种的开仓冻结数和已开仓数；启动前的委托在启动后成交或撤单时没有冻结可减
+        if (pos->product_index_ >= 0) {
+            CffexProductCounter& counter = products_[pos->product_index_];
+            if (order_volume > 0) {
+                counter.opening_volume += order_volume;
             }
-            string type = code.length() > 2 ? code.substr(0, 2) : "";
-            if (auto it = open_cache_.find(type); it != open_cache_.end()) {
-                if (order_volume > 0) {
-                    it->second += order_volume;
-                }
-                if (withdraw_volume > 0) {
-                    it->second -= order_volume;
-                }
+            if (match_volume > 0) {
+                counter.opening_volume -= std::min(match_volume, counter.opening_volume);
+                counter.open_volume += match_volume;
+            }
+            if (withdraw_volume > 0) {
+                counter.opening_volume -= std::min(withdraw_volume, counter.opening_volume);
             }
         }
         break;
@@ -333,6 +246,24 @@ void InnerFutureMaster::Update(InnerFuturePositionPtr pos, int64_t oc_flag, int6
 }
 
 int64_t InnerFutureMaster::GetAutoOcFlag(int64_t bs_flag, const MemTradeOrder& order) {
+    std::string_view code = order.code;
+    // 没有持仓时新建，默认开仓, 如果是股指，继续检查开仓数量
+    auto entry = GetEntry(code);
+    int64_t ret_oc_flag = ResolveOcFlag(entry, code, bs_flag, order);
+    if (order.oc_flag == co::kOcFlagAuto) {
+        InnerFuturePositionPtr pos = bs_flag == kBsFlagBuy ? &entry->short_pos : &entry->long_pos;
+        LOG_INFO << "[AutoOpenClose]["
+                 << code
+                 << ", bs_flag: " << bs_flag
+                 << ", volume: " << order.volume
+                 << ", oc_flag: " << order.oc_flag<< "] GetAutoOcFlag: "
+                 << "ret oc_flag: " << ret_oc_flag
+                 << ", " << pos->ToString(code);
+    }
+    return ret_oc_flag;
+}
+
+int64_t InnerFutureMaster::ResolveOcFlag(Entry* entry, std::string_view code, int64_t bs_flag, const MemTradeOrder& order) {
 //    中金所开平逻辑：
 //    1 有昨仓，则平
 //    2 有昨仓，且今天开过仓，则平。强制是强平指令， 也会转为开
@@ -347,35 +278,23 @@ int64_t InnerFutureMaster::GetAutoOcFlag(int64_t bs_flag, const MemTradeOrder& o
 //    1 有今仓，则平仓
 //    2 有昨仓，则平仓
 //    3 今仓 + 昨仓 > order_volume，则平仓
-    string code = order.code;
     int64_t market = order.market;
     if (market == 0) {
-        market = co::CodeToMarket(code);
+        market = entry->long_pos.marker_;  // 新建表项时已从证券代码字典取得市场
     }
     int64_t order_volume = order.volume;
     int64_t ret_oc_flag = kOcFlagOpen;  // 默认开仓
-    auto itr_acc = positions_.find(code);
-    if (itr_acc == positions_.end()) {
-        // 没有持仓，默认开仓, 如果是股指，继续检查开仓数量
-        GetPosition(code, bs_flag, kOcFlagOpen);
-        itr_acc = positions_.find(code);
-    }
     InnerFuturePositionPtr pos;
     if (bs_flag == kBsFlagBuy) {
-        pos = itr_acc->second->second;  // 买时，先找到对应的空头
+        pos = &entry->short_pos;  // 买时，先找到对应的空头
     } else {
-        pos = itr_acc->second->first;   // 卖时，先找到对应的多头
+        pos = &entry->long_pos;   // 卖时，先找到对应的多头
     }
     int64_t yd_available_pos = pos->GetYesterdayAvailableVolume();
     int64_t td_available_pos = pos->GetTodayAvailableVolume();
 
     if (market == kMarketCFFEX) {
-        // 风控策略：限制股指期货当日开仓数量
-        string type = code.length() > 2 ? code.substr(0, 2) : "";
-        int64_t open_volume = 0;  // 当前期货类型的已开仓数和开仓冻结数之和
-        if (auto it = open_cache_.find(type); it != open_cache_.end()) {
-            open_volume = it->second;
-        }
+        int64_t open_volume = GetTodayOpenVolume(*pos);
         // 自动开平
         if (order.oc_flag == co::kOcFlagAuto) {
             if (open_volume == 0 && yd_available_pos >= order_volume) {
@@ -388,14 +307,8 @@ int64_t InnerFutureMaster::GetAutoOcFlag(int64_t bs_flag, const MemTradeOrder& o
             }
         }
         // 最后一步，检查开仓数量
-        if (max_today_opening_volume_ >= 0 && ret_oc_flag == kOcFlagOpen) {
-            if (order_volume + open_volume > max_today_opening_volume_) {
-                stringstream ss;
-                ss << "[当日开仓数限制]自动开平检查失败，委托数:" << order_volume << "，已开仓:" << open_volume << "，最大开仓数限制:"
-                   << max_today_opening_volume_;
-                string str = ss.str();
-                throw runtime_error(str);
-            }
+        if (ret_oc_flag == kOcFlagOpen) {
+            CheckOpenVolume(*pos, order_volume);
         }
     } else {
         if (order.oc_flag == co::kOcFlagAuto) {  // 自动开平
@@ -414,61 +327,62 @@ int64_t InnerFutureMaster::GetAutoOcFlag(int64_t bs_flag, const MemTradeOrder& o
             ret_oc_flag = order.oc_flag;
         }
     }
-    if (order.oc_flag == co::kOcFlagAuto) {
-        LOG_INFO << "[AutoOpenClose]["
-                 << code
-                 << ", bs_flag: " << bs_flag
-                 << ", volume: " << order.volume
-                 << ", oc_flag: " << order.oc_flag<< "] GetAutoOcFlag: "
-                 << "ret oc_flag: " << ret_oc_flag
-                 << ", " << pos->ToString();
-    }
     return ret_oc_flag;
 }
 
+int64_t InnerFutureMaster::GetTodayOpenVolume(const InnerFuturePosition& pos) {
+    if (pos.product_index_ < 0 || !cffex().forbid_closing_today) {
+        return 0;
+    }
+    const CffexProductCounter& counter = products_[pos.product_index_];
+    return counter.index_future ? counter.total() : 0;
+}
+
+void InnerFutureMaster::CheckOpenVolume(const InnerFuturePosition& pos, int64_t order_volume) {
+    // 风控策略：限制中金所品种当日开仓数量，统计已开仓数和开仓冻结数之和；字典中没有的合约按单笔委托检查
+    int64_t max_open_volume = cffex().max_today_opening_volume;
+    int64_t open_volume = 0;
+    std::string_view product = pos.product();
+    if (pos.product_index_ >= 0) {
+        const CffexProductCounter& counter = products_[pos.product_index_];
+        max_open_volume = counter.max_open_volume;
+        open_volume = counter.total();
+    }
+    if (max_open_volume >= 0 && order_volume + open_volume > max_open_volume) {
+        stringstream ss;
+        ss << "[当日开仓数限制]自动开平检查失败，品种:" << product << "，委托数:" << order_volume << "，已开仓:" << open_volume
+           << "，最大开仓数限制:" << max_open_volume;
+        string str = ss.str();
+        throw runtime_error(str);
+    }
+}
+
 // 平昨仓,不平今仓, 如果昨仓数量不足,就开仓
 int64_t InnerFutureMaster::GetCloseYesterdayFlag(int64_t bs_flag, const MemTradeOrder& order) {
-    string code = order.code;
-    int64_t market = order.market;
-    if (market == 0) {
-        market = co::CodeToMarket(code);
-    }
+    std::string_view code = order.code;
     int64_t order_volume = order.volume;
     int64_t ret_oc_flag = kOcFlagOpen;  // 默认开仓
-    auto itr_acc = positions_.find(code);
-    if (itr_acc == positions_.end()) {
-        // 没有持仓，默认开仓, 如果是股指，继续检查开仓数量
-        GetPosition(code, bs_flag, kOcFlagOpen);
-        itr_acc = positions_.find(code);
-    }
+    // 没有持仓时新建，默认开仓, 如果是股指，继续检查开仓数量
+    auto entry = GetEntry(code);
     InnerFuturePositionPtr pos;
     if (bs_flag == kBsFlagBuy) {
-        pos = itr_acc->second->second;  // 买时，先找到对应的空头
+        pos = &entry->short_pos;  // 买时，先找到对应的空头
     } else {
-        pos = itr_acc->second->first;   // 卖时，先找到对应的多头
+        pos = &entry->long_pos;   // 卖时，先找到对应的多头
+    }
+    int64_t market = order.market;
+    if (market == 0) {
+        market = pos->marker_;
     }
     int64_t yd_available_pos = pos->GetYesterdayAvailableVolume();
 
     if (market == kMarketCFFEX) {
-        // 风控策略：限制股指期货当日开仓数量
-        string type = code.length() > 2 ? code.substr(0, 2) : "";
-        int64_t open_volume = 0;  // 当前期货类型的已开仓数和开仓冻结数之和
-        if (auto it = open_cache_.find(type); it != open_cache_.end()) {
-            open_volume = it->second;
-        }
-
-        if (open_volume == 0 && yd_available_pos >= order_volume) {
+        if (GetTodayOpenVolume(*pos) == 0 && yd_available_pos >= order_volume) {
             ret_oc_flag = kOcFlagClose;
         }
         // 最后一步，检查开仓数量
-        if (max_today_opening_volume_ >= 0 && ret_oc_flag == kOcFlagOpen) {
-            if (order_volume + open_volume > max_today_opening_volume_) {
-                stringstream ss;
-                ss << "[当日开仓数限制]自动开平检查失败，委托数:" << order_volume << "，已开仓:" << open_volume << "，最大开仓数限制:"
-                   << max_today_opening_volume_;
-                string str = ss.str();
-                throw runtime_error(str);
-            }
+        if (ret_oc_flag == kOcFlagOpen) {
+            CheckOpenVolume(*pos, order_volume);
         }
     } else {
         if (yd_available_pos >= order_volume) {
@@ -483,47 +397,23 @@ int64_t InnerFutureMaster::GetCloseYesterdayFlag(int64_t bs_flag, const MemTrade
              << code << ", bs_flag: " << bs_flag << "] GetAutoOcFlag: "
              << "oc_flag: " << ret_oc_flag
              << ", order_volume: " << order.volume
-             << ", " << pos->ToString();
+             << ", " << pos->ToString(code);
     return ret_oc_flag;
 }
 
-bool InnerFutureMaster::IsAccountInitialized() {
-    return init_flag_;
-}
-
 // 除了开仓，强平、平今、平昨、强减、本地强平都认为是平仓
-InnerFuturePositionPtr InnerFutureMaster::GetPosition(std::string code, int64_t bs_flag, int64_t oc_flag) {
+InnerFuturePositionPtr InnerFutureMaster::GetPosition(std::string_view code, int64_t bs_flag, int64_t oc_flag) {
     // 买开和卖平（更新买持仓), 卖开和买平（更新卖持仓
-    bool long_flag = false;
-    if (bs_flag == kBsFlagBuy) {
-        if (oc_flag == kOcFlagOpen) {
-            long_flag = true;
-        }
-    } else {
-        if (oc_flag == kOcFlagOpen) {
-            long_flag = false;
-        } else {
-            long_flag = true;
-        }
-    }
-    InnerFuturePositionPtr pos = nullptr;
-    std::shared_ptr<std::pair<InnerFuturePositionPtr, InnerFuturePositionPtr>> pair = nullptr;
-    auto itr_acc = positions_.find(code);
-    if (itr_acc != positions_.end()) {
-        pair = itr_acc->second;
-    } else {
-        InnerFuturePositionPtr long_pos = std::make_shared<InnerFuturePosition>(code, kBsFlagBuy);
-        InnerFuturePositionPtr short_pos = std::make_shared<InnerFuturePosition>(code, kBsFlagSell);
-        pair = std::make_shared<std::pair<InnerFuturePositionPtr, InnerFuturePositionPtr>>();
-        pair->first = long_pos;
-        pair->second = short_pos;
-        positions_[code] = pair;
-    }
-    if (long_flag) {
-        pos = pair->first;
-    } else {
-        pos = pair->second;
+    auto entry = GetEntry(code);
+    bool long_flag = bs_flag == kBsFlagBuy ? oc_flag == kOcFlagOpen : oc_flag != kOcFlagOpen;
+    return long_flag ? &entry->long_pos : &entry->short_pos;
+}
+
+InnerFuturePositionPtr InnerFutureMaster::SelectPosition(Entry* entry, int64_t bs_flag, int64_t oc_flag) {
+    if (oc_flag <= 0) {
+        return nullptr;
     }
-    return pos;
+    bool long_flag = bs_flag == kBsFlagBuy ? oc_flag == kOcFlagOpen : oc_flag != kOcFlagOpen;
+    return long_flag ? &entry->long_pos : &entry->short_pos;
 }
-}  // namespace co
\ No newline at end of file
+}  // namespace co
@@ -3,30 +3,49 @@
 #include "x/x.h"
 #include "coral/coral.h"
 #include "mem_struct.h"
+#include "inner_master_base.h"
+#include "../risker/config_service.h"
+#include "../risker/common/instrument_dict.h"
 
 namespace co {
-struct InnerFuturePosition {
-    InnerFuturePosition(std::string code, int64_t bs_flag) : code_(code) {
-        if (bs_flag == kBsFlagBuy) {
-            tag_ = "多头持仓";
-        } else {
-            tag_ = "空头持仓";
-        }
-        marker_ = co::CodeToMarket(code);
+// 中金所单个品种的当日开仓统计，品种第一次出现时分配编号
+struct CffexProductCounter {
+    // 已开仓数 + 开仓冻结数
+    [[nodiscard]] inline int64_t total() const {
+        return open_volume + opening_volume;
     }
 
-    int64_t GetYesterdayAvailableVolume() {
+    char product[8] = "";           // 品种代码，如IF、T、IO
+    bool index_future = false;      // 股指期货，适用max_today_opening_volume和禁止平今
+    int64_t opening_volume = 0;     // 开仓冻结数
+    int64_t open_volume = 0;        // 已开仓数，包括broker启动时的今仓
+    int64_t max_open_volume = -1;   // 当日最大开仓数，-1-不限制
+};
+
+// 单个方向的持仓，证券代码保存在持仓表中
+struct InnerFuturePosition {
+    int64_t GetYesterdayAvailableVolume() const {
         return (yd_init_volume_ - yd_closing_volume_ - yd_close_volume_);
     }
 
-    int64_t GetTodayAvailableVolume() {
+    int64_t GetTodayAvailableVolume() const {
         return (td_init_volume_ +  td_open_volume_ - td_closing_volume_ - td_close_volume_);
     }
 
-    std::string ToString() {
+    // 总持仓，包括平仓冻结数
+    int64_t GetTotalVolume() const {
+        return (yd_init_volume_ - yd_close_volume_ + td_init_volume_ + td_open_volume_ - td_close_volume_);
+    }
+
+    // 品种代码，如IF、IH
+    std::string_view product() const {
+        return instrument_ ? instrument_->product_view() : std::string_view();
+    }
+
+    std::string ToString(std::string_view code) const {
         std::stringstream ss;
         ss << "InnerPosition{";
-        ss << "code: " << code_ << ", " << tag_
+        ss << "code: " << code << ", " << (bs_flag_ == kBsFlagBuy ? "多头持仓" : "空头持仓")
            << ", yd_init_volume: " << yd_init_volume_
            << ", yd_closing_volume: " << yd_closing_volume_
            << ", yd_close_volume: " << yd_close_volume_
@@ -38,9 +57,10 @@ struct InnerFuturePosition {
         return ss.str();
     }
 
-    std::string code_;
-    int64_t marker_;
-    std::string tag_;               // 多头持仓, 空头持仓
+    const Instrument* instrument_ = nullptr;  // 证券代码字典中的记录
+    int32_t marker_ = 0;
+    int32_t product_index_ = -1;     // 中金所品种编号，其他市场为-1
+    int32_t bs_flag_ = 0;            // 多头持仓, 空头持仓
     int64_t yd_init_volume_ = 0;     // broker启动时的昨日持仓, 有平仓交易后 会变小
     int64_t yd_closing_volume_ = 0;  // 昨日持仓平仓冻结数
     int64_t yd_close_volume_ = 0;    // 昨日持仓已平仓数
@@ -51,34 +71,53 @@ struct InnerFuturePosition {
     int64_t td_opening_volume_ = 0;  // 今日持仓开仓冻结数, 只显示，没有作用
     int64_t td_open_volume_ = 0;     // 今日已开仓数
 };
-typedef std::shared_ptr<InnerFuturePosition> InnerFuturePositionPtr;
+typedef InnerFuturePosition* InnerFuturePositionPtr;
+
+class InnerFutureMaster : public InnerMasterBase<InnerFutureMaster, InnerFuturePosition> {
+    friend class InnerMasterBase<InnerFutureMaster, InnerFuturePosition>;
 
-class InnerFutureMaster {
  public:
-    InnerFutureMaster() = default;
+    static constexpr const char* kName = "future";
+    static constexpr const char* kHoldingNames[2] = {"long_volume", "short_volume"};
 
-    void InitPositions(MemGetTradePositionMessage* rep);
-    void HandleOrderReq(int64_t bs_flag, const MemTradeOrder& order);
-    void HandleOrderRep(int64_t bs_flag, const MemTradeOrder& order);
-    void HandleKnock(const MemTradeKnock& knock);
+    InnerFutureMaster() = default;
 
     int64_t GetAutoOcFlag(int64_t bs_flag, const MemTradeOrder& order);
     int64_t GetCloseYesterdayFlag(int64_t bs_flag, const MemTradeOrder& order);
-    InnerFuturePositionPtr GetPosition(std::string code, int64_t bs_flag, int64_t oc_flag);
+    InnerFuturePositionPtr GetPosition(std::string_view code, int64_t bs_flag, int64_t oc_flag);
+    // 中金所品种的当日开仓统计，品种未出现过时返回nullptr
+    const CffexProductCounter* GetCffexProduct(std::string_view product) const;
 
  protected:
-    void InitCffexParam();
-    bool IsAccountInitialized();
-    void Update(InnerFuturePositionPtr pos, int64_t oc_flag, int64_t order_volume, int64_t match_volume, int64_t withdraw_volume);
+    // 股指期货参数，配置文件修改后在下一笔委托生效
+    const CffexConfig& cffex();
+    void OnInit();
+    void OnCreate(std::string_view code, Entry* entry);
+    void InitEntry(std::string_view code, Entry* entry, const MemTradePosition& position);
+    // 总持仓，包括平仓冻结数
+    std::pair<int64_t, int64_t> Holding(const Entry& entry) const;
+    std::pair<int64_t, int64_t> Holding(const MemTradePosition& position) const;
+    // 差额计入昨仓，不影响股指期货的当日开仓数
+    void Correct(Entry* entry, const HoldingPair& diff);
+    // 除了开仓，强平、平今、平昨、强减、本地强平都认为是平仓；没有开平标记时不更新
+    InnerFuturePositionPtr SelectPosition(Entry* entry, int64_t bs_flag, int64_t oc_flag);
+    // 根据持仓确定开平标记，不输出日志
+    int64_t ResolveOcFlag(Entry* entry, std::string_view code, int64_t bs_flag, const MemTradeOrder& order);
+    void Update(std::string_view code, InnerFuturePositionPtr pos, int64_t bs_flag, int64_t oc_flag, int64_t order_volume, int64_t match_volume, int64_t withdraw_volume);
 
  private:
-    bool init_flag_ = false;
-    std::map<std::string, std::shared_ptr<std::pair<InnerFuturePositionPtr, InnerFuturePositionPtr>>> positions_;  // <code> -> first is buy, second is sell
-    std::set<std::string> knocks_;  // <inner_match_no>
+    // 品种编号，新品种追加到末尾；只在新建表项时调用
+    int32_t GetProductIndex(const Instrument* instrument);
+    // 品种的当日最大开仓数：product_limits优先，其次股指期货使用max_today_opening_volume
+    static int64_t GetMaxOpenVolume(const CffexConfig& config, const CffexProductCounter& counter);
+    // 禁止平今时，品种当日开过仓就不能再平昨仓
+    int64_t GetTodayOpenVolume(const InnerFuturePosition& pos);
+    // 开仓数超过当日最大开仓数时抛出异常
+    void CheckOpenVolume(const InnerFuturePosition& pos, int64_t order_volume);
 
-    bool forbid_closing_today_ = false;  // 风控策略：禁止股指期货自动开平仓时平今仓
-    int64_t max_today_opening_volume_ = 0;  // 风控策略：限制股指期货当日最大开仓数
-    std::map<string, int64_t> open_cache_;  // 合约类型（IF、IH、IC） -> 已开仓数 + 开仓冻结数，用于限制当日最大开仓数
+ private:
+    ConfigSnapshot config_;  // 风控策略：禁止股指期货自动开平仓时平今仓、限制中金所品种当日最大开仓数
+    std::vector<CffexProductCounter> products_;  // 中金所品种编号 -> 当日开仓统计，用于限制当日最大开仓数
 };
 typedef std::shared_ptr<InnerFutureMaster> InnerFutureMasterPtr;
 }  // namespace co
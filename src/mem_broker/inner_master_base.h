@@ -0,0 +1,352 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "x/x.h"
+#include "coral/coral.h"
+#include "mem_struct.h"
+#include "position_table.h"
+#include "position_reconciler.h"
+#include "position_view.h"
+#include "../risker/common/instrument_dict.h"
+
+namespace co {
+/**
+ * 内部持仓管理的公共流程：初始化、核对、委托冻结、废单解冻、成交撤单和篮子委托。
+ * 派生类是资产类别的策略（CRTP），在编译期提供持仓字段和开平规则，每种账户类型各自实例化一份，
+ * 热点路径上没有虚函数调用，也不再按账户类型分支。派生类需要提供：
+ *   InitEntry(code, entry, position)   用柜台持仓初始化表项
+ *   Holding(entry) / Holding(position)   核对时比较和只读视图发布的两个数量，kHoldingNames为对应的字段名
+ *   SelectPosition(entry, bs_flag, oc_flag)   委托和成交更新的持仓，不需要更新时返回nullptr
+ *   ResolveOcFlag(entry, code, bs_flag, order)   确定开平标记，不输出日志，失败时抛出异常
+ *   Update(code, pos, bs_flag, oc_flag, order_volume, match_volume, withdraw_volume)
+ *   Correct(entry, diff)   核对不一致时按柜台修正初始持仓，diff为柜台与内部的差
+ * 以及可选的OnInit（清空持仓前调用）和OnCreate（新建表项时调用）。
+ */
+template <typename Derived, typename Position, typename EntryType = PositionPair<Position>>
+class InnerMasterBase {
+ public:
+    using Entry = EntryType;
+
+    // 更新初始持仓
+    void InitPositions(MemGetTradePositionMessage* rep) {
+        LOG_INFO << "set init " << Derived::kName << " position, size: " << rep->items_size;
+        derived()->OnInit();
+        positions_.Clear();
+        instrument_ids_.clear();
+        dirty_flags_.clear();
+        dirty_.clear();
+        if (view_.is_open()) {
+            view_.Clear();
+        }
+        for (int i = 0; i < rep->items_size; i++) {
+            MemTradePosition* position = rep->items + i;
+            std::string_view code = position->code;
+            int32_t index = 0;
+            derived()->InitEntry(code, GetEntry(code, &index), *position);
+            PublishView(index);
+        }
+        init_flag_ = true;
+        LOG_INFO << "[AutoOpenClose] OnInit";
+        for (int32_t id = 0; id < positions_.size(); ++id) {
+            LogEntry(positions_.code(id), *positions_.At(id));
+        }
+    }
+
+    // 核对柜台返回的持仓，返回不一致的代码个数
+    int64_t Reconcile(MemGetTradePositionMessage* rep) {
+        int64_t mismatches = 0;
+        std::set<std::string_view> codes;
+        for (int i = 0; i < rep->items_size; i++) {
+            MemTradePosition* position = rep->items + i;
+            codes.insert(position->code);
+            auto entry = positions_.Find(position->code);
+            auto inner = entry ? derived()->Holding(*entry) : std::pair<int64_t, int64_t>();
+            auto broker = derived()->Holding(*position);
+            if (inner != broker) {
+                ++mismatches;
+                LOG_WARN << "[AutoOpenClose][" << position->code << "] reconcile mismatch, "
+                         << Derived::kHoldingNames[0] << ": " << inner.first << " -> " << broker.first << ", "
+                         << Derived::kHoldingNames[1] << ": " << inner.second << " -> " << broker.second;
+            }
+        }
+        for (int32_t id = 0; id < positions_.size(); ++id) {
+            const std::string& code = positions_.code(id);
+            auto inner = derived()->Holding(*positions_.At(id));
+            if (codes.find(code) == codes.end() && (inner.first != 0 || inner.second != 0)) {
+                ++mismatches;
+                LOG_WARN << "[AutoOpenClose][" << code << "] reconcile mismatch, not found in broker, "
+                         << Derived::kHoldingNames[0] << ": " << inner.first << ", "
+                         << Derived::kHoldingNames[1] << ": " << inner.second;
+            }
+        }
+        return mismatches;
+    }
+
+    // 处理委托请求，冻结数量
+    void HandleOrderReq(int64_t bs_flag, const MemTradeOrder& order) {
+        if ((bs_flag != kBsFlagBuy && bs_flag != kBsFlagSell) || !IsAccountInitialized()) {
+            return;
+        }
+        std::string_view code = order.code;
+        int32_t index = 0;
+        if (Position* pos = derived()->SelectPosition(GetEntry(code, &index), bs_flag, order.oc_flag); pos) {
+            std::string before = pos->ToString(code);
+            derived()->Update(code, pos, bs_flag, order.oc_flag, order.volume, 0, 0);
+            MarkDirty(index);
+            LOG_INFO << "[AutoOpenClose]["
+                << code << ", bs_flag: " << bs_flag << "] OnOrderReq: "
+                << "oc_flag: " << order.oc_flag
+                << ", order_volume: " << order.volume
+                << ", before " << before << ", after " << pos->ToString(code);
+        }
+    }
+
+    // 处理委托废单响应，解冻数量
+    void HandleOrderRep(int64_t bs_flag, const MemTradeOrder& order) {
+        if (order.order_no[0] != '\0') {
+            return;
+        }
+        if ((bs_flag != kBsFlagBuy && bs_flag != kBsFlagSell) || !IsAccountInitialized()) {
+            return;
+        }
+        std::string_view code = order.code;
+        int32_t index = 0;
+        if (Position* pos = derived()->SelectPosition(GetEntry(code, &index), bs_flag, order.oc_flag); pos) {
+            std::string before = pos->ToString(code);
+            derived()->Update(code, pos, bs_flag, order.oc_flag, 0, 0, order.volume);
+            MarkDirty(index);
+            LOG_INFO << "[AutoOpenClose]["
+                << code << ", bs_flag: " << bs_flag << "] OnOrderRep: "
+                << "oc_flag: " << order.oc_flag
+                << ", withdraw_volume: " << order.volume
+                << ", before " << before << ", after " << pos->ToString(code);
+        }
+    }
+
+    // 成交回报已由MemBrokerServer按inner_match_no去重，这里不再检查
+    void HandleKnock(const MemTradeKnock& knock) {
+        int64_t bs_flag = knock.bs_flag;
+        if (knock.fund_id[0] == '\0' || knock.inner_match_no[0] == '\0' || knock.code[0] == '\0') {
+            return;
+        }
+        if ((bs_flag != kBsFlagBuy && bs_flag != kBsFlagSell) || knock.match_volume <= 0 || !IsAccountInitialized()) {
+            return;
+        }
+        int64_t match_volume = 0;
+        int64_t withdraw_volume = 0;
+        if (knock.match_type == kMatchTypeOK) {
+            match_volume = knock.match_volume;
+        } else if (knock.match_type == kMatchTypeWithdrawOK || knock.match_type == kMatchTypeFailed) {
+            withdraw_volume = knock.match_volume;
+        } else {
+            return;
+        }
+        std::string_view code = knock.code;
+        int32_t index = 0;
+        if (Position* pos = derived()->SelectPosition(GetEntry(code, &index), bs_flag, knock.oc_flag); pos) {
+            std::string before = pos->ToString(code);
+            derived()->Update(code, pos, bs_flag, knock.oc_flag, 0, match_volume, withdraw_volume);
+            MarkDirty(index);
+            LOG_INFO << "[AutoOpenClose]["
+                << code << ", bs_flag: " << bs_flag << "] OnKnock: "
+                << "oc_flag: " << knock.oc_flag
+                << ", order_no: " << knock.order_no
+                << ", match_no: " << knock.match_no
+                << ", match_type: " << knock.match_type
+                << ", match_volume: " << match_volume
+                << ", withdraw_volume: " << withdraw_volume
+                << ", before " << before << ", after " << pos->ToString(code);
+        }
+    }
+
+    // 篮子委托：逐笔确定开平标记并冻结，同一代码的后续委托可以看到前面委托的冻结，只输出一条汇总日志；
+    // 返回冻结的委托个数，失败时error返回原因，并按相反顺序撤销前面已冻结的委托，整个篮子不冻结，返回0
+    int64_t HandleBasketReq(int64_t bs_flag, MemTradeOrder* orders, int64_t size, std::string* error) {
+        bool freeze = (bs_flag == kBsFlagBuy || bs_flag == kBsFlagSell) && IsAccountInitialized();
+        int64_t open_size = 0;
+        int64_t close_size = 0;
+        int64_t total_volume = 0;
+        int64_t i = 0;
+        try {
+            for (; i < size; ++i) {
+                MemTradeOrder* order = orders + i;
+                std::string_view code = order->code;
+                int32_t index = 0;
+                auto entry = GetEntry(code, &index);  // 同一笔委托只查找一次持仓
+                order->oc_flag = derived()->ResolveOcFlag(entry, code, bs_flag, *order);
+                if (freeze) {
+                    if (Position* pos = derived()->SelectPosition(entry, bs_flag, order->oc_flag); pos) {
+                        derived()->Update(code, pos, bs_flag, order->oc_flag, order->volume, 0, 0);
+                        MarkDirty(index);
+                    }
+                }
+                if (order->oc_flag == kOcFlagOpen) {
+                    ++open_size;
+                } else {
+                    ++close_size;
+                }
+                total_volume += order->volume;
+            }
+        } catch (std::exception& e) {
+            *error = e.what();
+            if (error->empty()) {
+                *error = "[FAN-BROKER-ERROR] EmptyError";
+            }
+        }
+        LOG_INFO << "[AutoOpenClose] OnBasketReq: bs_flag: " << bs_flag
+                 << ", items: " << size
+                 << ", handled: " << i
+                 << ", open: " << open_size
+                 << ", close: " << close_size
+                 << ", volume: " << total_volume
+                 << (error->empty() ? "" : ", error: ") << *error;
+        if (error->empty()) {
+            return i;
+        }
+        if (freeze) {
+            for (int64_t j = i - 1; j >= 0; --j) {
+                MemTradeOrder* order = orders + j;
+                std::string_view code = order->code;
+                int32_t index = 0;
+                if (Position* pos = derived()->SelectPosition(GetEntry(code, &index), bs_flag, order->oc_flag); pos) {
+                    derived()->Update(code, pos, bs_flag, order->oc_flag, 0, 0, order->volume);
+                    MarkDirty(index);
+                }
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * 增量核对：柜台持仓和内部持仓都按证券代码字典的编号记录，只比较柜台持仓有变化、上次核对后内部持仓有更新，
+     * 以及尚未恢复一致的代码。确认不一致时调用emit(instrument, inner, broker, corrected)，
+     * correct为true时以柜台为准修正内部初始持仓。返回本次比较的代码个数。
+     */
+    template <typename Emit>
+    int64_t Reconcile(PositionReconciler* reconciler, MemGetTradePositionMessage* rep, bool correct, Emit&& emit) {
+        if (!IsAccountInitialized()) {
+            return 0;
+        }
+        InstrumentDict* dict = InstrumentDict::Instance();
+        reconciler->BeginCycle();
+        for (int i = 0; i < rep->items_size; i++) {
+            MemTradePosition* position = rep->items + i;
+            if (const Instrument* instrument = dict->Get(position->code); instrument) {
+                reconciler->SetBroker(instrument->id, derived()->Holding(*position));
+            }
+        }
+        reconciler->EndBroker();
+        for (int32_t index : dirty_) {
+            dirty_flags_[index] = false;
+            if (instrument_ids_[index] >= 0) {
+                reconciler->Mark(instrument_ids_[index]);
+            }
+        }
+        dirty_.clear();
+        return reconciler->Compare([&](int32_t id) {
+            auto entry = positions_.Find(dict->At(id)->code);
+            return entry ? derived()->Holding(*entry) : HoldingPair();
+        }, [&](int32_t id, const HoldingPair& inner, const HoldingPair& broker) {
+            const Instrument* instrument = dict->At(id);
+            LOG_WARN << "[AutoOpenClose][" << instrument->code << "] reconcile mismatch, "
+                     << Derived::kHoldingNames[0] << ": " << inner.first << " -> " << broker.first << ", "
+                     << Derived::kHoldingNames[1] << ": " << inner.second << " -> " << broker.second
+                     << (correct ? ", correct inner position" : "");
+            if (correct) {
+                int32_t index = 0;
+                derived()->Correct(GetEntry(instrument->code, &index), HoldingPair(broker.first - inner.first, broker.second - inner.second));
+                PublishView(index);
+            }
+            emit(instrument, inner, broker, correct);
+            return correct;
+        });
+    }
+
+    /**
+     * 打开内部持仓的只读视图，filename为空时使用匿名内存；之后每次更新持仓都发布Holding(entry)，
+     * 其它线程和进程无锁读取。只能在调度线程调用。
+     */
+    void OpenView(const std::string& filename) {
+        view_.Open(filename, Derived::kName, Derived::kHoldingNames);
+        for (int32_t id = 0; id < positions_.size(); ++id) {
+            PublishView(id);
+        }
+    }
+
+    [[nodiscard]] inline const PositionView& view() const {
+        return view_;
+    }
+
+    [[nodiscard]] inline bool IsAccountInitialized() const {
+        return init_flag_;
+    }
+
+ protected:
+    // 不存在时新建表项，index返回表项编号
+    Entry* GetEntry(std::string_view code, int32_t* index = nullptr) {
+        bool created = false;
+        int32_t id = 0;
+        Entry* entry = positions_.Get(code, &created, &id);
+        if (created) {
+            const Instrument* instrument = InstrumentDict::Instance()->Get(code);
+            instrument_ids_.push_back(instrument ? instrument->id : -1);
+            dirty_flags_.resize(instrument_ids_.size());
+            MarkDirty(id);
+            derived()->OnCreate(code, entry);
+        }
+        if (index) {
+            *index = id;
+        }
+        return entry;
+    }
+
+    // 内部持仓有更新，下次核对时比较
+    inline void MarkDirty(int32_t index) {
+        if (!dirty_flags_[index]) {
+            dirty_flags_[index] = true;
+            dirty_.push_back(index);
+        }
+        PublishView(index);
+    }
+
+    // 发布到只读视图，视图没有打开时不做任何事
+    inline void PublishView(int32_t index) {
+        if (view_.is_open()) {
+            view_.Publish(index, positions_.code(index), derived()->Holding(*positions_.At(index)));
+        }
+    }
+
+    void OnInit() {
+    }
+
+    void OnCreate(std::string_view code, Entry* entry) {
+    }
+
+    static void LogEntry(std::string_view code, const PositionPair<Position>& entry) {
+        LOG_INFO << code << ", long:  " << entry.long_pos.ToString(code);
+        LOG_INFO << code << ", short: " << entry.short_pos.ToString(code);
+    }
+
+    static void LogEntry(std::string_view code, const Position& pos) {
+        LOG_INFO << code << ", " << pos.ToString(code);
+    }
+
+ protected:
+    bool init_flag_ = false;
+    PositionTable<Position, Entry> positions_;  // <code> -> 持仓
+    std::vector<int32_t> instrument_ids_;  // 表项编号 -> 证券代码字典编号，无法识别的代码为-1
+    std::vector<char> dirty_flags_;  // 表项编号 -> 是否在dirty_中
+    std::vector<int32_t> dirty_;  // 上次核对后有更新的表项
+    PositionView view_;  // 内部持仓的只读视图，按表项编号发布
+
+ private:
+    inline Derived* derived() {
+        return static_cast<Derived*>(this);
+    }
+};
+}  // namespace co
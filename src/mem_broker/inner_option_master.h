@@ -3,25 +3,19 @@
 #include "x/x.h"
 #include "coral/coral.h"
 #include "mem_struct.h"
+#include "inner_master_base.h"
 
 namespace co {
+// 单个方向的持仓，证券代码保存在持仓表中
 struct InnerOptionPosition {
-    InnerOptionPosition(std::string code, int64_t bs_flag) : code_(code) {
-        if (bs_flag == kBsFlagBuy) {
-            tag_ = "多头持仓";
-        } else {
-            tag_ = "空头持仓";
-        }
-    }
-
-    int64_t GetAvailableVolume() {
+    int64_t GetAvailableVolume() const {
         return (init_volume_ + open_volume_ - closing_volume_ - close_volume_);
     }
 
-    std::string ToString() {
+    std::string ToString(std::string_view code) const {
         std::stringstream ss;
         ss << "InnerPosition{";
-        ss << "code: " << code_ << ", " << tag_
+        ss << "code: " << code << ", " << (bs_flag_ == kBsFlagBuy ? "多头持仓" : "空头持仓")
            << ", init_volume: " << init_volume_
            << ", closing_volume: " << closing_volume_
            << ", close_volume: " << close_volume_
@@ -31,37 +25,37 @@ struct InnerOptionPosition {
         return ss.str();
     }
 
-    std::string code_;
-    std::string tag_;               // 多头持仓, 空头持仓
+    int64_t bs_flag_ = 0;           // 多头持仓, 空头持仓
     int64_t init_volume_ = 0;       // 今天初始可用持仓， 一直不变
     int64_t closing_volume_ = 0;    // 今日持仓平仓冻结数
     int64_t close_volume_ = 0;      // 今日持仓已平仓数
     int64_t opening_volume_ = 0;    // 今日持仓开仓冻结数
     int64_t open_volume_ = 0;       // 今日持仓已开仓数
 };
-typedef std::shared_ptr<InnerOptionPosition> InnerOptionPositionPtr;
+typedef InnerOptionPosition* InnerOptionPositionPtr;
+
+class InnerOptionMaster : public InnerMasterBase<InnerOptionMaster, InnerOptionPosition> {
+    friend class InnerMasterBase<InnerOptionMaster, InnerOptionPosition>;
 
-class InnerOptionMaster {
  public:
+    static constexpr const char* kName = "option";
+    static constexpr const char* kHoldingNames[2] = {"long_can_close", "short_can_close"};
+
     InnerOptionMaster() = default;
-    // 更新初始持仓
-    void InitPositions(MemGetTradePositionMessage* rep);
-    // 更新委托和成交
-    void HandleOrderReq(int64_t bs_flag, const MemTradeOrder& order);
-    void HandleOrderRep(int64_t bs_flag, const MemTradeOrder& order);
-    void HandleKnock(const MemTradeKnock& knock);
 
     int64_t GetAutoOcFlag(int64_t bs_flag, const MemTradeOrder& order);
-    InnerOptionPositionPtr GetPosition(std::string code, int64_t bs_flag);
+    InnerOptionPositionPtr GetPosition(std::string_view code, int64_t bs_flag);
 
  protected:
-    bool IsAccountInitialized();
-    void Update(InnerOptionPositionPtr pos, int64_t oc_flag, int64_t order_volume, int64_t match_volume, int64_t withdraw_volume);
-
- private:
-    bool init_flag_ = false;
-    std::map<std::string, std::shared_ptr<std::pair<InnerOptionPositionPtr, InnerOptionPositionPtr>>> positions_;  // <code> -> first is buy, second is sell
-    std::set<std::string> knocks_;  // <inner_match_no>
+    void InitEntry(std::string_view code, Entry* entry, const MemTradePosition& position);
+    std::pair<int64_t, int64_t> Holding(const Entry& entry) const;
+    std::pair<int64_t, int64_t> Holding(const MemTradePosition& position) const;
+    void Correct(Entry* entry, const HoldingPair& diff);
+    // 买开和卖平更新买持仓，卖开和买平更新卖持仓，其它开平标记不更新
+    InnerOptionPositionPtr SelectPosition(Entry* entry, int64_t bs_flag, int64_t oc_flag);
+    // 根据持仓确定自动开平标记，不是自动开平时返回原标记，不输出日志
+    int64_t ResolveOcFlag(Entry* entry, std::string_view code, int64_t bs_flag, const MemTradeOrder& order);
+    void Update(std::string_view code, InnerOptionPositionPtr pos, int64_t bs_flag, int64_t oc_flag, int64_t order_volume, int64_t match_volume, int64_t withdraw_volume);
 };
 typedef std::shared_ptr<InnerOptionMaster> InnerOptionMasterPtr;
 }  // namespace co
@@ -4,194 +4,98 @@
 namespace co {
 void InnerStockMaster::AddT0Code(const string& code) {
     t0_list_.insert(code);
+    // 已建立的持仓表项同步更新，可卖额度变化后重新发布
+    if (positions_.Find(code)) {
+        int32_t index = 0;
+        GetEntry(code, &index)->t0_ = true;
+        MarkDirty(index);
+    }
     LOG_INFO << "T+0 code: " << code;
 }
 
-void InnerStockMaster::InitPositions(MemGetTradePositionMessage* rep) {
-    LOG_INFO << "set init stock position";
-    init_flag_ = true;
-    if (rep->items_size > 0) {
-        auto first = (MemTradePosition*)((char*)rep + sizeof(MemGetTradePositionMessage));
-        for (int i = 0; i < rep->items_size; i++) {
-            MemTradePosition *position = first + i;
-            string code = position->code;
-            InnerStockPositionPtr pos = GetPosition(code);
-            // 普通卖的总额度
-            pos->init_sell_volume_ = position->long_can_close;
-            // 融券卖的总额度
-            pos->init_borrowed_volume_ = position->short_can_open;
-        }
-    }
-    LOG_INFO << "[AutoOpenClose] OnInit";
-    for (auto it : positions_) {
-        LOG_INFO << it.first << ", " << it.second->ToString();
-    }
+void InnerStockMaster::OnCreate(std::string_view code, Entry* entry) {
+    entry->t0_ = t0_list_.find(code) != t0_list_.end();
 }
 
-bool InnerStockMaster::IsT0Type(const std::string& code) {
-    bool type_flag = false;
-    if (t0_list_.find(code) != t0_list_.end()) {
-        type_flag = true;
-    }
-    return type_flag;
+void InnerStockMaster::InitEntry(std::string_view code, Entry* entry, const MemTradePosition& position) {
+    // 普通卖的总额度
+    entry->init_sell_volume_ = position.long_can_close;
+    // 融券卖的总额度
+    entry->init_borrowed_volume_ = position.short_can_open;
 }
 
-void InnerStockMaster::HandleOrderReq(int64_t bs_flag, const MemTradeOrder& order) {
-    // 处理委托请求，冻结数量
-    std::string code = order.code;
-    if (!IsAccountInitialized()) {
-        return;
-    }
-    InnerStockPositionPtr pos = GetPosition(code);
-    if (order.oc_flag == kOcFlagAuto && bs_flag == kBsFlagBuy) {
-        // 委托类型：正常买入
-        pos->buying_volume_ += order.volume;
-    } else if (order.oc_flag == kOcFlagAuto && bs_flag == kBsFlagSell) {
-        // 委托类型：正常卖出
-        pos->selling_volume_ += order.volume;
-    } else if (order.oc_flag == kOcFlagOpen && bs_flag == kBsFlagSell) {
-        // 委托类型：融券卖出
-        pos->borrowing_volume_ += order.volume;
-    } else if (order.oc_flag == kOcFlagClose && bs_flag == kBsFlagBuy) {
-        // 委托类型：买券还券
-        pos->returning_volume_ += order.volume;
-    }
-    LOG_INFO << "HandleOrderReq, " << pos->ToString();
+std::pair<int64_t, int64_t> InnerStockMaster::Holding(const Entry& entry) const {
+    return {entry.GetSellAvailableVolume(entry.t0_), entry.GetBorrowAvailableVolume()};
 }
 
-void InnerStockMaster::HandleOrderRep(int64_t bs_flag, const MemTradeOrder& order) {
-    // 处理委托废单响应，解冻数量
-    if (strlen(order.order_no) > 0) {
-        return;
-    }
+std::pair<int64_t, int64_t> InnerStockMaster::Holding(const MemTradePosition& position) const {
+    return {position.long_can_close, position.short_can_open};
+}
 
-    std::string code = order.code;
-    if (!IsAccountInitialized()) {
-        return;
-    }
-    InnerStockPositionPtr pos = GetPosition(code);
-    if (order.oc_flag == kOcFlagAuto && bs_flag == kBsFlagBuy) {
+void InnerStockMaster::Correct(Entry* entry, const HoldingPair& diff) {
+    entry->init_sell_volume_ += diff.first;
+    entry->init_borrowed_volume_ += diff.second;
+}
+
+InnerStockPositionPtr InnerStockMaster::SelectPosition(Entry* entry, int64_t bs_flag, int64_t oc_flag) {
+    return entry;
+}
+
+void InnerStockMaster::Update(std::string_view code, InnerStockPositionPtr pos, int64_t bs_flag, int64_t oc_flag,
+                              int64_t order_volume, int64_t match_volume, int64_t withdraw_volume) {
+    int64_t* frozen = nullptr;  // 冻结数量
+    int64_t* done = nullptr;    // 已成交数量
+    if (oc_flag == kOcFlagAuto && bs_flag == kBsFlagBuy) {
         // 委托类型：正常买入
-        if (order.volume <= pos->buying_volume_) {
-            pos->buying_volume_ -= order.volume;
-        }
-    } else if (order.oc_flag == kOcFlagAuto && bs_flag == kBsFlagSell) {
+        frozen = &pos->buying_volume_;
+        done = &pos->bought_volume_;
+    } else if (oc_flag == kOcFlagAuto && bs_flag == kBsFlagSell) {
         // 委托类型：正常卖出
-        if (order.volume <= pos->selling_volume_) {
-            pos->selling_volume_ -= order.volume;
-        }
-    } else if (order.oc_flag == kOcFlagOpen && bs_flag == kBsFlagSell) {
+        frozen = &pos->selling_volume_;
+        done = &pos->sold_volume_;
+    } else if (oc_flag == kOcFlagOpen && bs_flag == kBsFlagSell) {
         // 委托类型：融券卖出
-        if (order.volume <= pos->borrowing_volume_) {
-            pos->borrowing_volume_ -= order.volume;
-        }
-    } else if (order.oc_flag == kOcFlagClose && bs_flag == kBsFlagBuy) {
+        frozen = &pos->borrowing_volume_;
+        done = &pos->borrowed_volume_;
+    } else if (oc_flag == kOcFlagClose && bs_flag == kBsFlagBuy) {
         // 委托类型：买券还券
-        if (order.volume <= pos->returning_volume_) {
-            pos->returning_volume_ -= order.volume;
-        }
-    }
-    LOG_INFO << "HandleOrderRep, " << pos->ToString();
-}
-
-void InnerStockMaster::HandleKnock(const MemTradeKnock& knock) {
-    std::string fund_id = knock.fund_id;
-    std::string inner_match_no = knock.inner_match_no;
-    std::string code = knock.code;
-    int64_t bs_flag = knock.bs_flag;
-    int64_t oc_flag = knock.oc_flag;
-    int64_t match_type = knock.match_type;
-    if (fund_id.empty() || inner_match_no.empty() || code.empty()) {
-        return;
-    }
-    if (bs_flag != kBsFlagBuy && bs_flag != kBsFlagSell) {
-        return;
-    }
-    if (knock.match_volume <= 0) {
-        return;
-    }
-    if (!IsAccountInitialized()) {
+        frozen = &pos->returning_volume_;
+        done = &pos->returned_volume_;
+    } else {
         return;
     }
-    if (auto it = knocks_.find(inner_match_no); it != knocks_.end()) {
-        return;
+    *frozen += order_volume;
+    if (match_volume > 0) {
+        *done += match_volume;
+        *frozen -= match_volume;
     }
-    knocks_.insert(inner_match_no);
-    int64_t match_volume = knock.match_volume;
-    InnerStockPositionPtr pos = GetPosition(code);
-    if (match_type == co::kMatchTypeOK) {
-        if (oc_flag == kOcFlagAuto && bs_flag == kBsFlagBuy) {
-            pos->bought_volume_ += match_volume;
-            pos->buying_volume_ -= match_volume;
-        } else if (oc_flag == kOcFlagAuto && bs_flag == kBsFlagSell) {
-            pos->sold_volume_ += match_volume;
-            pos->selling_volume_ -= match_volume;
-        } else if (oc_flag == kOcFlagOpen && bs_flag == kBsFlagSell) {
-            pos->borrowed_volume_ += match_volume;
-            pos->borrowing_volume_ -= match_volume;
-        } else if (oc_flag == kOcFlagClose && bs_flag == kBsFlagBuy) {
-            pos->returned_volume_ += match_volume;
-            pos->returning_volume_ -= match_volume;
-        }
-    } else if (match_type == co::kMatchTypeWithdrawOK || match_type == co::kMatchTypeFailed) {
-        if (oc_flag == 0 && bs_flag == kBsFlagBuy) {
-            pos->buying_volume_ -= match_volume;
-        } else if (oc_flag == kOcFlagAuto && bs_flag == kBsFlagSell) {
-            pos->selling_volume_ -= match_volume;
-        } else if (oc_flag == kOcFlagOpen && bs_flag == kBsFlagSell) {
-            pos->borrowing_volume_ -= match_volume;
-        } else if (oc_flag == kOcFlagClose && bs_flag == kBsFlagBuy) {
-            pos->returning_volume_ -= match_volume;
-        }
+    if (withdraw_volume > 0 && withdraw_volume <= *frozen) {
+        *frozen -= withdraw_volume;
     }
-    LOG_INFO << "HandleKnock, " << pos->ToString();
 }
 
 int64_t InnerStockMaster::GetAutoOcFlag(int64_t bs_flag, const MemTradeOrder& order) {
-    if (bs_flag != kBsFlagSell) {
+    if (bs_flag != kBsFlagSell || !IsAccountInitialized()) {
         return kOcFlagAuto;
     }
-
-    int64_t oc_flag = kOcFlagAuto;
-    if (!IsAccountInitialized()) {
-        return kOcFlagAuto;
-    }
-
-    InnerStockPositionPtr pos = GetPosition(order.code);
-    bool t0_flag = IsT0Type(order.code);
-    if (t0_flag) {
-        // T + 0的品种， 当日买成交数据须统计
-        if (order.volume <= (pos->bought_volume_ + pos->init_sell_volume_ - pos->selling_volume_ - pos->sold_volume_)) {
-            oc_flag = kOcFlagAuto;
-        } else {
-            oc_flag = kOcFlagOpen;
-        }
-    } else {
-        if (order.volume <= (pos->init_sell_volume_ - pos->selling_volume_ - pos->sold_volume_)) {
-            oc_flag = kOcFlagAuto;
-        } else {
-            oc_flag = kOcFlagOpen;
-        }
-    }
+    std::string_view code = order.code;
+    InnerStockPositionPtr pos = GetEntry(code);
+    int64_t oc_flag = ResolveOcFlag(pos, code, bs_flag, order);
     LOG_INFO << "[GetAutoOcFlag]["
-             << order.code << ", bs_flag: " << bs_flag << ", order_volume: " << order.volume
-             << "] oc_flag: " << oc_flag << ", " << pos->ToString();
+             << code << ", bs_flag: " << bs_flag << ", order_volume: " << order.volume
+             << "] oc_flag: " << oc_flag << ", " << pos->ToString(code);
     return oc_flag;
 }
 
-bool InnerStockMaster::IsAccountInitialized() {
-    return init_flag_;
+int64_t InnerStockMaster::ResolveOcFlag(Entry* entry, std::string_view code, int64_t bs_flag, const MemTradeOrder& order) {
+    if (bs_flag != kBsFlagSell || !IsAccountInitialized()) {
+        return kOcFlagAuto;
+    }
+    // T + 0的品种， 当日买成交数据须统计
+    return order.volume <= entry->GetSellAvailableVolume(entry->t0_) ? kOcFlagAuto : kOcFlagOpen;
 }
 
-InnerStockPositionPtr InnerStockMaster::GetPosition(std::string code) {
-    InnerStockPositionPtr pos = nullptr;
-    auto it = positions_.find(code);
-    if (it != positions_.end()) {
-        pos = it->second;
-    } else {
-        pos = std::make_shared<InnerStockPosition>(code);
-        positions_[code] = pos;
-    }
-    return pos;
+InnerStockPositionPtr InnerStockMaster::GetPosition(std::string_view code) {
+    return GetEntry(code);
 }
 }  // namespace co
@@ -3,18 +3,17 @@
 #include "x/x.h"
 #include "coral/coral.h"
 #include "mem_struct.h"
+#include "inner_master_base.h"
 
 using std::string;
 
 namespace co {
-struct InnerStockPosition {
-    explicit InnerStockPosition(std::string code) : code_(code) {
-    }
-
-    string ToString() {
+// 单个代码的普通买卖和融券持仓，不区分方向，直接作为持仓表的表项
+struct alignas(64) InnerStockPosition {
+    string ToString(std::string_view code) const {
         std::stringstream ss;
         ss << "InnerPosition{";
-        ss << "code: " << code_
+        ss << "code: " << code
            << ", total_borrowed_volume: " << init_borrowed_volume_
            << ", borrowed_volume: " << borrowed_volume_
            << ", borrowing_volume: " << borrowing_volume_
@@ -29,7 +28,17 @@ struct InnerStockPosition {
         return ss.str();
     }
 
-    std::string code_;
+    // 剩余普通卖出额度
+    int64_t GetSellAvailableVolume(bool t0) const {
+        return init_sell_volume_ + (t0 ? bought_volume_ : 0) - selling_volume_ - sold_volume_;
+    }
+
+    // 剩余融券卖出额度
+    int64_t GetBorrowAvailableVolume() const {
+        return init_borrowed_volume_ - borrowing_volume_ - borrowed_volume_;
+    }
+
+    bool t0_ = false;                    // 是否本账户配置的T+0品种
     int64_t init_borrowed_volume_ = 0;   // 今日融券卖出的总额度, 不会变化
     int64_t borrowed_volume_ = 0;        // 已融券卖出数量
     int64_t borrowing_volume_ = 0;       // 融券卖出冻结数量
@@ -42,31 +51,33 @@ struct InnerStockPosition {
     int64_t sold_volume_ = 0;            // 普通已卖出数量
     int64_t selling_volume_ = 0;         // 普通卖出冻结数量
 };
-typedef std::shared_ptr<InnerStockPosition> InnerStockPositionPtr;
+typedef InnerStockPosition* InnerStockPositionPtr;
+
+class InnerStockMaster : public InnerMasterBase<InnerStockMaster, InnerStockPosition, InnerStockPosition> {
+    friend class InnerMasterBase<InnerStockMaster, InnerStockPosition, InnerStockPosition>;
 
-class InnerStockMaster {
  public:
+    static constexpr const char* kName = "stock";
+    static constexpr const char* kHoldingNames[2] = {"long_can_close", "short_can_open"};
+
     InnerStockMaster() = default;
     void AddT0Code(const string& code);
-    void InitPositions(MemGetTradePositionMessage* rep);
-    void HandleOrderReq(int64_t bs_flag, const MemTradeOrder& order);
-    void HandleOrderRep(int64_t bs_flag, const MemTradeOrder& order);
-    void HandleKnock(const MemTradeKnock& knock);
 
     int64_t GetAutoOcFlag(int64_t bs_flag, const MemTradeOrder& order);
-    InnerStockPositionPtr GetPosition(std::string code);
+    InnerStockPositionPtr GetPosition(std::string_view code);
 
- private:
-    bool IsAccountInitialized();
-    bool IsT0Type(const std::string& code);
+ protected:
+    void OnCreate(std::string_view code, Entry* entry);
+    void InitEntry(std::string_view code, Entry* entry, const MemTradePosition& position);
+    std::pair<int64_t, int64_t> Holding(const Entry& entry) const;
+    std::pair<int64_t, int64_t> Holding(const MemTradePosition& position) const;
+    void Correct(Entry* entry, const HoldingPair& diff);
+    InnerStockPositionPtr SelectPosition(Entry* entry, int64_t bs_flag, int64_t oc_flag);
+    // 普通卖出额度不足时融券卖出，其它委托不自动开平，不输出日志
+    int64_t ResolveOcFlag(Entry* entry, std::string_view code, int64_t bs_flag, const MemTradeOrder& order);
+    void Update(std::string_view code, InnerStockPositionPtr pos, int64_t bs_flag, int64_t oc_flag, int64_t order_volume, int64_t match_volume, int64_t withdraw_volume);
 
  private:
-    bool init_flag_ = false;
-    std::set<std::string> knocks_;
-    std::set<std::string> t0_list_;
-    std::map<std::string, InnerStockPositionPtr> positions_;  // key is code
+    std::set<std::string, std::less<>> t0_list_;  // 本账户的T+0代码，不写入共享的代码字典
 };
 }  // namespace co
-
-
-
@@ -0,0 +1,82 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <string_view>
+
+#include "../risker/common/hash_index.h"
+
+namespace co {
+/**
+ * 成交回报去重：以inner_match_no的64位哈希为键存入开放寻址表，成交编号连续存放在同一块缓冲区中，
+ * 哈希冲突时逐字节比较确认；每笔成交回报只检查一次，下游直接使用检查结果。
+ * 按自然日分代，日期变化时当日的成交编号转为上一代，再下一次变化时才清空：
+ * 期货夜盘跨过0点，0点前的成交回报在0点后重放时仍然能去重。
+ */
+class KnockDeduper {
+ public:
+    // 切换到指定日期，日期变化时丢弃上一代，当前代转为上一代
+    void Reset(int64_t day) {
+        if (day == day_) {
+            return;
+        }
+        day_ = day;
+        std::swap(current_, previous_);
+        current_.Clear();
+    }
+
+    // 新的成交编号返回true，已存在返回false
+    bool Insert(std::string_view inner_match_no) {
+        uint64_t key = MixHash(HashBytes(inner_match_no));
+        if (previous_.Contains(key, inner_match_no) || current_.Contains(key, inner_match_no)) {
+            return false;
+        }
+        current_.Insert(key, inner_match_no);
+        return true;
+    }
+
+    [[nodiscard]] inline int64_t day() const {
+        return day_;
+    }
+
+    // 两代的成交编号个数之和
+    [[nodiscard]] inline size_t size() const {
+        return current_.index_.size() + previous_.index_.size();
+    }
+
+ private:
+    struct Key {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    struct Generation {
+        std::string keys_;  // 所有成交编号首尾相接
+        HashIndex<Key> index_;
+
+        bool Contains(uint64_t key, std::string_view inner_match_no) {
+            return index_.Find(key, [&](const Key& v) {
+                return std::string_view(keys_.data() + v.offset, v.length) == inner_match_no;
+            }) != nullptr;
+        }
+
+        void Insert(uint64_t key, std::string_view inner_match_no) {
+            Key value;
+            value.offset = keys_.size();
+            value.length = inner_match_no.size();
+            keys_.append(inner_match_no);
+            index_.Insert(key, value);
+        }
+
+        void Clear() {
+            index_.Clear();
+            keys_.clear();
+        }
+    };
+
+    int64_t day_ = 0;
+    Generation current_;
+    Generation previous_;  // 上一个自然日的成交编号
+};
+}  // namespace co
@@ -15,7 +15,14 @@ void MemBroker::Init(const MemBrokerOptions& opt, MemBrokerServer* server) {
         server_ = server;
         enable_stock_short_selling_ = opt.enable_stock_short_selling();
         request_timeout_ms_ = opt.request_timeout_ms();
+        enable_position_correct_ = opt.enable_position_correct();
         OnInit();
+        if (opt.enable_position_view()) {
+            OpenPositionView(opt.mem_dir());
+        }
+        if (opt.enable_position_journal()) {
+            LoadPositionJournal(opt.mem_dir());
+        }
         LOG_INFO << "initialize broker ok";
     } catch (std::exception& e) {
         LOG_INFO << "initialize broker failed: " << e.what();
@@ -66,11 +73,83 @@ void MemBroker::SendQueryTradePosition(MemGetTradePositionMessage* req) {
 
 void MemBroker::InitPositions(MemGetTradePositionMessage* rep, int64_t type) {
     if (type == co::kTradeTypeSpot) {
-        inner_option_master_.InitPositions(rep);
+        InitMasterPositions(&inner_stock_master_, rep, type);
     } else if (type == co::kTradeTypeOption) {
-        inner_stock_master_.InitPositions(rep);
+        InitMasterPositions(&inner_option_master_, rep, type);
     } else if (type == co::kTradeTypeFuture) {
-        inner_future_master_.InitPositions(rep);
+        InitMasterPositions(&inner_future_master_, rep, type);
+    }
+}
+
+template <typename Func>
+void MemBroker::VisitMaster(Func&& func) {
+    if (account_.type == kTradeTypeSpot && enable_stock_short_selling_) {
+        func(&inner_stock_master_);
+    } else if (account_.type == kTradeTypeOption) {
+        func(&inner_option_master_);
+    } else if (account_.type == kTradeTypeFuture) {
+        func(&inner_future_master_);
+    }
+}
+
+template <typename Master>
+void MemBroker::InitMasterPositions(Master* master, MemGetTradePositionMessage* rep, int64_t type) {
+    // 已从日志恢复内部持仓时，柜台的初始持仓只用于核对，不一致时以柜台为准重新初始化
+    if (journal_ready_) {
+        int64_t mismatches = master->Reconcile(rep);
+        if (mismatches == 0) {
+            LOG_INFO << "[PositionJournal] reconcile ok, positions: " << rep->items_size;
+            return;
+        }
+        LOG_WARN << "[PositionJournal] reconcile failed, mismatches: " << mismatches << ", reset inner positions";
+    }
+    master->InitPositions(rep);
+    reconciler_.Reset();
+    if (journal_.is_open()) {
+        journal_.AppendSnapshot(rep, type);
+        journal_ready_ = true;
+    }
+}
+
+void MemBroker::LoadPositionJournal(const std::string& dir) {
+    std::string file = "position_journal_" + std::string(account_.fund_id);
+    auto t1 = x::UnixMilli();
+    bool loaded = journal_.Load(dir, file, x::RawDate(), [&](int32_t type, const void* data) {
+        ReplayPositionJournal(type, data);
+    });
+    journal_.Open(dir, file);
+    journal_ready_ = loaded;
+    LOG_INFO << "[PositionJournal] " << (loaded ? "restore inner positions" : "no inner positions today")
+             << " in " << (x::UnixMilli() - t1) << "ms, file: " << dir << "/" << file;
+}
+
+void MemBroker::OpenPositionView(const std::string& dir) {
+    VisitMaster([&](auto* master) {
+        using Master = std::remove_pointer_t<decltype(master)>;
+        master->OpenView(dir + "/position_view_" + std::string(account_.fund_id) + "_" + Master::kName);
+    });
+}
+
+const PositionView* MemBroker::position_view() {
+    const PositionView* view = nullptr;
+    VisitMaster([&](auto* master) {
+        view = &master->view();
+    });
+    return view && view->is_open() ? view : nullptr;
+}
+
+void MemBroker::ReplayPositionJournal(int32_t type, const void* data) {
+    if (type == kMemTypeInnerPositionSnapshot) {
+        auto snapshot = (const InnerJournalSnapshot*)data;
+        InitPositions((MemGetTradePositionMessage*)(snapshot + 1), snapshot->trade_type);
+    } else if (type == kMemTypeInnerOrderReq || type == kMemTypeInnerOrderRep) {
+        auto item = (const InnerJournalOrder*)data;
+        bool req = type == kMemTypeInnerOrderReq;
+        VisitMaster([&](auto* master) {
+            req ? master->HandleOrderReq(item->bs_flag, item->order) : master->HandleOrderRep(item->bs_flag, item->order);
+        });
+    } else if (type == kMemTypeInnerKnock) {
+        HandleTradeKnock((MemTradeKnock*)data);
     }
 }
 
@@ -90,28 +169,23 @@ void MemBroker::SendQueryTradeKnock(MemGetTradeKnockMessage* req) {
 void MemBroker::SendTradeOrder(MemTradeOrderMessage* req) {
     server_->BeginTask();
     try {
-        int64_t trade_type = account_.type;
-        MemTradeOrder* first = (MemTradeOrder*)((char*)req + sizeof(MemTradeOrderMessage));
-        for (int i = 0; i < req->items_size; ++i) {
-            MemTradeOrder* order = req->items + i;
-            int64_t oc_flag = order->oc_flag;
-            LOG_INFO << req->fund_id << ", trade_type: " << account_.type << ", oc_flag: " << oc_flag;
-            if (trade_type == kTradeTypeSpot && enable_stock_short_selling_) {
-                // 处理信用账户自动融券逻辑
-                order->oc_flag = inner_stock_master_.GetAutoOcFlag(req->bs_flag, *order);
-                inner_stock_master_.HandleOrderReq(req->bs_flag, *order);
-            } else if (trade_type == kTradeTypeOption) {
-                // 处理期权自动开平仓逻辑：获取自动开平仓标记
-                if (oc_flag == kOcFlagAuto) {
-                    order->oc_flag = inner_option_master_.GetAutoOcFlag(req->bs_flag, *order);
-                }
-                inner_option_master_.HandleOrderReq(req->bs_flag, *order);
-            } else if (trade_type == kTradeTypeFuture) {
-                // 处理期货自动开平仓逻辑：获取自动开平仓标记, 平仓可能变成开仓
-                order->oc_flag = inner_future_master_.GetAutoOcFlag(req->bs_flag, *order);
-                inner_future_master_.HandleOrderReq(req->bs_flag, *order);
+        int64_t frozen = 0;  // 已冻结的委托个数
+        std::string error;
+        // 自动开平仓：整个篮子一次确定开平标记并冻结, 期货平仓可能变成开仓, 信用账户普通卖出额度不足时融券卖出
+        VisitMaster([&](auto* master) {
+            frozen = master->HandleBasketReq(req->bs_flag, req->items, req->items_size, &error);
+        });
+        if (journal_ready_) {
+            for (int64_t i = 0; i < frozen; ++i) {
+                journal_.AppendOrderReq(req->bs_flag, req->items[i]);
             }
         }
+        if (!error.empty()) {
+            // 篮子冻结失败时已经撤销了冻结，之后的废单响应不再解冻；子篮子的响应合并后才返回，按原id记录
+            auto& orders = unfrozen_orders_[server_->GetBasketId(req->id)];
+            orders.insert(orders.end(), req->items, req->items + req->items_size);
+            throw std::runtime_error(error);
+        }
         OnTradeOrder(req);
     } catch (std::exception & e) {
         std::string error = e.what();
@@ -152,35 +226,84 @@ void MemBroker::SendRtnMessage(const std::string& raw, int64_t type) {
 }
 
 void MemBroker::HandleTradeOrderRep(MemTradeOrderMessage* rep) {
-    if (account_.type == kTradeTypeSpot && enable_stock_short_selling_) {
-        MemTradeOrder* items = rep->items;
-        for (int i = 0; i < rep->items_size; i++) {
-            MemTradeOrder* order = items + i;
-            inner_stock_master_.HandleOrderRep(rep->bs_flag, *order);
+    std::vector<char> skipped;  // 已撤销冻结的废单
+    if (!unfrozen_orders_.empty()) {
+        if (auto it = unfrozen_orders_.find(rep->id); it != unfrozen_orders_.end()) {
+            // 同一代码、开平标记和数量的委托解冻效果相同，按内容匹配，不依赖委托在合并响应中的位置
+            auto& orders = it->second;
+            skipped.resize(rep->items_size);
+            for (int i = 0; i < rep->items_size && !orders.empty(); i++) {
+                const MemTradeOrder& order = rep->items[i];
+                if (order.order_no[0] != '\0') {
+                    continue;
+                }
+                for (auto& unfrozen : orders) {
+                    if (unfrozen.oc_flag == order.oc_flag && unfrozen.volume == order.volume && strcmp(unfrozen.code, order.code) == 0) {
+                        unfrozen = orders.back();
+                        orders.pop_back();
+                        skipped[i] = true;
+                        break;
+                    }
+                }
+            }
+            if (orders.empty()) {
+                unfrozen_orders_.erase(it);
+            }
         }
-    } else if (account_.type == kTradeTypeOption) {
-        MemTradeOrder* items = rep->items;
+    }
+    auto is_skipped = [&](int i) {
+        return !skipped.empty() && skipped[i];
+    };
+    if (journal_ready_) {  // 只有废单需要解冻
         for (int i = 0; i < rep->items_size; i++) {
-            MemTradeOrder* order = items + i;
-            inner_option_master_.HandleOrderRep(rep->bs_flag, *order);
+            MemTradeOrder* order = rep->items + i;
+            if (order->order_no[0] == '\0' && !is_skipped(i)) {
+                journal_.AppendOrderRep(rep->bs_flag, *order);
+            }
         }
-    } else if (account_.type == kTradeTypeFuture) {
-        MemTradeOrder* items = rep->items;
+    }
+    VisitMaster([&](auto* master) {
         for (int i = 0; i < rep->items_size; i++) {
-            MemTradeOrder* order = items + i;
-            inner_future_master_.HandleOrderRep(rep->bs_flag, *order);
+            if (!is_skipped(i)) {
+                master->HandleOrderRep(rep->bs_flag, rep->items[i]);
+            }
         }
-    }
+    });
 }
 
 void MemBroker::HandleTradeKnock(MemTradeKnock* knock) {
-    if (account_.type == kTradeTypeSpot && enable_stock_short_selling_) {
-        inner_stock_master_.HandleKnock(*knock);
-    } else if (account_.type == kTradeTypeOption) {
-        inner_option_master_.HandleKnock(*knock);
-    } else if (account_.type == kTradeTypeFuture) {
-        inner_future_master_.HandleKnock(*knock);
+    if (journal_ready_) {
+        journal_.AppendKnock(*knock);
+    }
+    VisitMaster([&](auto* master) {
+        master->HandleKnock(*knock);
+    });
+}
+
+const std::vector<MemPositionMismatch>& MemBroker::ReconcilePositions(MemGetTradePositionMessage* rep) {
+    mismatches_.clear();
+    int64_t now = x::RawDateTime();
+    int64_t size = 0;
+    VisitMaster([&](auto* master) {
+        size = master->Reconcile(&reconciler_, rep, enable_position_correct_,
+                                 [&](const Instrument* instrument, const HoldingPair& inner, const HoldingPair& broker, bool corrected) {
+            MemPositionMismatch& msg = mismatches_.emplace_back();  // 值初始化，字符数组全为0
+            strncpy(msg.fund_id, rep->fund_id, sizeof(msg.fund_id) - 1);
+            msg.timestamp = now;
+            strncpy(msg.code, instrument->code, sizeof(msg.code) - 1);
+            msg.instrument_id = instrument->id;
+            msg.corrected = corrected ? 1 : 0;
+            msg.inner_volume[0] = inner.first;
+            msg.inner_volume[1] = inner.second;
+            msg.broker_volume[0] = broker.first;
+            msg.broker_volume[1] = broker.second;
+        });
+    });
+    if (size > 0) {
+        LOG_INFO << "[AutoOpenClose] reconcile positions: " << rep->items_size << ", compared: " << size
+                 << ", mismatches: " << mismatches_.size();
     }
+    return mismatches_;
 }
 
 void MemBroker::OnInit() {
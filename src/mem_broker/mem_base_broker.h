@@ -1,10 +1,15 @@
 // Copyright 2025 Fancapital Inc.  All rights reserved.
 #pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "options.h"
 #include "mem_struct.h"
 #include "inner_option_master.h"
 #include "inner_stock_master.h"
 #include "inner_future_master.h"
+#include "position_journal.h"
+#include "position_reconciler.h"
 
 namespace co {
 
@@ -33,6 +38,10 @@ class MemBroker {
     void InitPositions(MemGetTradePositionMessage* rep, int64_t type);
     void HandleTradeOrderRep(MemTradeOrderMessage* rep);
     void HandleTradeKnock(MemTradeKnock* knock);
+    // 定时查询的持仓与内部持仓增量核对，返回本次确认的不一致
+    const std::vector<MemPositionMismatch>& ReconcilePositions(MemGetTradePositionMessage* rep);
+    // 当前账户类型的内部持仓只读视图，任意线程可以无锁读取；没有启用enable_position_view时返回nullptr
+    const PositionView* position_view();
 
  protected:
     virtual void OnInit();
@@ -49,6 +58,16 @@ class MemBroker {
 
     int64_t CheckTimeout(int64_t request_time, int64_t ttl_ms);
 
+ private:
+    void LoadPositionJournal(const std::string& dir);
+    void OpenPositionView(const std::string& dir);
+    void ReplayPositionJournal(int32_t type, const void* data);
+    template <typename Master>
+    void InitMasterPositions(Master* master, MemGetTradePositionMessage* rep, int64_t type);
+    // 按账户类型选择内部持仓管理，每条消息只判断一次，逐笔处理时调用的是具体类型的函数
+    template <typename Func>
+    void VisitMaster(Func&& func);
+
  private:
     MemBrokerServer* server_ = nullptr;
     MemTradeAccount account_;
@@ -57,6 +76,13 @@ class MemBroker {
     InnerFutureMaster inner_future_master_;  // 期货内部持仓管理
     InnerOptionMaster inner_option_master_;  // 期权内部持仓管理
     InnerStockMaster inner_stock_master_;    // 信用broker, 股票内部持仓管理
+    PositionJournal journal_;  // 内部持仓日志，启用enable_position_journal时打开
+    PositionReconciler reconciler_;  // 内部持仓核对状态
+    std::vector<MemPositionMismatch> mismatches_;
+    bool enable_position_correct_ = false;  // 核对确认不一致时以柜台为准修正内部持仓
+    bool journal_ready_ = false;  // 日志中已有当天的持仓快照，之后柜台的初始持仓只用于核对
+    // 合并后响应的原id -> 篮子冻结失败后已撤销冻结的委托，废单响应中的这些委托不再解冻
+    std::unordered_map<std::string, std::vector<MemTradeOrder>> unfrozen_orders_;
 };
 
 typedef std::shared_ptr<MemBroker> MemBrokerPtr;
@@ -6,6 +6,7 @@ namespace co {
 MemBrokerServer::MemBrokerServer() {
     start_time_ = x::RawDateTime();
     nature_day_ = x::RawDate();
+    knocks_.Reset(nature_day_);
     queue_ = std::make_shared<BrokerQueue>();
     flow_control_queue_ = std::make_shared<FlowControlQueue>(queue_.get());
     risk_ = std::make_shared<RiskMaster>();
@@ -13,17 +14,28 @@ MemBrokerServer::MemBrokerServer() {
 }
 
 MemBrokerServer::~MemBrokerServer() {
+    if (opt_ && opt_->enable_config_watch()) {
+        ConfigService::Instance()->Unwatch();
+    }
 }
 
 void MemBrokerServer::Init(MemBrokerOptionsPtr option, const std::vector<std::shared_ptr<RiskOptions>>& risk_opts, MemBrokerPtr broker) {
     opt_ = option;
     broker_ = broker;
+    if (opt_->enable_shared_instrument_dict()) {  // 在风控线程启动前打开，之后的查找都使用共享字典
+        InstrumentDict::Instance()->Open(opt_->mem_dir() + "/instrument_dict");
+    }
     risk_->Init(risk_opts);
     risk_->Start();
     enable_flow_control_ = opt_->IsFlowControlEnabled();
     if (enable_flow_control_) {
         flow_control_queue_->Init(opt_);
     }
+    // 监听broker.yaml，流控阈值等限额修改后不需要重启
+    if (opt_->enable_config_watch()) {
+        ConfigService::Instance()->Watch();
+    }
+    config_.Refresh();
 }
 
 void  MemBrokerServer::Start() {
@@ -48,8 +60,9 @@ void MemBrokerServer::Run() {
     rep_writer_.Open(opt_->mem_dir(), opt_->mem_rep_file(), kRepMemSize << 20, true);
     broker_->Init(*opt_, this);
 
-    // 只考虑股票
-    if (account_.type == kTradeTypeSpot) {
+    // 只考虑股票，启用篮子拆分时超限的篮子由流控队列拆分发送，不再按流控阈值限制篮子大小
+    check_basket_limit_ = account_.type == kTradeTypeSpot && !(enable_flow_control_ && opt_->enable_basket_split());
+    if (check_basket_limit_) {
         for (auto& it : opt_->flow_controls()) {
             if (co::kMarketSH == it->market()) {
                 sh_th_tps_limit_ = it->th_tps_limit();
@@ -104,6 +117,12 @@ void MemBrokerServer::LoadTradingData() {
             break;
         }
     }
+    if (asset_.fund_id[0] != '\0') {
+        risk_->OnTradeAsset(&asset_);
+    }
+    for (auto& it : positions_) {
+        risk_->OnTradePosition(&it.second);
+    }
     auto t2 = x::UnixMilli();
     LOG_INFO << "load trading data ok in " << (t2 - t1)
              << "ms, asset usable: " << asset_.usable
@@ -224,7 +243,9 @@ void MemBrokerServer::ReadReqMem() {
                     strncpy(rep->error, error.c_str(), error.length());
                     queue_->Push(nullptr, kMemTypeTradeOrderRep, string(buffer, length));
                 } else {
-                    queue_->Push(nullptr, kMemTypeTradeOrderReq, string(reinterpret_cast<const char*>(data), length));
+                    BrokerMsgHeader header;  // 在读线程预先分类，流控队列无需再解析消息体
+                    FlowControlQueue::ClassifyTradeOrder(req, &header);
+                    queue_->Push(nullptr, kMemTypeTradeOrderReq, string(reinterpret_cast<const char*>(data), length), header);
                 }
             } else if (type == kMemTypeTradeWithdrawReq) {
                 MemTradeWithdrawMessage *req = (MemTradeWithdrawMessage*) data;
@@ -240,7 +261,9 @@ void MemBrokerServer::ReadReqMem() {
                     strncpy(rep->error, error.c_str(), error.length());
                     queue_->Push(nullptr, kMemTypeTradeWithdrawRep, string(buffer, length));
                 } else {
-                    queue_->Push(nullptr, kMemTypeTradeWithdrawReq, string(reinterpret_cast<const char*>(data), length));
+                    BrokerMsgHeader header;
+                    FlowControlQueue::ClassifyTradeWithdraw(req, &header);
+                    queue_->Push(nullptr, kMemTypeTradeWithdrawReq, string(reinterpret_cast<const char*>(data), length), header);
                 }
             } else {
                 break;
@@ -257,6 +280,12 @@ void MemBrokerServer::HandleQueueMessage() {
         }
         while (true) {
             BrokerMsg* msg = enable_flow_control_ ? flow_control_queue_->Pop() : queue_->Pop();
+            if (config_.Refresh()) {  // 在两条消息之间切换到新的流控阈值
+                if (enable_flow_control_) {
+                    flow_control_queue_->UpdateLimits(config_->flow_controls);
+                }
+                UpdateBasketLimits();
+            }
             int64_t queue_size = enable_flow_control_ ? flow_control_queue_->GetNormalQueueSize() : queue_->Size();
             int64_t fc_size = 0;
             int64_t fc_total_size = 0;
@@ -460,7 +489,7 @@ void  MemBrokerServer::SendQueryTradeKnock(MemGetTradeKnockMessage* req) {
 void MemBrokerServer::SendTradeOrder(MemTradeOrderMessage* req) {
     int64_t now = x::RawDateTime();
     int64_t ms = x::SubRawDateTime(now, req->timestamp);
-    pending_orders_.insert(std::make_pair(req->id, now));
+    pending_orders_.insert(std::make_pair(GetBasketId(req->id), now));  // 拆分的子篮子按原id等待合并后的响应
     LOG_INFO << "[REQ][WaitRep=" << pending_orders_.size() << "] send order: req_delay = " << ms << "ms, req = " << ToString(req) << " ...";
     broker_->SendTradeOrder(req);
 }
@@ -473,16 +502,9 @@ void MemBrokerServer::SendTradeWithdraw(MemTradeWithdrawMessage* req) {
     broker_->SendTradeWithdraw(req);
 }
 
-bool MemBrokerServer::MemBrokerServer::IsNewMemTradeKnock(MemTradeKnock* knock) {
+bool MemBrokerServer::IsNewMemTradeKnock(MemTradeKnock* knock) {
     CreateInnerMatchNo(knock);
-    bool flag = false;
-    string key = string(knock->inner_match_no);
-    auto it = knocks_.find(key);
-    if (it == knocks_.end()) {
-        knocks_.insert(key);
-        flag = true;
-    }
-    return flag;
+    return knocks_.Insert(knock->inner_match_no);
 }
 
 void MemBrokerServer::SendQueryTradeAssetRep(MemGetTradeAssetMessage* rep) {
@@ -508,6 +530,7 @@ void MemBrokerServer::SendQueryTradeAssetRep(MemGetTradeAssetMessage* rep) {
             x::Ne(asset->short_margin_usable, asset_.short_margin_usable) ||
             x::Ne(asset->short_return_usable, asset_.short_return_usable))
             memcpy(&asset_, asset, sizeof(asset_));
+        risk_->OnTradeAsset(asset);
 
         LOG_INFO << "[DATA][ASSET] update asset: fund_id: " << asset->fund_id
                  << ", timestamp: " << asset->timestamp
@@ -555,6 +578,7 @@ void MemBrokerServer::SendQueryTradePositionRep(MemGetTradePositionMessage* rep)
         if (pos->timestamp == 0) {
             pos->timestamp = rep->timestamp;
         }
+        risk_->OnTradePosition(pos);
         bool flag = false;
         string code = pos->code;
         auto it = positions_.find(code);
@@ -584,6 +608,14 @@ void MemBrokerServer::SendQueryTradePositionRep(MemGetTradePositionMessage* rep)
             rep_writer_.CloseFrame(kMemTypeTradePosition);
         }
     }
+    // 与自动开平仓的内部持仓增量核对，确认的不一致写入响应共享内存
+    if (opt_->enable_position_reconcile()) {
+        for (auto& mismatch : broker_->ReconcilePositions(rep)) {
+            void* buffer = rep_writer_.OpenFrame(sizeof(MemPositionMismatch));
+            memcpy(buffer, &mismatch, sizeof(MemPositionMismatch));
+            rep_writer_.CloseFrame(kMemTypePositionMismatch);
+        }
+    }
     // 删除持仓是0，api不返回对应持仓的问题
 }
 
@@ -728,6 +760,24 @@ void MemBrokerServer::SendRtnMessage(const std::string& raw, int64_t type) {
     queue_->Push(nullptr, type, raw);
  }
 
+void MemBrokerServer::UpdateBasketLimits() {
+    if (!check_basket_limit_) {
+        return;
+    }
+    for (auto& limit : config_->flow_controls) {
+        if (limit.market == co::kMarketSH) {
+            sh_th_tps_limit_ = limit.th_tps_limit;
+        } else if (limit.market == co::kMarketSZ) {
+            sz_th_tps_limit_ = limit.th_tps_limit;
+        }
+    }
+    LOG_INFO << "update basket limits, sh_th_tps_limit: " << sh_th_tps_limit_ << ", sz_th_tps_limit: " << sz_th_tps_limit_;
+}
+
+std::string MemBrokerServer::GetBasketId(const std::string& id) const {
+    return flow_control_queue_->GetBasketId(id);
+}
+
 void MemBrokerServer::RunWatch() {
     int64_t watch_interval_ms = 1000;
     while (true) {
@@ -739,6 +789,12 @@ void MemBrokerServer::RunWatch() {
 void MemBrokerServer::DoWatch() {
     int64_t timeout_ms = 60000;
     int64_t now = x::RawDateTime();
+    if (int64_t day = now / 1000000000LL; day != nature_day_) {
+        // 夜盘跨0点，上一自然日的成交编号保留到下一次日期变化
+        LOG_INFO << "nature day changed: " << nature_day_ << " -> " << day << ", knocks: " << knocks_.size();
+        nature_day_ = day;
+        knocks_.Reset(nature_day_);
+    }
     int64_t ms = x::SubRawDateTime(now, last_heart_beat_);
     if (ms > 10000) {  // 10秒钟一次心跳
         last_heart_beat_ = now;
@@ -788,6 +844,16 @@ void MemBrokerServer::DoWatch() {
     if (text.empty() && enable_flow_control_) {
         text = flow_control_queue_->PopWarningMessage(node_name_);
     }
+    if (enable_flow_control_) {
+        flow_control_queue_->FlushState(now);  // 刷新槽位时间并异步刷盘，状态槽位本身已在共享内存中原地更新
+    }
+    if (enable_flow_control_ && x::SubRawDateTime(now, last_wait_stats_time_) >= 60000) {  // 每分钟输出一次各市场排队等待统计
+        last_wait_stats_time_ = now;
+        std::string stats = flow_control_queue_->PopWaitStatsMessage();
+        if (!stats.empty()) {
+            LOG_INFO << "[FlowControl] wait stats: " << stats;
+        }
+    }
 
     if (text.empty() && (timeout_orders > 0 || timeout_withdraws > 0)) {
         LOG_WARN << "[watchdog] timeout messages: order = " << timeout_orders << ", withdraw = " << timeout_withdraws;
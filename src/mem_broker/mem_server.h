@@ -12,7 +12,10 @@
 #include "options.h"
 #include "mem_base_broker.h"
 #include "flow_control.h"
+#include "knock_deduper.h"
 #include "../risker/risk_master.h"
+#include "../risker/config_service.h"
+#include "../risker/common/instrument_dict.h"
 
 namespace co {
 class MemBrokerServer {
@@ -34,11 +37,15 @@ class MemBrokerServer {
 
     void OnStart();
     void SendRtnMessage(const std::string& raw, int64_t type);
+    // 拆分的子篮子id转换为合并后响应的原id，其它id原样返回
+    std::string GetBasketId(const std::string& id) const;
 
  protected:
     void RunQuery();
     void RunWatch();
     void DoWatch();
+    // broker.yaml重新加载后更新报单检查使用的篮子大小上限
+    void UpdateBasketLimits();
     void ReadReqMem();
     void HandleQueueMessage();
 
@@ -71,12 +78,14 @@ class MemBrokerServer {
     QueryContext asset_context_;
     QueryContext position_context_;
     QueryContext knock_context_;
+    bool check_basket_limit_ = false;  // 股票账户未拆分篮子时，篮子大小不能超过流控阈值
     int sh_th_tps_limit_ = 1;
     int sz_th_tps_limit_ = 1;
 
     MemTradeAsset asset_;
     std::unordered_map<std::string, MemTradePosition> positions_;
-    std::set<std::string> knocks_;
+    KnockDeduper knocks_;  // 当日和上一自然日已处理的成交回报
+    ConfigSnapshot config_;  // broker.yaml的当前快照
 
     int64_t active_task_timestamp_ = 0;
     x::MMapWriter rep_writer_;
@@ -84,6 +93,7 @@ class MemBrokerServer {
     int64_t nature_day_ = 0;
     int64_t wait_size_ = 0;
     int64_t last_heart_beat_ = 0;
+    int64_t last_wait_stats_time_ = 0;
 
     std::unordered_map<std::string, int64_t> pending_orders_;
     std::unordered_map<std::string, int64_t> pending_withdraws_;
@@ -17,6 +17,7 @@ constexpr int kMemTypeQueryTradeKnockRep = 6400006;
 constexpr int kMemTypeInnerCyclicSignal = 6400007;
 constexpr int kMemTypeHeartBeat = 6400008;
 constexpr int kMemTypeMonitorRisk = 6400009;
+constexpr int kMemTypePositionMismatch = 6400010;
 
 struct MemTradeAccount {
     char fund_id[kMemFundIdSize];
@@ -61,6 +62,18 @@ struct HeartBeatMessage {
     int64_t timestamp = 0;
 };
 
+// 内部持仓与柜台持仓不一致，两个数量的含义与账户类型有关：
+// 股票为普通可卖和可融券数量，期权为多头和空头可平数量，期货为多头和空头总持仓
+struct MemPositionMismatch {
+    char fund_id[kMemFundIdSize];
+    int64_t timestamp = 0;
+    char code[sizeof(MemTradePosition::code)];
+    int32_t instrument_id = 0;  // 证券代码字典中的编号
+    int32_t corrected = 0;  // 1-已以柜台为准修正内部持仓
+    int64_t inner_volume[2];
+    int64_t broker_volume[2];
+};
+
 struct MemMonitorRiskMessage {
     int64_t timestamp = 0;
     char error[1024];
@@ -17,6 +17,7 @@ std::string FlowControlConfig::ToString() const {
        << "\", th_tps_limit: " << th_tps_limit_
        << ", th_daily_warning: " << th_daily_warning_
        << ", th_daily_limit: " << th_daily_limit_
+       << ", weight: " << weight_
        << "}";
     return ss.str();
 }
@@ -89,6 +90,7 @@ std::shared_ptr<MemBrokerOptions> MemBrokerOptions::Load(const std::string& file
                 int64_t th_tps_limit = getInt(fc, "th_tps_limit");
                 int64_t th_daily_warning = getInt(fc, "th_daily_warning");
                 int64_t th_daily_limit = getInt(fc, "th_daily_limit");
+                int64_t weight = getInt(fc, "weight");
                 if (th_daily_warning > 0 && th_tps_limit >= th_daily_warning) {
                     throw std::invalid_argument("flow control config error, th_tps_limit >= th_daily_warning");
                 }
@@ -100,13 +102,22 @@ std::shared_ptr<MemBrokerOptions> MemBrokerOptions::Load(const std::string& file
                 cfg->set_th_tps_limit(th_tps_limit);
                 cfg->set_th_daily_warning(th_daily_warning);
                 cfg->set_th_daily_limit(th_daily_limit);
+                cfg->set_weight(weight);
                 opt->flow_controls_.emplace_back(std::move(cfg));
             }
         }
+        opt->flow_control_normal_weight_ = getInt(broker, "flow_control_normal_weight");
     }
     opt->batch_order_size_ = getInt(broker, "batch_order_size");
+    opt->enable_basket_split_ = getBool(broker, "enable_basket_split");
     opt->enable_stock_short_selling_ = getBool(broker, "enable_stock_short_selling");
     opt->enable_query_only_ = getBool(broker, "enable_query_only");
+    opt->enable_position_journal_ = getBool(broker, "enable_position_journal");
+    opt->enable_shared_instrument_dict_ = getBool(broker, "enable_shared_instrument_dict");
+    opt->enable_position_reconcile_ = getBool(broker, "enable_position_reconcile");
+    opt->enable_position_correct_ = getBool(broker, "enable_position_correct");
+    opt->enable_position_view_ = getBool(broker, "enable_position_view");
+    opt->enable_config_watch_ = getBool(broker, "enable_config_watch");
     opt->query_asset_interval_ms_ = getInt(broker, "query_asset_interval_ms");
     opt->query_position_interval_ms_ = getInt(broker, "query_position_interval_ms");
     opt->query_knock_interval_ms_ = getInt(broker, "query_knock_interval_ms");
@@ -139,8 +150,16 @@ string MemBrokerOptions::ToString() {
             ss << "    - " << cfg->ToString() << std::endl;
         }
     }
+    ss << "  flow_control_normal_weight: " << flow_control_normal_weight_ << std::endl;
     ss << "  batch_order_size: " << batch_order_size_ << std::endl
+       << "  enable_basket_split: " << std::boolalpha << enable_basket_split_ << std::endl
        << "  enable_stock_short_selling: " << std::boolalpha << enable_stock_short_selling_ << std::endl
+       << "  enable_position_journal: " << std::boolalpha << enable_position_journal_ << std::endl
+       << "  enable_shared_instrument_dict: " << std::boolalpha << enable_shared_instrument_dict_ << std::endl
+       << "  enable_position_reconcile: " << std::boolalpha << enable_position_reconcile_ << std::endl
+       << "  enable_position_correct: " << std::boolalpha << enable_position_correct_ << std::endl
+       << "  enable_position_view: " << std::boolalpha << enable_position_view_ << std::endl
+       << "  enable_config_watch: " << std::boolalpha << enable_config_watch_ << std::endl
        << "  idle_sleep_ns: " << idle_sleep_ns_ << "ns" << std::endl
        << "  cpu_affinity: " << cpu_affinity_ << std::endl
        << "  mem_dir: " << mem_dir_ << std::endl
@@ -36,12 +36,19 @@ class FlowControlConfig {
     inline void set_th_daily_limit(int64_t th_daily_limit) {
         th_daily_limit_ = th_daily_limit;
     }
+    [[nodiscard]] inline int64_t weight() const {
+        return weight_;
+    }
+    inline void set_weight(int64_t weight) {
+        weight_ = weight;
+    }
 
 private:
     int64_t market_ = 0; // 市场代码
     int64_t th_tps_limit_ = 0; // 每秒报撤单流控阈值
     int64_t th_daily_warning_ = 0; // 全天报撤单预警阈值
     int64_t th_daily_limit_ = 0; // 全天报撤单流控阈值
+    int64_t weight_ = 0; // 多市场轮转调度的权重，0-不启用轮转，按配置顺序严格优先
 };
 
 class MemBrokerOptions {
@@ -68,6 +75,14 @@ class MemBrokerOptions {
         request_timeout_ms_ = request_timeout_ms;
     }
 
+    inline void set_flow_control_normal_weight(int64_t flow_control_normal_weight) {
+        flow_control_normal_weight_ = flow_control_normal_weight;
+    }
+
+    inline int64_t flow_control_normal_weight() const {
+        return flow_control_normal_weight_;
+    }
+
     inline int64_t request_timeout_ms() const {
         return request_timeout_ms_;
     }
@@ -96,10 +111,46 @@ class MemBrokerOptions {
         return batch_order_size_;
     }
 
+    inline void set_enable_basket_split(bool enable_basket_split) {
+        enable_basket_split_ = enable_basket_split;
+    }
+
+    inline bool enable_basket_split() const {
+        return enable_basket_split_;
+    }
+
     inline bool enable_stock_short_selling() const {
         return enable_stock_short_selling_;
     }
 
+    inline bool enable_position_journal() const {
+        return enable_position_journal_;
+    }
+
+    inline bool enable_shared_instrument_dict() const {
+        return enable_shared_instrument_dict_;
+    }
+
+    inline bool enable_position_reconcile() const {
+        return enable_position_reconcile_;
+    }
+
+    inline bool enable_position_correct() const {
+        return enable_position_correct_;
+    }
+
+    inline bool enable_position_view() const {
+        return enable_position_view_;
+    }
+
+    inline void set_enable_config_watch(bool enable_config_watch) {
+        enable_config_watch_ = enable_config_watch;
+    }
+
+    inline bool enable_config_watch() const {
+        return enable_config_watch_;
+    }
+
     inline bool enable_query_only() const {
         return enable_query_only_;
     }
@@ -131,10 +182,18 @@ class MemBrokerOptions {
     int64_t request_timeout_ms_ = 5000;  // 请求超时时间
     bool disable_flow_control_ = false;  // 强制明确禁用流控
     std::vector<std::unique_ptr<FlowControlConfig>> flow_controls_;
+    int64_t flow_control_normal_weight_ = 0;  // 非流控消息（查询、响应等）在轮转调度中的权重
     int64_t batch_order_size_ = 1;  // 批量委托的篮子上限
+    bool enable_basket_split_ = false;  // 批量委托超过流控阈值时，是否拆分成多个子篮子发送
 
     bool enable_stock_short_selling_ = false;  // 启用股票账户融券模式
     bool enable_query_only_ = false;  // 是否启用只查询模式，不接收报单和撤单等指令
+    bool enable_position_journal_ = false;  // 是否把内部持仓的变化写入日志，重启时从日志恢复自动开平仓所需的持仓
+    bool enable_shared_instrument_dict_ = false;  // 证券代码字典是否放在共享内存中，同一台服务器上的broker共用
+    bool enable_position_reconcile_ = false;  // 定时查询持仓后是否与自动开平仓的内部持仓核对
+    bool enable_position_correct_ = false;  // 核对确认不一致时是否以柜台为准修正内部持仓
+    bool enable_position_view_ = false;  // 是否把内部持仓发布到共享内存中的只读视图，供其它线程和进程查询
+    bool enable_config_watch_ = false;  // 是否监听broker.yaml，流控阈值等限额修改后不需要重启
 
     int64_t query_asset_interval_ms_ = 0;  // 资金查询时间间隔
     int64_t query_position_interval_ms_ = 0;  // 持仓查询时间间隔
@@ -0,0 +1,95 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <filesystem>
+#include <vector>
+#include "position_journal.h"
+
+namespace co {
+void PositionJournal::Open(const std::string& dir, const std::string& file) {
+    writer_.Open(dir, file, kPositionJournalMemSize << 20, true);
+    opened_ = true;
+}
+
+bool PositionJournal::Load(const std::string& dir, const std::string& file, int64_t date,
+                           const std::function<void(int32_t type, const void* data)>& callback) {
+    bool exists = false;
+    if (std::filesystem::is_directory(dir)) {
+        for (auto& item : std::filesystem::directory_iterator(dir)) {
+            if (item.path().filename().string().find(file) == 0) {
+                exists = true;
+                break;
+            }
+        }
+    }
+    if (!exists) {
+        return false;
+    }
+    // 倒序读取到当天最后一个快照为止，复制每一帧后再正序回调
+    std::vector<std::pair<int32_t, std::string>> frames;
+    bool found = false;
+    x::MMapReader reader;
+    reader.Open(dir, file, false);
+    reader.SeekToEnd();
+    while (true) {
+        const void* data = nullptr;
+        int32_t type = reader.Prev(&data);
+        if (type == 0) {
+            break;
+        }
+        if (type == kMemTypeInnerPositionSnapshot) {
+            auto snapshot = (const InnerJournalSnapshot*)data;
+            if (snapshot->timestamp / 1000000000LL == date) {
+                auto rep = (const MemGetTradePositionMessage*)(snapshot + 1);
+                size_t length = sizeof(InnerJournalSnapshot) + sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition) * rep->items_size;
+                frames.emplace_back(type, std::string((const char*)data, length));
+                found = true;
+            }
+            break;
+        } else if (type == kMemTypeInnerOrderReq || type == kMemTypeInnerOrderRep) {
+            frames.emplace_back(type, std::string((const char*)data, sizeof(InnerJournalOrder)));
+        } else if (type == kMemTypeInnerKnock) {
+            frames.emplace_back(type, std::string((const char*)data, sizeof(MemTradeKnock)));
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    for (auto itr = frames.rbegin(); itr != frames.rend(); ++itr) {
+        callback(itr->first, itr->second.data());
+    }
+    LOG_INFO << "[PositionJournal] load ok, date: " << date << ", frames: " << frames.size();
+    return true;
+}
+
+void PositionJournal::AppendSnapshot(MemGetTradePositionMessage* rep, int64_t trade_type) {
+    int64_t length = sizeof(MemGetTradePositionMessage) + sizeof(MemTradePosition) * rep->items_size;
+    void* buffer = writer_.OpenFrame(sizeof(InnerJournalSnapshot) + length);
+    auto snapshot = (InnerJournalSnapshot*)buffer;
+    snapshot->timestamp = x::RawDateTime();
+    snapshot->trade_type = trade_type;
+    memcpy(snapshot + 1, rep, length);
+    writer_.CloseFrame(kMemTypeInnerPositionSnapshot);
+}
+
+void PositionJournal::AppendOrderReq(int64_t bs_flag, const MemTradeOrder& order) {
+    AppendOrder(kMemTypeInnerOrderReq, bs_flag, order);
+}
+
+void PositionJournal::AppendOrderRep(int64_t bs_flag, const MemTradeOrder& order) {
+    AppendOrder(kMemTypeInnerOrderRep, bs_flag, order);
+}
+
+void PositionJournal::AppendKnock(const MemTradeKnock& knock) {
+    void* buffer = writer_.OpenFrame(sizeof(MemTradeKnock));
+    memcpy(buffer, &knock, sizeof(MemTradeKnock));
+    writer_.CloseFrame(kMemTypeInnerKnock);
+}
+
+void PositionJournal::AppendOrder(int32_t type, int64_t bs_flag, const MemTradeOrder& order) {
+    void* buffer = writer_.OpenFrame(sizeof(InnerJournalOrder));
+    auto item = (InnerJournalOrder*)buffer;
+    item->timestamp = x::RawDateTime();
+    item->bs_flag = bs_flag;
+    memcpy(&item->order, &order, sizeof(MemTradeOrder));
+    writer_.CloseFrame(type);
+}
+}  // namespace co
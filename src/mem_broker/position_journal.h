@@ -0,0 +1,57 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <functional>
+#include <string>
+
+#include "x/x.h"
+#include "coral/coral.h"
+#include "mem_struct.h"
+
+namespace co {
+constexpr int kMemTypeInnerPositionSnapshot = 6400011;  // 内部持仓快照：柜台返回的初始持仓
+constexpr int kMemTypeInnerOrderReq = 6400012;  // 委托冻结
+constexpr int kMemTypeInnerOrderRep = 6400013;  // 废单解冻
+constexpr int kMemTypeInnerKnock = 6400014;  // 成交和撤单
+constexpr int64_t kPositionJournalMemSize = 64;  // 单个日志文件大小（MB）
+
+// 持仓快照帧头，后面紧跟MemGetTradePositionMessage及其持仓明细
+struct InnerJournalSnapshot {
+    int64_t timestamp;
+    int64_t trade_type;
+};
+
+struct InnerJournalOrder {
+    int64_t timestamp;
+    int64_t bs_flag;
+    MemTradeOrder order;
+};
+
+/**
+ * 内部持仓日志：追加写入共享内存文件，记录柜台初始持仓快照，以及之后改变内部持仓的委托冻结、废单解冻和成交。
+ * 重启时从当天最后一个快照开始按顺序重放，内部持仓立即可用，不需要等待柜台的初始持仓查询。
+ */
+class PositionJournal {
+ public:
+    void Open(const std::string& dir, const std::string& file);
+
+    // 读取当天最后一个快照及其后的日志，按写入顺序回调，没有当天的快照时返回false
+    bool Load(const std::string& dir, const std::string& file, int64_t date,
+              const std::function<void(int32_t type, const void* data)>& callback);
+
+    void AppendSnapshot(MemGetTradePositionMessage* rep, int64_t trade_type);
+    void AppendOrderReq(int64_t bs_flag, const MemTradeOrder& order);
+    void AppendOrderRep(int64_t bs_flag, const MemTradeOrder& order);
+    void AppendKnock(const MemTradeKnock& knock);
+
+    [[nodiscard]] inline bool is_open() const {
+        return opened_;
+    }
+
+ private:
+    void AppendOrder(int32_t type, int64_t bs_flag, const MemTradeOrder& order);
+
+ private:
+    bool opened_ = false;
+    x::MMapWriter writer_;
+};
+}  // namespace co
@@ -0,0 +1,125 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace co {
+typedef std::pair<int64_t, int64_t> HoldingPair;  // 核对比较的两个数量，含义与账户类型有关
+
+/**
+ * 持仓核对的柜台侧状态：按证券代码字典的编号保存最近一次查询到的柜台持仓和未确认的不一致。
+ * 每个查询周期只比较柜台持仓有变化、内部持仓有更新，以及上个周期不一致的代码；
+ * 同一个不一致连续两个周期数值不变才确认，在途的委托和成交不会造成误报。
+ * 查询结果是全量持仓，上个周期出现而本周期没有返回的代码按持仓为0处理。
+ */
+class PositionReconciler {
+ public:
+    static constexpr int32_t kConfirmCycles = 2;
+
+    // 开始新的查询周期
+    void BeginCycle() {
+        ++cycle_;
+    }
+
+    // 记录柜台持仓，与上次查询结果不同时加入待比较列表
+    void SetBroker(int32_t id, const HoldingPair& broker) {
+        Item& item = At(id);
+        if (item.cycle != cycle_ - 1 || item.broker != broker) {
+            Mark(id);
+        }
+        item.broker = broker;
+        item.cycle = cycle_;
+        seen_.push_back(id);
+    }
+
+    // 柜台持仓记录完毕：上个周期返回而本周期消失的代码，以及未确认的不一致加入待比较列表
+    void EndBroker() {
+        for (int32_t id : last_seen_) {
+            if (items_[id].cycle != cycle_) {
+                Mark(id);
+            }
+        }
+        last_seen_.swap(seen_);
+        seen_.clear();
+        for (int32_t id : pending_) {
+            Mark(id);
+        }
+        pending_.clear();
+    }
+
+    // 内部持仓有更新，加入待比较列表
+    void Mark(int32_t id) {
+        Item& item = At(id);
+        if (!item.marked) {
+            item.marked = true;
+            marked_.push_back(id);
+        }
+    }
+
+    /**
+     * 比较待比较列表中的代码：inner(id)返回内部持仓；确认不一致时调用emit(id, inner, broker)，
+     * emit返回true表示已按柜台修正，之后不再跟踪，否则继续跟踪到数值变化。返回本周期比较的代码个数。
+     */
+    template <typename Inner, typename Emit>
+    int64_t Compare(Inner&& inner, Emit&& emit) {
+        int64_t size = (int64_t)marked_.size();
+        for (int32_t id : marked_) {
+            Item& item = items_[id];
+            item.marked = false;
+            HoldingPair broker = item.cycle == cycle_ ? item.broker : HoldingPair();
+            HoldingPair current = inner(id);
+            if (current == broker) {
+                item.mismatches = 0;
+                continue;
+            }
+            if (item.mismatches > 0 && item.inner == current && item.mismatch_broker == broker) {
+                if (++item.mismatches == kConfirmCycles && emit(id, current, broker)) {
+                    item.mismatches = 0;
+                    continue;
+                }
+            } else {
+                item.mismatches = 1;
+                item.inner = current;
+                item.mismatch_broker = broker;
+            }
+            pending_.push_back(id);
+        }
+        marked_.clear();
+        return size;
+    }
+
+    // 重新初始化内部持仓后清空未确认的不一致，柜台持仓保留
+    void Reset() {
+        for (int32_t id : pending_) {
+            items_[id].mismatches = 0;
+        }
+        pending_.clear();
+    }
+
+ private:
+    struct Item {
+        HoldingPair broker;           // 最近一次查询到的柜台持仓
+        HoldingPair inner;            // 不一致时的内部持仓
+        HoldingPair mismatch_broker;  // 不一致时的柜台持仓
+        int64_t cycle = 0;            // 最近一次出现在查询结果中的周期
+        int32_t mismatches = 0;       // 连续不一致的周期数
+        bool marked = false;          // 已在待比较列表中
+    };
+
+    Item& At(int32_t id) {
+        if (id >= (int32_t)items_.size()) {
+            items_.resize(id + 1);
+        }
+        return items_[id];
+    }
+
+ private:
+    int64_t cycle_ = 0;
+    std::vector<Item> items_;  // 证券代码编号 -> 核对状态
+    std::vector<int32_t> marked_;  // 本周期待比较
+    std::vector<int32_t> pending_;  // 不一致，下个周期继续比较
+    std::vector<int32_t> seen_;  // 本周期返回的代码
+    std::vector<int32_t> last_seen_;  // 上个周期返回的代码
+};
+}  // namespace co
@@ -0,0 +1,83 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coral/coral.h"
+#include "../risker/common/hash_index.h"
+
+namespace co {
+// 同一代码的多头和空头持仓，按缓存行对齐
+template <typename Position>
+struct alignas(64) PositionPair {
+    PositionPair() {
+        long_pos.bs_flag_ = kBsFlagBuy;
+        short_pos.bs_flag_ = kBsFlagSell;
+    }
+
+    Position long_pos;   // 多头持仓
+    Position short_pos;  // 空头持仓
+};
+
+/**
+ * 内部持仓表：证券代码驻留为连续编号，同一代码的持仓存放在一个表项中，默认是相邻的多头和空头持仓，
+ * 不区分方向的持仓可以直接用持仓作为表项；表项按编号分块连续存放，地址在表清空之前保持不变，可以长期持有持仓指针。
+ */
+template <typename Position, typename EntryType = PositionPair<Position>>
+class PositionTable {
+ public:
+    using Entry = EntryType;
+
+    // 不存在时返回nullptr
+    Entry* Find(std::string_view code) {
+        int32_t id = codes_.Find(code);
+        return id >= 0 ? At(id) : nullptr;
+    }
+
+    // 不存在时创建，created返回是否为新建，index返回表项编号
+    Entry* Get(std::string_view code, bool* created = nullptr, int32_t* index = nullptr) {
+        int32_t id = codes_.Intern(code);
+        bool is_new = id >= size_;
+        if (created) {
+            *created = is_new;
+        }
+        if (index) {
+            *index = id;
+        }
+        if (is_new) {
+            if (size_ == (int32_t)(chunks_.size() * kChunkSize)) {
+                chunks_.emplace_back(new Entry[kChunkSize]);
+            }
+            ++size_;
+            *At(id) = Entry();
+        }
+        return At(id);
+    }
+
+    void Clear() {
+        codes_ = StringInterner();
+        chunks_.clear();
+        size_ = 0;
+    }
+
+    [[nodiscard]] inline int32_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] inline const std::string& code(int32_t id) const {
+        return codes_.name(id);
+    }
+
+    inline Entry* At(int32_t id) {
+        return &chunks_[id / kChunkSize][id % kChunkSize];
+    }
+
+ private:
+    static constexpr int32_t kChunkSize = 256;
+    StringInterner codes_;
+    std::vector<std::unique_ptr<Entry[]>> chunks_;
+    int32_t size_ = 0;
+};
+}  // namespace co
@@ -0,0 +1,163 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <filesystem>
+#include "position_view.h"
+
+namespace co {
+namespace {
+constexpr int64_t kMaxSpin = 1 << 20;  // 写入方异常退出时槽位停留在写入状态，等待一段时间后放弃
+
+size_t ViewSize() {
+    return sizeof(PositionViewHeader) + sizeof(PositionViewSlot) * kPositionViewCapacity;
+}
+}  // namespace
+
+PositionView::~PositionView() {
+    Close();
+}
+
+void PositionView::Open(const std::string& filename, const char* name, const char* const holding_names[2]) {
+    Close();
+    if (filename.empty()) {
+        Map(-1, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, filename);
+    } else {
+        std::filesystem::path path(filename);
+        if (path.has_parent_path()) {
+            std::filesystem::create_directories(path.parent_path());
+        }
+        int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("open position view failed: " + filename);
+        }
+        if (::ftruncate(fd, (off_t)ViewSize()) != 0) {
+            ::close(fd);
+            throw std::runtime_error("resize position view failed: " + filename);
+        }
+        Map(fd, PROT_READ | PROT_WRITE, MAP_SHARED, filename);
+    }
+    // 读取方可能还在读旧的文件，先作废槽位再改文件头
+    header_->size.store(0, std::memory_order_release);
+    header_->generation.fetch_add(1, std::memory_order_acq_rel);
+    strncpy(header_->name, name, sizeof(header_->name) - 1);
+    for (int i = 0; i < 2; ++i) {
+        strncpy(header_->holding_names[i], holding_names[i], sizeof(header_->holding_names[i]) - 1);
+    }
+    header_->capacity = kPositionViewCapacity;
+    header_->slot_size = sizeof(PositionViewSlot);
+    header_->magic = kPositionViewMagic;
+    LOG_INFO << "[PositionView] open ok: " << (filename.empty() ? "<anonymous>" : filename) << ", name: " << name;
+}
+
+void PositionView::OpenReadOnly(const std::string& filename) {
+    Close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("open position view failed: " + filename);
+    }
+    struct stat st = {};
+    ::fstat(fd, &st);
+    if (st.st_size != (off_t)ViewSize()) {
+        ::close(fd);
+        throw std::runtime_error("illegal position view size: " + std::to_string(st.st_size) + ", file: " + filename);
+    }
+    Map(fd, PROT_READ, MAP_SHARED, filename);
+    if (header_->magic != kPositionViewMagic || header_->capacity != kPositionViewCapacity ||
+        header_->slot_size != (int64_t)sizeof(PositionViewSlot)) {
+        Close();
+        throw std::runtime_error("illegal position view header: " + filename);
+    }
+}
+
+void PositionView::Map(int fd, int prot, int flags, const std::string& filename) {
+    size_t size = ViewSize();
+    void* addr = ::mmap(nullptr, size, prot, flags, fd, 0);
+    if (addr == MAP_FAILED) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("mmap position view failed: " + filename);
+    }
+    fd_ = fd;
+    addr_ = addr;
+    size_ = size;
+    header_ = reinterpret_cast<PositionViewHeader*>(addr);
+    slots_ = reinterpret_cast<PositionViewSlot*>(header_ + 1);
+}
+
+void PositionView::Close() {
+    if (addr_) {
+        ::munmap(addr_, size_);
+        addr_ = nullptr;
+        header_ = nullptr;
+        slots_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void PositionView::Clear() {
+    header_->size.store(0, std::memory_order_release);
+    header_->generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void PositionView::Publish(int32_t index, std::string_view code, const HoldingPair& holding) {
+    if (index >= kPositionViewCapacity) {
+        if (index == kPositionViewCapacity) {
+            LOG_WARN << "[PositionView] too many codes, capacity: " << kPositionViewCapacity << ", ignore: " << code;
+        }
+        return;
+    }
+    PositionViewSlot* slot = slots_ + index;
+    uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+    slot->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->generation = header_->generation.load(std::memory_order_relaxed);
+    PositionViewItem& item = slot->item;
+    size_t n = std::min(code.size(), sizeof(item.code) - 1);
+    memcpy(item.code, code.data(), n);
+    item.code[n] = '\0';
+    item.holding[0] = holding.first;
+    item.holding[1] = holding.second;
+    slot->seq.store(seq + 2, std::memory_order_release);
+    if (index >= header_->size.load(std::memory_order_relaxed)) {
+        header_->size.store(index + 1, std::memory_order_release);
+    }
+}
+
+bool PositionView::Read(int32_t index, PositionViewItem* out) const {
+    if (index < 0 || index >= size()) {
+        return false;
+    }
+    const PositionViewSlot* slot = slots_ + index;
+    for (int64_t n = 0; n < kMaxSpin; ++n) {
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        int64_t generation = slot->generation;
+        memcpy(out, &slot->item, sizeof(*out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->seq.load(std::memory_order_relaxed) == seq) {
+            return seq != 0 && generation == this->generation();
+        }
+    }
+    return false;
+}
+
+bool PositionView::Find(std::string_view code, PositionViewItem* out) const {
+    for (int32_t i = 0, size = this->size(); i < size; ++i) {
+        // 先不加校验比较代码，命中后再完整读取一次
+        if (code == std::string_view(slots_[i].item.code, strnlen(slots_[i].item.code, sizeof(out->code))) &&
+            Read(i, out) && code == out->code) {
+            return true;
+        }
+    }
+    return false;
+}
+}  // namespace co
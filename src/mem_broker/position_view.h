@@ -0,0 +1,95 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <atomic>
+#include <string>
+#include <string_view>
+
+#include "x/x.h"
+#include "coral/coral.h"
+#include "position_reconciler.h"
+
+namespace co {
+constexpr int64_t kPositionViewMagic = 0x504f535649455732;  // "POSVIEW2"
+constexpr int32_t kPositionViewCapacity = 1 << 14;  // 每个账户最多发布的代码个数
+
+// 发布的单个代码持仓，holding的含义与账户类型有关，见PositionViewHeader::holding_names
+struct PositionViewItem {
+    char code[32];
+    int64_t holding[2];
+};
+
+/**
+ * 视图槽位：seq为奇数时表示正在写入，读取方在前后两次读到相同的偶数seq时数据才有效；
+ * 只有调度线程写入，不需要CAS，写入一次只多两次原子写。
+ * generation与文件头不一致时表示槽位是重新初始化之前发布的，读取方视为未发布。
+ */
+struct alignas(64) PositionViewSlot {
+    std::atomic<uint64_t> seq;
+    int64_t generation;
+    PositionViewItem item;
+};
+
+struct alignas(64) PositionViewHeader {
+    int64_t magic;
+    int64_t capacity;
+    int64_t slot_size;
+    char name[16];  // 账户类型：stock、option、future
+    char holding_names[2][32];
+    std::atomic<int64_t> generation;  // 内部持仓重新初始化时加1
+    std::atomic<int32_t> size;  // 已发布的槽位个数，槽位编号与内部持仓表的表项编号相同
+};
+
+/**
+ * 内部持仓的只读视图：调度线程每次更新内部持仓后把该代码的持仓写入对应槽位，
+ * 其它线程（监控、统计、策略）和其它进程（映射同一个共享内存文件）无锁读取，不需要向调度线程发消息。
+ * 没有文件名时使用匿名内存，只在进程内可见。
+ */
+class PositionView {
+ public:
+    PositionView() = default;
+    ~PositionView();
+    PositionView(const PositionView&) = delete;
+    PositionView& operator=(const PositionView&) = delete;
+
+    // 写入方打开，文件已存在时重新初始化
+    void Open(const std::string& filename, const char* name, const char* const holding_names[2]);
+    // 读取方只读打开其它进程发布的视图
+    void OpenReadOnly(const std::string& filename);
+    void Close();
+
+    // 内部持仓重新初始化，之前发布的槽位作废，不需要逐个清理槽位
+    void Clear();
+    void Publish(int32_t index, std::string_view code, const HoldingPair& holding);
+
+    // 读取槽位，槽位未发布或一直在写入时返回false
+    bool Read(int32_t index, PositionViewItem* out) const;
+    // 按代码顺序查找，用于监控等低频查询
+    bool Find(std::string_view code, PositionViewItem* out) const;
+
+    [[nodiscard]] inline bool is_open() const {
+        return slots_ != nullptr;
+    }
+
+    [[nodiscard]] inline int32_t size() const {
+        return header_->size.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] inline int64_t generation() const {
+        return header_->generation.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] inline const PositionViewHeader* header() const {
+        return header_;
+    }
+
+ private:
+    void Map(int fd, int prot, int flags, const std::string& filename);
+
+ private:
+    int fd_ = -1;
+    void* addr_ = nullptr;
+    size_t size_ = 0;
+    PositionViewHeader* header_ = nullptr;
+    PositionViewSlot* slots_ = nullptr;
+};
+}  // namespace co
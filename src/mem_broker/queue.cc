@@ -14,6 +14,12 @@ BrokerMsg* BrokerMsg::Create(void* worker, const int64_t& function_id, const std
     return ret;
 }
 
+BrokerMsg* BrokerMsg::Create(void* worker, const int64_t& function_id, const std::string& data, const BrokerMsgHeader& header) {
+    BrokerMsg* ret = Create(worker, function_id, data);
+    ret->set_header(header);
+    return ret;
+}
+
 void BrokerMsg::Destory(BrokerMsg* data) {
     if (data) {
         delete data;
@@ -59,6 +65,14 @@ void BrokerQueue::Push(void* worker, const int64_t& function_id, const std::stri
     ++m_->size_;
 }
 
+void BrokerQueue::Push(void* worker, const int64_t& function_id, const std::string& data, const BrokerMsgHeader& header) {
+    BrokerMsg* msg = BrokerMsg::Create(worker, function_id, data, header);
+    while (!m_->queue_.push(msg)) {
+        // pass
+    }
+    ++m_->size_;
+}
+
 BrokerMsg* BrokerQueue::Pop() {
     BrokerMsg* msg = nullptr;
     while (!m_->queue_.pop(msg)) {
@@ -4,9 +4,22 @@
 #include <memory>
 
 namespace co {
+/**
+ * 报撤单消息入队时预先计算好的分类信息，流控队列据此直接分组排序，无需再次解析消息体
+ */
+struct BrokerMsgHeader {
+    int64_t market = 0;  // 市场代码，撤单的合同号或批次号不规范时为0
+    int64_t cmd_size = 0;  // 流控指令个数，委托个数或撤单个数
+    int64_t priority = 0;  // 优先级，3-撤单，2-申赎，1-其他
+    double order_amount = 0;  // 委托金额，仅普通买卖委托计算
+    int64_t timestamp = 0;  // 请求时间
+    int64_t timeout = 0;  // 请求自带的超时毫秒数，0-未指定
+};
+
 class BrokerMsg {
  public:
     static BrokerMsg* Create(void* worker, const int64_t& function_id, const std::string& data);
+    static BrokerMsg* Create(void* worker, const int64_t& function_id, const std::string& data, const BrokerMsgHeader& header);
     static void Destory(BrokerMsg* data);
 
     inline void* worker() {
@@ -33,10 +46,25 @@ class BrokerMsg {
         data_ = data;
     }
 
+    [[nodiscard]] inline bool has_header() const {
+        return has_header_;
+    }
+
+    [[nodiscard]] inline const BrokerMsgHeader& header() const {
+        return header_;
+    }
+
+    inline void set_header(const BrokerMsgHeader& header) {
+        header_ = header;
+        has_header_ = true;
+    }
+
  private:
     void* worker_ = nullptr;
     int64_t function_id_ = 0;
     std::string data_;
+    bool has_header_ = false;
+    BrokerMsgHeader header_;
 };
 
 class BrokerQueue {
@@ -48,6 +76,7 @@ class BrokerQueue {
     int64_t Size() const;
     bool Empty() const;
     void Push(void* worker, const int64_t& function_id, const std::string& data);
+    void Push(void* worker, const int64_t& function_id, const std::string& data, const BrokerMsgHeader& header);
     BrokerMsg* Pop();
     BrokerMsg* TryPop();
 
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "../risker/common/instrument_dict.h"
 #include <regex>
 #include <string>
 #include <boost/lexical_cast.hpp>
@@ -158,14 +159,16 @@ namespace co {
         }
         auto first = req->items;
         int64_t first_market = 0;
+        InstrumentDict* dict = InstrumentDict::Instance();
         for (int i = 0; i < req->items_size; ++i) {
             auto order = first + i;
             if (strlen(order->code) == 0) {
                 return "[FAN-BROKER-ERROR] code is required";
             }
+            const Instrument* instrument = dict->Get(order->code);
             int64_t market = order->market;
             if (market <= 0) {
-                market = co::CodeToMarket(order->code);
+                market = instrument ? instrument->market : 0;
                 order->market = market;
             }
             if (market <= 0) {
@@ -193,16 +196,8 @@ namespace co {
             }
             // --------------------------------------------------------------
             //只允许放一天的逆回购
-            if (req->bs_flag == co::kBsFlagSell) {
-                if (market == kMarketSH && strncmp(order->code, "204", 3) == 0) {
-                    if (strcmp(order->code, "204001.SH") != 0) {
-                        return ("[FAN-Broker-RepoRiskError] only 1-Day repo code is allowed: " + string(order->code));
-                    }
-                } else if (market == kMarketSZ && strncmp(order->code, "1318", 4) == 0) {
-                    if (strcmp(order->code, "131810.SZ") != 0) {
-                        return ("[FAN-Broker-RepoRiskError] only 1-Day repo code is allowed: " + string(order->code));
-                    }
-                }
+            if (req->bs_flag == co::kBsFlagSell && instrument && instrument->repo() && instrument->repo_days != 1) {
+                return ("[FAN-Broker-RepoRiskError] only 1-Day repo code is allowed: " + string(order->code));
             }
         }
         return "";
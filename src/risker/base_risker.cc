@@ -21,4 +21,8 @@ void Risker::OnTradeWithdrawReqPass(MemTradeWithdrawMessage* req) {}
 void Risker::HandleTradeWithdrawRep(MemTradeWithdrawMessage* rep) {}
 
 void Risker::OnTradeKnock(MemTradeKnock* knock) {}
+
+void Risker::OnTradeAsset(MemTradeAsset* asset) {}
+
+void Risker::OnTradePosition(MemTradePosition* position) {}
 }  // namespace co
@@ -62,6 +62,18 @@ class Risker {
     * @params knock: 成交回报
     */
     virtual void OnTradeKnock(MemTradeKnock* knock);
+
+    /**
+    * 处理资金快照
+    * @params asset: 资金
+    */
+    virtual void OnTradeAsset(MemTradeAsset* asset);
+
+    /**
+    * 处理持仓快照
+    * @params position: 持仓
+    */
+    virtual void OnTradePosition(MemTradePosition* position);
 };
 }  // namespace co
 
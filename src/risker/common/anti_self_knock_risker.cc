@@ -2,6 +2,7 @@
 #include "anti_self_knock_risker.h"
 #include "yaml-cpp/yaml.h"
 #include "order_book.h"
+#include "instrument_dict.h"
 
 namespace co {
 AntiSelfKnockOption::AntiSelfKnockOption(std::shared_ptr<RiskOptions> opt) {
@@ -14,13 +15,18 @@ void AntiSelfKnockRisker::AddOption(std::shared_ptr<RiskOptions> opt) {
     auto account = new AntiSelfKnockOption(opt);
     LOG_INFO << "[risk][anti_self_knock] add account: " << account->tag()
         << ", only_etf: " << std::boolalpha << account->only_etf();
-    options_[opt->fund_id()] = account;
+    int32_t fund = funds_.Intern(opt->fund_id());
+    if (fund >= (int32_t)options_.size()) {
+        options_.resize(fund + 1, nullptr);
+    }
+    delete options_[fund];
+    options_[fund] = account;
 }
 
 std::string AntiSelfKnockRisker::GetAccountInfo(const std::string& fund_id) {
-    auto itr = options_.find(fund_id);
-    if (itr != options_.end()) {
-        return itr->second->tag();
+    auto opt = GetOption(funds_.Find(fund_id));
+    if (opt) {
+        return opt->tag();
     }
     return fund_id;
 }
@@ -29,16 +35,18 @@ AntiSelfKnockRisker::AntiSelfKnockRisker() {
 }
 
 AntiSelfKnockRisker::~AntiSelfKnockRisker() {
-    for (auto& itr: options_) {
-        delete itr.second;
+    for (auto& opt: options_) {
+        delete opt;
     }
     options_.clear();
+    for (auto& book: order_books_) {
+        delete book;
+    }
+    order_books_.clear();
 }
 
 std::string AntiSelfKnockRisker::HandleTradeOrderReq(MemTradeOrderMessage* req) {
-    std::string message_id = req->id;
-    std::string fund_id = req->fund_id;
-    auto opt = GetOption(fund_id);
+    auto opt = GetOption(funds_.Find(req->fund_id));
     if (!opt) {
         return "";
     }
@@ -46,7 +54,7 @@ std::string AntiSelfKnockRisker::HandleTradeOrderReq(MemTradeOrderMessage* req)
     MemTradeOrder* items = req->items;
     for (int i = 0; i < req->items_size; i++) {
         MemTradeOrder* order = items + i;
-        std::string code = order->code;
+        std::string_view code = order->code;
         if (!only_etf || IsETF(code)) {
             auto book = MustGetOrderBook(code);
             std::string error = book->HandleTradeOrderReq(order, req->bs_flag);
@@ -59,61 +67,81 @@ std::string AntiSelfKnockRisker::HandleTradeOrderReq(MemTradeOrderMessage* req)
 }
 
 void AntiSelfKnockRisker::OnTradeOrderReqPass(MemTradeOrderMessage* req) {
-    std::string message_id = req->id;
-    std::string fund_id = req->fund_id;
-    auto opt = GetOption(fund_id);
+    auto opt = GetOption(funds_.Find(req->fund_id));
     if (!opt) {
         return;
     }
     bool only_etf = opt->only_etf();
+    int64_t now = x::UnixMilli();  // 同一篮子的委托使用相同的创建时间
+    int64_t date = shared_book_.is_open() ? x::RawDateTime() / 1000000000LL : 0;
     MemTradeOrder* items = req->items;
     for (int i = 0; i < req->items_size; i++) {
         MemTradeOrder* item = items + i;
-        std::string code = item->code;
+        std::string_view code = item->code;
         if (!only_etf || IsETF(code)) {
-            auto order = std::make_shared<Order>();
-            order->message_id = message_id;
+            auto order = pool_.Create();
+            order->create_time = now;
+            CopyOrderField(order->message_id, req->id);
             order->timestamp = req->timestamp;
-            order->fund_id = fund_id;
-            order->code = code;
+            CopyOrderField(order->fund_id, req->fund_id);
+            CopyOrderField(order->code, item->code);
             order->bs_flag = req->bs_flag;
             order->volume = item->volume;
             order->price = item->price;
             auto book = MustGetOrderBook(code);
             book->OnTradeOrderReqPass(order);
+            ScheduleOrder(order, now + kOrderTimeoutMS + 1);
+            if (date > 0) {
+                order->shared_entry = shared_book_.Insert(order->fund_id, order->code, order->bs_flag,
+                    EncodePrice(order->price), order->volume, order->timestamp, date, &order->shared_serial);
+            }
         }
     }
 }
 
 void AntiSelfKnockRisker::HandleTradeOrderRep(MemTradeOrderMessage* rep) {
-    std::string fund_id = rep->fund_id;
-    std::string batch_no = rep->batch_no;
-    auto opt = GetOption(fund_id);
+    int32_t fund = funds_.Find(rep->fund_id);
+    auto opt = GetOption(fund);
     if (!opt) {
         return;
     }
+    const char* fund_id = rep->fund_id;
+    const char* batch_no = rep->batch_no;
     std::unique_ptr<std::vector<MemTradeKnock>> knocks;
     bool only_etf = opt->only_etf();
     std::unique_ptr<std::vector<OrderPtr>> orders = nullptr;
+    int64_t now = x::UnixMilli();
     MemTradeOrder* items = rep->items;
     for (int i = 0; i < rep->items_size; i++) {
         MemTradeOrder* order = items + i;
-        std::string code = order->code;
+        std::string_view code = order->code;
         if (!only_etf || IsETF(code)) {
-            std::string order_no = order->order_no;
+            const char* order_no = order->order_no;
             auto book = MustGetOrderBook(code);
-            auto active_order = book->HandleTradeOrderRep(rep, order);
+            auto active_order = book->HandleTradeOrderRep(rep, order, now);
             if (active_order) {
-                if (!order_no.empty()) {
-                    std::string key = CreateOrderNoKey(fund_id, order_no);
+                if (active_order->shared_entry && order_no[0] != '\0') {
+                    shared_book_.SetOrderNo(active_order->shared_entry, active_order->shared_serial, order_no);
+                }
+                if (order_no[0] != '\0') {
+                    uint64_t key = CreateOrderNoKey(fund, order_no);
                     // 先收到成交回报, 后收到报单响应
-                    if (auto it = knock_first_orders_.find(key); it != knock_first_orders_.end()) {
-                        knocks = std::move(it->second);
-                        knock_first_orders_.erase(it);
+                    auto match_knocks = [&](const std::unique_ptr<std::vector<MemTradeKnock>>& v) {
+                        return strcmp(v->front().order_no, order_no) == 0 && strcmp(v->front().fund_id, fund_id) == 0;
+                    };
+                    if (auto it = knock_first_orders_.Find(key, match_knocks); it) {
+                        knocks = std::move(*it);
+                        knock_first_orders_.Erase(key, [](const std::unique_ptr<std::vector<MemTradeKnock>>& v) {
+                            return !v;
+                        });
+                    }
+                    if (auto it = FindSingleOrder(fund, fund_id, order_no); it) {
+                        *it = active_order;
+                    } else {
+                        single_orders_.Insert(key, active_order);
                     }
-                    single_orders_[key] = active_order;
                 }
-                if (!batch_no.empty()) {
+                if (batch_no[0] != '\0') {
                     if (!orders) {
                         orders = std::make_unique<std::vector<OrderPtr>>();
                     }
@@ -128,8 +156,11 @@ void AntiSelfKnockRisker::HandleTradeOrderRep(MemTradeOrderMessage* rep) {
         }
     }
     if (orders) {
-        std::string batch_key = CreateOrderNoKey(fund_id, batch_no);
-        batch_orders_[batch_key] = std::move(orders);
+        if (auto it = FindBatchOrders(fund, fund_id, batch_no); it) {
+            *it = std::move(*orders);
+        } else {
+            batch_orders_.Insert(CreateOrderNoKey(fund, batch_no), std::move(orders));
+        }
     }
     if (knocks) {
         for (auto& it : *knocks) {
@@ -140,61 +171,62 @@ void AntiSelfKnockRisker::HandleTradeOrderRep(MemTradeOrderMessage* rep) {
 
 // 复用withdraw_failed_time字段，只要有撤单请求，过段时间就删掉挂单
 std::string AntiSelfKnockRisker::HandleTradeWithdrawReq(MemTradeWithdrawMessage* req) {
-    std::string fund_id = req->fund_id;
-    std::string batch_no = req->batch_no;
-    std::string order_no = req->order_no;
-    if (!batch_no.empty()) {
-        std::string key = CreateOrderNoKey(fund_id, batch_no);
-        auto itr = batch_orders_.find(key);
-        if (itr != batch_orders_.end()) {
-            auto& orders = itr->second;
+    int32_t fund = funds_.Find(req->fund_id);
+    if (fund < 0) {
+        return "";
+    }
+    if (req->batch_no[0] != '\0') {
+        auto orders = FindBatchOrders(fund, req->fund_id, req->batch_no);
+        if (orders) {
+            int64_t now = x::UnixMilli();
             for (auto& order: *orders) {
-                order->withdraw_failed_time = x::UnixMilli();
+                OnWithdrawFailed(order, now);
             }
         }
-    } else if (!order_no.empty()) {
-        std::string key = CreateOrderNoKey(fund_id, order_no);
-        auto itr = single_orders_.find(key);
-        if (itr != single_orders_.end()) {
-            auto& order = itr->second;
-            order->withdraw_failed_time = x::UnixMilli();
+    } else if (req->order_no[0] != '\0') {
+        auto order = FindSingleOrder(fund, req->fund_id, req->order_no);
+        if (order) {
+            OnWithdrawFailed(*order, x::UnixMilli());
         }
     }
     return "";
 }
 
 void AntiSelfKnockRisker::HandleTradeWithdrawRep(MemTradeWithdrawMessage* rep) {
-    std::string fund_id = rep->fund_id;
-    std::string batch_no = rep->batch_no;
-    std::string order_no = rep->order_no;
-    std::string error = rep->error;
-    if (!batch_no.empty()) {
-        std::string key = CreateOrderNoKey(fund_id, batch_no);
-        auto itr = batch_orders_.find(key);
-        if (itr != batch_orders_.end()) {
-            auto& orders = itr->second;
-            if (!error.empty()) {  // 撤单失败
+    int32_t fund = funds_.Find(rep->fund_id);
+    if (fund < 0) {
+        return;
+    }
+    bool failed = rep->error[0] != '\0';
+    if (rep->batch_no[0] != '\0') {
+        auto orders = FindBatchOrders(fund, rep->fund_id, rep->batch_no);
+        if (orders) {
+            if (failed) {  // 撤单失败
                 // @TODO 如果确认是柜台返回的撤单失败，说明委托已经被撤单了，或者已经成交完了；
                 // 如果仅仅是自由系统内部返回的撤单失败，不应该处理。
+                int64_t now = x::UnixMilli();
                 for (auto& order: *orders) {
-                    order->withdraw_failed_time = x::UnixMilli();
+                    OnWithdrawFailed(order, now);
                 }
             } else {  // 撤单成功
                 for (auto& order: *orders) {
                     order->withdraw_succeed = true;
+                    RemoveFromBook(order.get());
                 }
-                batch_orders_.erase(itr);
+                const char* batch_no = rep->batch_no;
+                batch_orders_.Erase(CreateOrderNoKey(fund, batch_no), [&](const std::unique_ptr<std::vector<OrderPtr>>& v) {
+                    return v.get() == orders;
+                });
             }
         }
-    } else if (!order_no.empty()) {
-        std::string key = CreateOrderNoKey(fund_id, order_no);
-        auto itr = single_orders_.find(key);
-        if (itr != single_orders_.end()) {
-            auto& order = itr->second;
-            if (!error.empty()) {  // 撤单失败
-                order->withdraw_failed_time = x::UnixMilli();
+    } else if (rep->order_no[0] != '\0') {
+        auto order = FindSingleOrder(fund, rep->fund_id, rep->order_no);
+        if (order) {
+            if (failed) {  // 撤单失败
+                OnWithdrawFailed(*order, x::UnixMilli());
             } else {  // 撤单成功
-                order->withdraw_succeed = true;
+                (*order)->withdraw_succeed = true;
+                RemoveFromBook(order->get());
             }
         }
     }
@@ -203,12 +235,16 @@ void AntiSelfKnockRisker::HandleTradeWithdrawRep(MemTradeWithdrawMessage* rep) {
 void AntiSelfKnockRisker::OnTradeKnock(MemTradeKnock* knock) {
     // 交易网关能保证同一个成交回报不会多次调用该函数，所以这里不用考虑重复成交回报的问题；
     // 如果要考虑重复成交的话，可以在Order中增加一个map，用于保存成交回报；
-    std::string fund_id = knock->fund_id;
-    std::string order_no = knock->order_no;
-    std::string key = CreateOrderNoKey(fund_id, order_no);
-    auto itr = single_orders_.find(key);
-    if (itr != single_orders_.end()) {
-        auto& order = itr->second;
+    int32_t fund = funds_.Find(knock->fund_id);
+    auto opt = GetOption(fund);
+    if (!opt) {
+        return;
+    }
+    const char* fund_id = knock->fund_id;
+    const char* order_no = knock->order_no;
+    auto found = FindSingleOrder(fund, fund_id, order_no);
+    if (found) {
+        OrderPtr order = *found;
         if (knock->match_type == kMatchTypeOK) {
             order->match_volume += knock->match_volume;
         } else if (knock->match_type == kMatchTypeWithdrawOK ||
@@ -223,99 +259,183 @@ void AntiSelfKnockRisker::OnTradeKnock(MemTradeKnock* knock) {
             return;
         }
         // 先收到成交回报, 后收到报单响应
-        auto opt = GetOption(fund_id);
-        if (!opt) {
-            return;
-        }
-        std::string code = knock->code;
+        std::string_view code = knock->code;
         bool only_etf = opt->only_etf();
         if (!only_etf || IsETF(code)) {
-            auto it = knock_first_orders_.find(key);
-            if (it == knock_first_orders_.end()) {
+            uint64_t key = CreateOrderNoKey(fund, order_no);
+            auto it = knock_first_orders_.Find(key, [&](const std::unique_ptr<std::vector<MemTradeKnock>>& v) {
+                return strcmp(v->front().order_no, order_no) == 0 && strcmp(v->front().fund_id, fund_id) == 0;
+            });
+            if (!it) {
                 std::unique_ptr<std::vector<MemTradeKnock>> knocks = std::make_unique<std::vector<MemTradeKnock>>();
                 knocks->push_back(*knock);
-                knock_first_orders_.insert(std::make_pair(key, std::move(knocks)));
+                knock_first_orders_.Insert(key, std::move(knocks));
             } else {
-                it->second->push_back(*knock);
+                (*it)->push_back(*knock);
             }
-            std::string match_no = knock->match_no;
             LOG_INFO << "knock first, order_no second, fund_id: " << fund_id
                      << ", code: " << code
                      << ", order_no: " << order_no
-                     << ", match_no: " << match_no
+                     << ", match_no: " << knock->match_no
                      << ", match_type: " << knock->match_type
                      << ", match_volume: " << knock->match_volume;
         }
     }
 }
 
-AntiSelfKnockOption* AntiSelfKnockRisker::GetOption(const std::string& fund_id) {
-    AntiSelfKnockOption* ret = nullptr;
-    auto itr = options_.find(fund_id);
-    if (itr != options_.end()) {
-        ret = itr->second;
+AntiSelfKnockOption* AntiSelfKnockRisker::GetOption(int32_t fund) {
+    if (fund >= 0 && fund < (int32_t)options_.size()) {
+        return options_[fund];
     }
-    return ret;
+    return nullptr;
 }
 
-OrderBook* AntiSelfKnockRisker::MustGetOrderBook(const std::string& code) {
-    OrderBook* book = nullptr;
-    auto itr = order_books_.find(code);
-    if (itr != order_books_.end()) {
-        book = itr->second;
-    } else {
-        book = new OrderBook(this);
-        order_books_[code] = book;
+OrderBook* AntiSelfKnockRisker::MustGetOrderBook(std::string_view code) {
+    int32_t id = codes_.Intern(code);
+    if (id >= (int32_t)order_books_.size()) {
+        order_books_.resize(id + 1, nullptr);
+    }
+    OrderBook*& book = order_books_[id];
+    if (!book) {
+        book = new OrderBook(this, code);
     }
     return book;
 }
 
-OrderBook* AntiSelfKnockRisker::TryGetOrderBook(const std::string& code) {
-    OrderBook* book = nullptr;
-    auto itr = order_books_.find(code);
-    if (itr != order_books_.end()) {
-        book = itr->second;
+OrderBook* AntiSelfKnockRisker::TryGetOrderBook(std::string_view code) {
+    int32_t id = codes_.Find(code);
+    if (id >= 0 && id < (int32_t)order_books_.size()) {
+        return order_books_[id];
     }
-    return book;
+    return nullptr;
 }
 
-bool AntiSelfKnockRisker::IsETF(const std::string& code) {
-    bool ok = false;
-    if (code.size() == 9) {
-        std::string code_prefix1 = code.substr(0, 3);
-        std::string code_prefix2 = code.substr(0, 2);
-        std::string code_suffix = code.substr(6);
-        if ((x::EndsWith(code, co::kSuffixSZ) && x::StartsWith(code, "159")) ||
-            (x::EndsWith(code, co::kSuffixSH) && x::StartsWith(code, "5"))) {
-            ok = true;
-        }
-    }
-    return ok;
+bool AntiSelfKnockRisker::IsETF(std::string_view code) {
+    const Instrument* instrument = InstrumentDict::Instance()->Get(code);
+    return instrument && instrument->etf();
+}
+
+uint64_t AntiSelfKnockRisker::CreateOrderNoKey(int32_t fund, std::string_view key) {
+    return MixHash(HashBytes(key) ^ (static_cast<uint64_t>(fund) * 0x9E3779B97F4A7C15ULL));
 }
 
-std::string AntiSelfKnockRisker::CreateOrderNoKey(const std::string_view& fund_id, const std::string_view& key) {
-    std::string result;
-    result.reserve(fund_id.size() + 1 + key.size());
-    result += fund_id;
-    result += "#";
-    result += key;
-    return result;
+OrderPtr* AntiSelfKnockRisker::FindSingleOrder(int32_t fund, const char* fund_id, const char* order_no) {
+    return single_orders_.Find(CreateOrderNoKey(fund, order_no), [&](const OrderPtr& order) {
+        return strcmp(order->order_no, order_no) == 0 && strcmp(order->fund_id, fund_id) == 0;
+    });
+}
+
+std::vector<OrderPtr>* AntiSelfKnockRisker::FindBatchOrders(int32_t fund, const char* fund_id, const char* batch_no) {
+    auto orders = batch_orders_.Find(CreateOrderNoKey(fund, batch_no), [&](const std::unique_ptr<std::vector<OrderPtr>>& v) {
+        return !v->empty() && strcmp(v->front()->batch_no, batch_no) == 0 && strcmp(v->front()->fund_id, fund_id) == 0;
+    });
+    return orders ? orders->get() : nullptr;
 }
 
 void AntiSelfKnockRisker::OnTick(MemQTickBody* tick) {
-    std::string code = tick->code;
+    std::string_view code(tick->code, strnlen(tick->code, sizeof(tick->code)));
+    if (!tick_filter_.MayContain(code)) {
+        return;
+    }
     auto book = TryGetOrderBook(code);
     if (book) {
         book->OnTick(tick);
     }
 }
 
+void AntiSelfKnockRisker::EnableSharedBook(const std::string& filename, int64_t slots) {
+    shared_book_.Open(filename, slots);
+}
+
+std::string AntiSelfKnockRisker::CheckSharedBook(MemTradeOrder* order, int64_t bs_flag, int64_t order_price, int64_t date) {
+    if (!shared_book_.is_open()) {
+        return "";
+    }
+    SharedBookOrder hit;
+    int64_t ret = shared_book_.FindCross(order->code, bs_flag, order_price, date, &hit);
+    if (ret == kSharedBookPass) {
+        return "";
+    }
+    std::stringstream ss;
+    if (ret == kSharedBookFull) {
+        // 通过后无法写入共享挂单表，其它broker检查不到这笔挂单
+        ss << "[FAN-RISK-ERROR][防对敲]风控检查失败，共享挂单表已满，slots: " << shared_book_.slots()
+           << ", code: " << order->code;
+        return ss.str();
+    }
+    if (ret == kSharedBookBusy) {
+        ss << "[FAN-RISK-ERROR][防对敲]风控检查失败，共享挂单表的槽位被其它broker长时间锁住，code: " << order->code;
+        return ss.str();
+    }
+    ss << "[FAN-RISK-ERROR][防对敲]风控检查失败，存在" << (hit.bs_flag == kBsFlagBuy ? "买入" : "卖出") << "挂单："
+    << GetAccountInfo(hit.fund_id)
+    << "[" << x::RawTimeText(hit.timestamp%1000000000LL) << "]"
+    << "[" << hit.code << "]"
+    << " price: " << DecodePrice(hit.price)
+    << ", volume: " << hit.volume
+    << ", order_no: " << hit.order_no;
+    return ss.str();
+}
+
+void AntiSelfKnockRisker::OnOrderRemoved(Order* order) {
+    if (order->shared_entry) {
+        shared_book_.Remove(order->shared_entry, order->shared_serial);
+        order->shared_entry = nullptr;
+    }
+}
+
+void AntiSelfKnockRisker::OnBookInterest(std::string_view code, bool interested) {
+    if (interested) {
+        tick_filter_.Add(code);
+    } else {
+        tick_filter_.Remove(code);
+    }
+}
+
+OrderPtr AntiSelfKnockRisker::CreateOrder() {
+    return pool_.Create();
+}
+
+void AntiSelfKnockRisker::OnTimer(int64_t now) {
+    timer_wheel_.Advance(now, &expired_orders_);
+    if (expired_orders_.empty()) {
+        return;
+    }
+    for (auto& order : expired_orders_) {
+        if (order->IsExpired(now)) {
+            order->finish_flag = true;
+            OnOrderFinish(order);
+        }
+    }
+    expired_orders_.clear();
+}
+
+void AntiSelfKnockRisker::ScheduleOrder(const OrderPtr& order, int64_t deadline) {
+    order->deadline = deadline;
+    timer_wheel_.Schedule(order, deadline);
+}
+
+void AntiSelfKnockRisker::OnWithdrawFailed(const OrderPtr& order, int64_t now) {
+    order->withdraw_failed_time = now;
+    ScheduleOrder(order, now + kOrderTimeoutMS + 1);
+}
+
+void AntiSelfKnockRisker::RemoveFromBook(Order* order) {
+    if (order->in_book) {
+        auto book = TryGetOrderBook(order->code);
+        if (book) {
+            book->Remove(order);
+        }
+    }
+}
+
 void AntiSelfKnockRisker::OnOrderFinish(OrderPtr order) {
-    if (!order->batch_no.empty()) {
-        std::string key = CreateOrderNoKey(order->fund_id, order->batch_no);
-        auto itr = batch_orders_.find(key);
-        if (itr != batch_orders_.end()) {
-            auto& orders = itr->second;
+    order->deadline = 0;
+    RemoveFromBook(order.get());
+    int32_t fund = funds_.Find(order->fund_id);
+    if (order->batch_no[0] != '\0') {
+        auto orders = FindBatchOrders(fund, order->fund_id, order->batch_no);
+        if (orders) {
             bool all_finished = true;
             for (auto& active_order: *orders) {
                 if (!active_order->IsFinished()) {
@@ -324,13 +444,16 @@ void AntiSelfKnockRisker::OnOrderFinish(OrderPtr order) {
                 }
             }
             if (all_finished) {
-                batch_orders_.erase(itr);
+                batch_orders_.Erase(CreateOrderNoKey(fund, order->batch_no), [&](const std::unique_ptr<std::vector<OrderPtr>>& v) {
+                    return v.get() == orders;
+                });
             }
         }
     }
-    if (!order->order_no.empty()) {
-        std::string key = CreateOrderNoKey(order->fund_id, order->order_no);
-        single_orders_.erase(key);
+    if (order->order_no[0] != '\0') {
+        single_orders_.Erase(CreateOrderNoKey(fund, order->order_no), [&](const OrderPtr& v) {
+            return v.get() == order.get();
+        });
     }
 }
-}  // namespace co
+}  // namespace co
\ No newline at end of file
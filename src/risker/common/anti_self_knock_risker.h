@@ -2,6 +2,10 @@
 #pragma once
 #include "../base_risker.h"
 #include "order_book.h"
+#include "hash_index.h"
+#include "order_timer.h"
+#include "code_filter.h"
+#include "shared_order_book.h"
 
 namespace co {
 class OrderBook;
@@ -49,24 +53,46 @@ class AntiSelfKnockRisker : public Risker {
     void OnTick(MemQTickBody* tick);
 
     void OnOrderFinish(OrderPtr order);
+    OrderPtr CreateOrder();
+    // 开启同一台服务器上所有broker共用的挂单表，开启后不再需要回放其它broker的委托回报
+    void EnableSharedBook(const std::string& filename, int64_t slots = kSharedOrderBookSlots);
+    std::string CheckSharedBook(MemTradeOrder* order, int64_t bs_flag, int64_t order_price, int64_t date);
+    void OnOrderRemoved(Order* order);
+    // 订单薄由空变为有挂单或挂单全部删除时回调，用于维护行情过滤器
+    void OnBookInterest(std::string_view code, bool interested);
+    // 推进超时时间轮，到期的委托从订单薄中删除，由风控线程定期调用
+    void OnTimer(int64_t now);
 
  private:
-    AntiSelfKnockOption* GetOption(const std::string& fund_id);
-    OrderBook* MustGetOrderBook(const std::string& code);
-    OrderBook* TryGetOrderBook(const std::string& code);
-    bool IsETF(const std::string& code);
-    std::string CreateOrderNoKey(const std::string_view& fund_id, const std::string_view& key);
+    AntiSelfKnockOption* GetOption(int32_t fund);
+    OrderBook* MustGetOrderBook(std::string_view code);
+    OrderBook* TryGetOrderBook(std::string_view code);
+    bool IsETF(std::string_view code);
+    uint64_t CreateOrderNoKey(int32_t fund, std::string_view key);
+    OrderPtr* FindSingleOrder(int32_t fund, const char* fund_id, const char* order_no);
+    std::vector<OrderPtr>* FindBatchOrders(int32_t fund, const char* fund_id, const char* batch_no);
+    void ScheduleOrder(const OrderPtr& order, int64_t deadline);
+    void OnWithdrawFailed(const OrderPtr& order, int64_t now);
+    void RemoveFromBook(Order* order);
 
  private:
-    std::unordered_map<std::string, AntiSelfKnockOption*> options_;  // fund_id -> option
-
-    // 订单薄，委托结束后不一定会立即删除，最迟删除时机是在风控检查时；code -> OrderBook
-    std::unordered_map<std::string, OrderBook*> order_books_;
+    OrderPool pool_;  // 委托对象池，须在所有持有委托的容器之前声明，最后析构
+    OrderTimerWheel timer_wheel_;  // 委托响应超时和撤单失败超时
+    std::vector<OrderPtr> expired_orders_;
+    StringInterner funds_;  // fund_id -> 编号
+    StringInterner codes_;  // code -> 编号
+    std::vector<AntiSelfKnockOption*> options_;  // 资金账号编号 -> option
+
+    // 订单薄，委托结束后不一定会立即删除，最迟删除时机是在风控检查时；证券代码编号 -> OrderBook
+    std::vector<OrderBook*> order_books_;
+    SharedOrderBook shared_book_;
+    CodeFilter tick_filter_;  // 有挂单的证券代码，其它代码的行情直接跳过
+    // 以下索引的键为(资金账号编号, 合同号/批次号)的64位哈希值，查找时再校验资金账号和合同号/批次号
     // 单笔委托，委托结束后立即删除 <fund_id>#<order_no> -> order
-    std::unordered_map<std::string, OrderPtr> single_orders_;
+    HashIndex<OrderPtr> single_orders_;
     // 批量委托，委托全部结束后立即删除 <fund_id>#<batch_no> -> orders
-    std::unordered_map<std::string, std::unique_ptr<std::vector<OrderPtr>>> batch_orders_;
-    // 先收到成交回报, 后收到报单响应
-    std::unordered_map<std::string, std::unique_ptr<std::vector<MemTradeKnock>>> knock_first_orders_;
+    HashIndex<std::unique_ptr<std::vector<OrderPtr>>> batch_orders_;
+    // 先收到成交回报, 后收到报单响应 <fund_id>#<order_no> -> knocks
+    HashIndex<std::unique_ptr<std::vector<MemTradeKnock>>> knock_first_orders_;
 };
 }  // namespace co
\ No newline at end of file
@@ -0,0 +1,52 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace co {
+/**
+ * 证券代码过滤器：按代码哈希值映射到位图，位图中为1的代码才可能是关注的代码（存在哈希冲突，命中后仍需精确查找）。
+ * 每个位对应一个计数，同一位上的关注代码全部取消后才清零。
+ */
+class CodeFilter {
+ public:
+    static constexpr int64_t kBits = 1 << 16;
+
+    CodeFilter(): words_(kBits / 64, 0), counts_(kBits, 0) {
+    }
+
+    void Add(std::string_view code) {
+        uint32_t bit = Bit(code);
+        if (counts_[bit]++ == 0) {
+            words_[bit >> 6] |= (1ULL << (bit & 63));
+        }
+    }
+
+    void Remove(std::string_view code) {
+        uint32_t bit = Bit(code);
+        if (counts_[bit] > 0 && --counts_[bit] == 0) {
+            words_[bit >> 6] &= ~(1ULL << (bit & 63));
+        }
+    }
+
+    [[nodiscard]] inline bool MayContain(std::string_view code) const {
+        uint32_t bit = Bit(code);
+        return (words_[bit >> 6] >> (bit & 63)) & 1ULL;
+    }
+
+ private:
+    static inline uint32_t Bit(std::string_view code) {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : code) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return static_cast<uint32_t>((h ^ (h >> 32)) & (kBits - 1));
+    }
+
+ private:
+    std::vector<uint64_t> words_;
+    std::vector<int32_t> counts_;
+};
+}  // namespace co
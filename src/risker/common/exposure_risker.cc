@@ -0,0 +1,322 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <cstring>
+#include "exposure_risker.h"
+
+namespace co {
+void ExposureRisker::Init(std::shared_ptr<RiskOptions> opt) {
+    tag_ = "[" + opt->fund_id() + "-" + opt->GetStr("name") + "]";
+    UpdateLimits(*opt);
+}
+
+void ExposureRisker::UpdateLimits(const RiskOptions& opt) {
+    max_code_notional_ = opt.GetFloat64("max_code_notional");
+    max_total_notional_ = opt.GetFloat64("max_total_notional");
+    check_usable_ = opt.GetBool("check_usable");
+    check_can_close_ = opt.GetBool("check_can_close");
+    LOG_INFO << "[risk][exposure] load limits ok: " << tag_
+             << ", max_code_notional: " << max_code_notional_
+             << ", max_total_notional: " << max_total_notional_
+             << ", check_usable: " << std::boolalpha << check_usable_
+             << ", check_can_close: " << check_can_close_;
+}
+
+int32_t ExposureRisker::GetCode(std::string_view code) {
+    int32_t id = codes_.Intern(code);
+    if (id >= (int32_t)exposures_.size()) {
+        exposures_.emplace_back();
+    }
+    return id;
+}
+
+const CodeExposure* ExposureRisker::GetExposure(std::string_view code) const {
+    int32_t id = codes_.Find(code);
+    return id >= 0 ? &exposures_[id] : nullptr;
+}
+
+int32_t ExposureRisker::FindRequest(const char* id) const {
+    const int32_t* index = pending_index_.Find(MixHash(HashBytes(id)), [&](int32_t v) {
+        return strcmp(pending_reqs_[v].id, id) == 0;
+    });
+    return index ? *index : -1;
+}
+
+void ExposureRisker::AddRequest(const char* id, int64_t items) {
+    if (FindRequest(id) >= 0) {
+        return;
+    }
+    int32_t index = 0;
+    if (!free_reqs_.empty()) {
+        index = free_reqs_.back();
+        free_reqs_.pop_back();
+    } else {
+        index = (int32_t)pending_reqs_.size();
+        pending_reqs_.emplace_back();
+    }
+    ExposureRequest& req = pending_reqs_[index];
+    strncpy(req.id, id, sizeof(req.id) - 1);
+    req.id[sizeof(req.id) - 1] = '\0';
+    req.items = items;
+    pending_index_.Insert(MixHash(HashBytes(req.id)), index);
+}
+
+void ExposureRisker::EraseRequest(int32_t index) {
+    ExposureRequest& req = pending_reqs_[index];
+    pending_index_.Erase(MixHash(HashBytes(req.id)), [&](int32_t v) { return v == index; });
+    req.id[0] = '\0';
+    free_reqs_.emplace_back(index);
+}
+
+int32_t ExposureRisker::FindOrder(const char* order_no) const {
+    const int32_t* index = order_index_.Find(MixHash(HashBytes(order_no)), [&](int32_t v) {
+        return strcmp(orders_[v].order_no, order_no) == 0;
+    });
+    return index ? *index : -1;
+}
+
+void ExposureRisker::AddOrder(const char* order_no, const ExposureOrder& order) {
+    int32_t index = FindOrder(order_no);
+    if (index < 0) {
+        if (!free_orders_.empty()) {
+            index = free_orders_.back();
+            free_orders_.pop_back();
+        } else {
+            index = (int32_t)orders_.size();
+            orders_.emplace_back();
+        }
+        order_index_.Insert(MixHash(HashBytes(order_no)), index);
+    }
+    ExposureOrder& slot = orders_[index];
+    slot = order;
+    strncpy(slot.order_no, order_no, sizeof(slot.order_no) - 1);
+    slot.order_no[sizeof(slot.order_no) - 1] = '\0';
+}
+
+void ExposureRisker::EraseOrder(int32_t index) {
+    ExposureOrder& order = orders_[index];
+    order_index_.Erase(MixHash(HashBytes(order.order_no)), [&](int32_t v) { return v == index; });
+    order = ExposureOrder();
+    free_orders_.emplace_back(index);
+}
+
+// 占用资金的委托：普通买入和买券还券
+bool ExposureRisker::IsCashOrder(int64_t bs_flag, int64_t oc_flag) const {
+    return bs_flag == kBsFlagBuy && (oc_flag == kOcFlagAuto || oc_flag == kOcFlagClose);
+}
+
+// 占用可卖数量的委托：普通卖出
+bool ExposureRisker::IsCloseOrder(int64_t bs_flag, int64_t oc_flag) const {
+    return bs_flag == kBsFlagSell && oc_flag == kOcFlagAuto;
+}
+
+std::string ExposureRisker::HandleTradeOrderReq(MemTradeOrderMessage* req) {
+    // 同一篮子中可能有重复的证券代码，先在各代码的临时字段中累计，检查结束后清零
+    std::string error;
+    double basket_cash = 0;
+    double basket_notional = 0;
+    int i = 0;
+    for (; i < req->items_size; i++) {
+        MemTradeOrder* order = req->items + i;
+        int32_t code = GetCode(order->code);
+        CodeExposure& exposure = exposures_[code];
+        if (IsCashOrder(req->bs_flag, order->oc_flag)) {
+            double notional = order->price * order->volume;
+            basket_cash += notional;
+            basket_notional += notional;
+            exposure.basket_notional += notional;
+            if (check_usable_ && has_asset_ && basket_cash > usable_) {
+                error = CreateError(order, "可用资金不足", basket_cash, usable_);
+            } else if (max_code_notional_ > 0 &&
+                exposure.market_value + exposure.open_notional + exposure.basket_notional > max_code_notional_) {
+                error = CreateError(order, "单个证券敞口超限",
+                    exposure.market_value + exposure.open_notional + exposure.basket_notional, max_code_notional_);
+            } else if (max_total_notional_ > 0 && total_notional_ + basket_notional > max_total_notional_) {
+                error = CreateError(order, "账户敞口超限", total_notional_ + basket_notional, max_total_notional_);
+            }
+        } else if (IsCloseOrder(req->bs_flag, order->oc_flag)) {
+            exposure.basket_sell += order->volume;
+            if (check_can_close_ && has_positions_ && exposure.basket_sell > exposure.can_close) {
+                error = CreateError(order, "可卖数量不足", exposure.basket_sell, exposure.can_close);
+            }
+        }
+        if (!error.empty()) {
+            i++;
+            break;
+        }
+    }
+    for (int j = 0; j < i; j++) {
+        CodeExposure& exposure = exposures_[codes_.Find(req->items[j].code)];
+        exposure.basket_notional = 0;
+        exposure.basket_sell = 0;
+    }
+    return error;
+}
+
+void ExposureRisker::OnTradeOrderReqPass(MemTradeOrderMessage* req) {
+    bool reserved = false;
+    for (int i = 0; i < req->items_size; i++) {
+        MemTradeOrder* order = req->items + i;
+        int32_t code = GetCode(order->code);
+        CodeExposure& exposure = exposures_[code];
+        if (IsCashOrder(req->bs_flag, order->oc_flag)) {
+            double notional = order->price * order->volume;
+            usable_ -= notional;
+            pending_notional_ += notional;
+            exposure.open_notional += notional;
+            total_notional_ += notional;
+            reserved = true;
+        } else if (IsCloseOrder(req->bs_flag, order->oc_flag)) {
+            exposure.can_close -= order->volume;
+            exposure.pending_sell += order->volume;
+            reserved = true;
+        }
+    }
+    if (reserved) {
+        AddRequest(req->id, req->items_size);
+    }
+}
+
+void ExposureRisker::HandleTradeOrderRep(MemTradeOrderMessage* rep) {
+    int32_t req = FindRequest(rep->id);
+    if (req < 0) {
+        return;
+    }
+    // 同一请求的委托全部收到响应后才删除
+    pending_reqs_[req].items -= rep->items_size;
+    if (pending_reqs_[req].items <= 0) {
+        EraseRequest(req);
+    }
+    for (int i = 0; i < rep->items_size; i++) {
+        MemTradeOrder* item = rep->items + i;
+        ExposureOrder order;
+        order.code = GetCode(item->code);
+        order.bs_flag = rep->bs_flag;
+        order.oc_flag = item->oc_flag;
+        order.price = item->price;
+        order.volume = item->volume;
+        bool cash = IsCashOrder(order.bs_flag, order.oc_flag);
+        bool close = IsCloseOrder(order.bs_flag, order.oc_flag);
+        if (!cash && !close) {
+            continue;
+        }
+        if (cash) {
+            pending_notional_ -= order.price * order.volume;
+        } else {
+            exposures_[order.code].pending_sell -= order.volume;
+        }
+        if (item->order_no[0] == '\0') {  // 废单
+            Release(order, order.volume);
+            continue;
+        }
+        if (!early_knocks_.empty()) {
+            uint64_t key = MixHash(HashBytes(item->order_no));
+            auto match_knocks = [&](const std::unique_ptr<std::vector<MemTradeKnock>>& v) {
+                return strcmp(v->front().order_no, item->order_no) == 0;
+            };
+            if (auto knocks = early_knocks_.Find(key, match_knocks); knocks) {
+                for (auto& knock : **knocks) {
+                    ApplyKnock(&order, &knock);
+                }
+                early_knocks_.Erase(key, match_knocks);
+            }
+        }
+        if (order.volume > 0) {
+            AddOrder(item->order_no, order);
+        }
+    }
+    if (pending_index_.empty() && !early_knocks_.empty()) {
+        // 没有等待响应的委托时，剩下的暂存成交回报都属于启动之前的委托，不再需要
+        early_knocks_.Clear();
+    }
+}
+
+void ExposureRisker::OnTradeKnock(MemTradeKnock* knock) {
+    if (knock->order_no[0] == '\0' || knock->match_volume <= 0) {
+        return;
+    }
+    int32_t index = FindOrder(knock->order_no);
+    if (index < 0) {
+        // 有委托等待响应时，成交回报可能先于委托响应到达，暂存到收到委托响应时处理
+        if (!pending_index_.empty()) {
+            uint64_t key = MixHash(HashBytes(knock->order_no));
+            auto knocks = early_knocks_.Find(key, [&](const std::unique_ptr<std::vector<MemTradeKnock>>& v) {
+                return strcmp(v->front().order_no, knock->order_no) == 0;
+            });
+            if (knocks) {
+                (*knocks)->push_back(*knock);
+            } else {
+                early_knocks_.Insert(key, std::make_unique<std::vector<MemTradeKnock>>(1, *knock));
+            }
+        }
+        return;
+    }
+    ApplyKnock(&orders_[index], knock);
+    if (orders_[index].volume <= 0) {
+        EraseOrder(index);
+    }
+}
+
+void ExposureRisker::ApplyKnock(ExposureOrder* order, MemTradeKnock* knock) {
+    int64_t volume = knock->match_volume < order->volume ? knock->match_volume : order->volume;
+    if (volume <= 0) {
+        return;
+    }
+    if (knock->match_type == kMatchTypeOK) {
+        order->volume -= volume;
+        CodeExposure& exposure = exposures_[order->code];
+        double amount = knock->match_amount > 0 ? knock->match_amount : knock->match_price * volume;
+        if (IsCashOrder(order->bs_flag, order->oc_flag)) {
+            // 冻结按委托价格，成交按成交金额，差额退回可用资金
+            double notional = order->price * volume;
+            usable_ += notional - amount;
+            exposure.open_notional -= notional;
+            exposure.market_value += amount;
+            total_notional_ += amount - notional;
+        } else {
+            double value = exposure.market_value < amount ? exposure.market_value : amount;
+            usable_ += amount;
+            exposure.market_value -= value;
+            total_notional_ -= value;
+        }
+    } else if (knock->match_type == kMatchTypeWithdrawOK || knock->match_type == kMatchTypeFailed) {
+        order->volume -= volume;
+        Release(*order, volume);
+    }
+}
+
+void ExposureRisker::Release(const ExposureOrder& order, int64_t volume) {
+    CodeExposure& exposure = exposures_[order.code];
+    if (IsCashOrder(order.bs_flag, order.oc_flag)) {
+        double notional = order.price * volume;
+        usable_ += notional;
+        exposure.open_notional -= notional;
+        total_notional_ -= notional;
+    } else if (IsCloseOrder(order.bs_flag, order.oc_flag)) {
+        exposure.can_close += volume;
+    }
+}
+
+void ExposureRisker::OnTradeAsset(MemTradeAsset* asset) {
+    // 快照中已经扣除了柜台收到的委托，只需扣除还没有收到委托响应的买单
+    has_asset_ = true;
+    usable_ = asset->usable - pending_notional_;
+}
+
+void ExposureRisker::OnTradePosition(MemTradePosition* position) {
+    has_positions_ = true;
+    CodeExposure& exposure = exposures_[GetCode(position->code)];
+    exposure.can_close = position->long_can_close - exposure.pending_sell;
+    total_notional_ += position->long_market_value - exposure.market_value;
+    exposure.market_value = position->long_market_value;
+}
+
+std::string ExposureRisker::CreateError(MemTradeOrder* order, const char* rule, double value, double limit) {
+    std::stringstream ss;
+    ss << "[FAN-RISK-ERROR][" << rule << "]风控检查失败：" << tag_
+       << "[" << order->code << "]"
+       << " price: " << order->price
+       << ", volume: " << order->volume
+       << ", value: " << value
+       << ", limit: " << limit;
+    return ss.str();
+}
+}  // namespace co
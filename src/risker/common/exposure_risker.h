@@ -0,0 +1,105 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <string>
+#include <memory>
+#include <vector>
+#include "../base_risker.h"
+#include "hash_index.h"
+
+namespace co {
+// 单个证券代码的敞口
+struct CodeExposure {
+    int64_t can_close = 0;  // 可卖数量：持仓快照的可卖数量减去之后报出的卖单
+    double market_value = 0;  // 持仓市值：持仓快照的市值加上之后的买入成交金额
+    double open_notional = 0;  // 未成交的买单金额
+    int64_t pending_sell = 0;  // 已报出但还没有收到委托响应的卖单数量
+    double basket_notional = 0;  // 检查篮子时的临时累计
+    int64_t basket_sell = 0;  // 检查篮子时的临时累计
+};
+
+// 已通过检查、等待委托响应的委托请求
+struct ExposureRequest {
+    char id[sizeof(MemTradeOrderMessage::id)] = "";  // 空表示槽位空闲
+    int64_t items = 0;  // 还没有收到响应的委托个数，拆分篮子到期后的响应可能分多次返回
+};
+
+// 已报出的委托，用于撤单和成交时释放冻结
+struct ExposureOrder {
+    char order_no[sizeof(MemTradeOrder::order_no)] = "";  // 空表示槽位空闲
+    int32_t code = 0;
+    int64_t bs_flag = 0;
+    int64_t oc_flag = 0;
+    double price = 0;
+    int64_t volume = 0;  // 未成交且未撤单的数量
+};
+
+/**
+ * 持仓和资金敞口风控：以柜台的资金和持仓快照为基础，根据委托、委托响应和成交回报增量维护可用资金、
+ * 每个证券代码的可卖数量和市值，事前检查篮子中的每个委托，不需要等待柜台拒单；按股票T+1规则处理。
+ */
+class ExposureRisker : public Risker {
+ public:
+    void Init(std::shared_ptr<RiskOptions> opt);
+    // 运行时更新限额，已有的敞口不变
+    void UpdateLimits(const RiskOptions& opt);
+
+    std::string HandleTradeOrderReq(MemTradeOrderMessage* req);
+    void OnTradeOrderReqPass(MemTradeOrderMessage* req);
+    void HandleTradeOrderRep(MemTradeOrderMessage* rep);
+    void OnTradeKnock(MemTradeKnock* knock);
+    void OnTradeAsset(MemTradeAsset* asset);
+    void OnTradePosition(MemTradePosition* position);
+
+    [[nodiscard]] inline double usable() const {
+        return usable_;
+    }
+
+    [[nodiscard]] inline double total_notional() const {
+        return total_notional_;
+    }
+
+    [[nodiscard]] inline double pending_notional() const {
+        return pending_notional_;
+    }
+
+    // 证券代码不存在时返回nullptr
+    [[nodiscard]] const CodeExposure* GetExposure(std::string_view code) const;
+
+ private:
+    int32_t GetCode(std::string_view code);
+    int32_t FindRequest(const char* id) const;
+    void AddRequest(const char* id, int64_t items);
+    void EraseRequest(int32_t index);
+    int32_t FindOrder(const char* order_no) const;
+    void AddOrder(const char* order_no, const ExposureOrder& order);
+    void EraseOrder(int32_t index);
+    bool IsCashOrder(int64_t bs_flag, int64_t oc_flag) const;
+    bool IsCloseOrder(int64_t bs_flag, int64_t oc_flag) const;
+    // 释放委托中撤单或废单的数量
+    void Release(const ExposureOrder& order, int64_t volume);
+    void ApplyKnock(ExposureOrder* order, MemTradeKnock* knock);
+    std::string CreateError(MemTradeOrder* order, const char* rule, double value, double limit);
+
+ private:
+    std::string tag_;
+    double max_code_notional_ = 0;  // 单个证券代码最大敞口（持仓市值+未成交买单），0-不检查
+    double max_total_notional_ = 0;  // 账户最大敞口，0-不检查
+    bool check_usable_ = false;  // 是否检查可用资金
+    bool check_can_close_ = false;  // 是否检查可卖数量
+
+    bool has_asset_ = false;  // 是否收到过资金快照，收到之前不检查可用资金
+    bool has_positions_ = false;  // 是否收到过持仓快照，收到之前不检查可卖数量
+    double usable_ = 0;  // 可用资金：资金快照的可用资金减去之后报出的买单
+    double pending_notional_ = 0;  // 已报出但还没有收到委托响应的买单金额
+    double total_notional_ = 0;  // 所有证券代码的持仓市值+未成交买单
+    StringInterner codes_;
+    std::vector<CodeExposure> exposures_;  // 证券代码编号 -> 敞口
+    std::vector<ExposureRequest> pending_reqs_;  // 槽位池，释放的槽位放入free_reqs_复用
+    std::vector<int32_t> free_reqs_;
+    HashIndex<int32_t> pending_index_;  // 委托请求ID -> pending_reqs_下标
+    std::vector<ExposureOrder> orders_;  // 槽位池，释放的槽位放入free_orders_复用
+    std::vector<int32_t> free_orders_;
+    HashIndex<int32_t> order_index_;  // 合同号 -> orders_下标
+    HashIndex<std::unique_ptr<std::vector<MemTradeKnock>>> early_knocks_;  // 先于委托响应收到的成交回报，按合同号索引
+};
+}  // namespace co
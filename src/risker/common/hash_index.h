@@ -0,0 +1,186 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace co {
+// FNV-1a 64位哈希
+inline uint64_t HashBytes(std::string_view data) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// 打散低位，避免线性探测时相邻键聚集
+inline uint64_t MixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * 以64位哈希值为键的开放寻址表（线性探测）。
+ * 不同字符串可能得到相同的哈希值，因此允许重复键，查找和删除时由调用方提供校验函数确认是否为目标元素。
+ */
+template <typename V>
+class HashIndex {
+ public:
+    explicit HashIndex(size_t capacity = 64) {
+        Rehash(capacity);
+    }
+
+    template <typename Pred>
+    V* Find(uint64_t key, Pred&& pred) {
+        Slot* slot = FindSlot(key, std::forward<Pred>(pred));
+        return slot ? &slot->value : nullptr;
+    }
+
+    template <typename Pred>
+    const V* Find(uint64_t key, Pred&& pred) const {
+        return const_cast<HashIndex*>(this)->Find(key, std::forward<Pred>(pred));
+    }
+
+    // 插入新元素，不检查是否已存在
+    V& Insert(uint64_t key, V value) {
+        if ((used_ + 1) * 4 > slots_.size() * 3) {
+            Rehash(size_ * 4 > slots_.size() ? slots_.size() * 2 : slots_.size());
+        }
+        size_t i = key & mask_;
+        while (slots_[i].state == kSlotFull) {
+            i = (i + 1) & mask_;
+        }
+        Slot& slot = slots_[i];
+        if (slot.state == kSlotEmpty) {
+            ++used_;
+        }
+        slot.state = kSlotFull;
+        slot.key = key;
+        slot.value = std::move(value);
+        ++size_;
+        return slot.value;
+    }
+
+    template <typename Pred>
+    bool Erase(uint64_t key, Pred&& pred) {
+        Slot* slot = FindSlot(key, std::forward<Pred>(pred));
+        if (!slot) {
+            return false;
+        }
+        slot->state = kSlotDeleted;
+        slot->value = V();
+        --size_;
+        return true;
+    }
+
+    void Clear() {
+        slots_.clear();
+        size_ = 0;
+        Rehash(64);
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] inline bool empty() const {
+        return size_ == 0;
+    }
+
+ private:
+    static constexpr int8_t kSlotEmpty = 0;
+    static constexpr int8_t kSlotFull = 1;
+    static constexpr int8_t kSlotDeleted = 2;
+
+    struct Slot {
+        uint64_t key = 0;
+        int8_t state = kSlotEmpty;
+        V value = V();
+    };
+
+    template <typename Pred>
+    Slot* FindSlot(uint64_t key, Pred&& pred) {
+        for (size_t i = key & mask_; slots_[i].state != kSlotEmpty; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.state == kSlotFull && slot.key == key && pred(slot.value)) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    void Rehash(size_t capacity) {
+        size_t n = 16;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        std::vector<Slot> old;
+        old.swap(slots_);
+        slots_.resize(n);
+        mask_ = n - 1;
+        size_ = 0;
+        used_ = 0;
+        for (auto& slot : old) {
+            if (slot.state == kSlotFull) {
+                size_t i = slot.key & mask_;
+                while (slots_[i].state != kSlotEmpty) {
+                    i = (i + 1) & mask_;
+                }
+                slots_[i].state = kSlotFull;
+                slots_[i].key = slot.key;
+                slots_[i].value = std::move(slot.value);
+                ++size_;
+                ++used_;
+            }
+        }
+    }
+
+ private:
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;  // 有效元素个数
+    size_t used_ = 0;  // 有效元素和已删除元素占用的槽位个数
+};
+
+// 字符串驻留：把资金账号、证券代码等字符串映射为从0开始的连续编号
+class StringInterner {
+ public:
+    // 不存在时返回-1
+    [[nodiscard]] int32_t Find(std::string_view name) const {
+        const int32_t* id = index_.Find(MixHash(HashBytes(name)), [&](int32_t v) { return names_[v] == name; });
+        return id ? *id : -1;
+    }
+
+    int32_t Intern(std::string_view name) {
+        uint64_t key = MixHash(HashBytes(name));
+        const int32_t* id = index_.Find(key, [&](int32_t v) { return names_[v] == name; });
+        if (id) {
+            return *id;
+        }
+        int32_t ret = static_cast<int32_t>(names_.size());
+        names_.emplace_back(name);
+        index_.Insert(key, ret);
+        return ret;
+    }
+
+    [[nodiscard]] inline const std::string& name(int32_t id) const {
+        return names_[id];
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return names_.size();
+    }
+
+ private:
+    std::vector<std::string> names_;
+    HashIndex<int32_t> index_;
+};
+}  // namespace co
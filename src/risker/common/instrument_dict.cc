@@ -0,0 +1,230 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include "instrument_dict.h"
+#include "hash_index.h"
+
+namespace co {
+namespace {
+constexpr size_t kHeaderSize = 64;
+constexpr int64_t kMaxSpin = 1 << 20;  // 写入方异常退出时槽位停留在写入状态，等待一段时间后跳过
+
+struct RepoTenor {
+    const char* code;
+    int32_t days;
+};
+
+constexpr RepoTenor kRepoTenors[] = {
+    {"204001.SH", 1}, {"204002.SH", 2}, {"204003.SH", 3}, {"204004.SH", 4}, {"204007.SH", 7},
+    {"204014.SH", 14}, {"204028.SH", 28}, {"204091.SH", 91}, {"204182.SH", 182},
+    {"131810.SZ", 1}, {"131811.SZ", 2}, {"131800.SZ", 3}, {"131809.SZ", 4}, {"131801.SZ", 7},
+    {"131802.SZ", 14}, {"131803.SZ", 28}, {"131805.SZ", 91}, {"131806.SZ", 182},
+};
+
+size_t DictSize() {
+    return kHeaderSize + sizeof(int32_t) * kInstrumentDictCapacity + sizeof(InstrumentSlot) * kInstrumentDictCapacity;
+}
+}  // namespace
+
+InstrumentDict* InstrumentDict::Instance() {
+    static InstrumentDict* instance = new InstrumentDict();  // 不析构，各线程可能一直持有字典中的指针
+    return instance;
+}
+
+InstrumentDict::InstrumentDict() {
+    size_t size = DictSize();
+    void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("mmap instrument dict failed");
+    }
+    Map(addr, size, true, "");
+}
+
+InstrumentDict::~InstrumentDict() {
+    Unmap();
+}
+
+void InstrumentDict::Open(const std::string& filename) {
+    if (size() > 0) {
+        throw std::runtime_error("instrument dict is already in use, open it before any lookup: " + filename);
+    }
+    std::filesystem::path path(filename);
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("open instrument dict failed: " + filename);
+    }
+    size_t size = DictSize();
+    ::flock(fd, LOCK_EX);
+    struct stat st = {};
+    ::fstat(fd, &st);
+    bool created = st.st_size == 0;
+    if ((created && ::ftruncate(fd, (off_t)size) != 0) || (!created && st.st_size != (off_t)size)) {
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+        throw std::runtime_error("illegal instrument dict size: " + std::to_string(st.st_size) + ", file: " + filename);
+    }
+    void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+        throw std::runtime_error("mmap instrument dict failed: " + filename);
+    }
+    auto header = reinterpret_cast<InstrumentDictHeader*>(addr);
+    if (!created && (header->magic != kInstrumentDictMagic || header->capacity != kInstrumentDictCapacity ||
+        header->slot_size != (int64_t)sizeof(InstrumentSlot))) {
+        ::munmap(addr, size);
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+        throw std::runtime_error("illegal instrument dict header: " + filename);
+    }
+    Unmap();
+    fd_ = fd;
+    Map(addr, size, created, filename);
+    ::flock(fd, LOCK_UN);
+}
+
+void InstrumentDict::Map(void* addr, size_t length, bool created, const std::string& filename) {
+    addr_ = addr;
+    size_ = length;
+    header_ = reinterpret_cast<InstrumentDictHeader*>(addr);
+    ids_ = reinterpret_cast<int32_t*>(static_cast<char*>(addr) + kHeaderSize);
+    slots_ = reinterpret_cast<InstrumentSlot*>(ids_ + kInstrumentDictCapacity);
+    if (created) {
+        header_->capacity = kInstrumentDictCapacity;
+        header_->slot_size = sizeof(InstrumentSlot);
+        header_->magic = kInstrumentDictMagic;
+    }
+    if (!filename.empty()) {
+        LOG_INFO << "[instrument] open dict ok: " << filename << ", created: " << std::boolalpha << created
+                 << ", size: " << size();
+    }
+}
+
+void InstrumentDict::Unmap() {
+    if (addr_) {
+        ::munmap(addr_, size_);
+        addr_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+const Instrument* InstrumentDict::Get(std::string_view code) {
+    uint64_t hash = MixHash(HashBytes(code));
+    int64_t mask = kInstrumentDictCapacity - 1;
+    int64_t i = (int64_t)(hash & mask);
+    for (int64_t n = 0; n < kInstrumentDictCapacity;) {
+        InstrumentSlot* slot = slots_ + i;
+        int32_t state = slot->state.load(std::memory_order_acquire);
+        if (state == 0) {
+            Instrument parsed;
+            if (!Parse(code, &parsed)) {
+                return nullptr;
+            }
+            int32_t expected = 0;
+            if (!slot->state.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+                continue;  // 其它线程或进程抢先占用了槽位，重新检查
+            }
+            Instrument* instrument = &slot->instrument;
+            memcpy(instrument->code, parsed.code, sizeof(instrument->code));
+            memcpy(instrument->product, parsed.product, sizeof(instrument->product));
+            instrument->market = parsed.market;
+            instrument->repo_days = parsed.repo_days;
+            instrument->tick_size = parsed.tick_size;
+            instrument->flags.store(parsed.flags.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            instrument->id = header_->size.fetch_add(1, std::memory_order_acq_rel);
+            ids_[instrument->id] = (int32_t)i;
+            slot->code_hash = hash;
+            slot->state.store(2, std::memory_order_release);
+            return instrument;
+        }
+        if (state == 1) {
+            int64_t spin = 0;
+            while (slot->state.load(std::memory_order_acquire) == 1 && ++spin < kMaxSpin) {
+                std::this_thread::yield();
+            }
+            if (spin < kMaxSpin) {
+                continue;
+            }
+        } else if (slot->code_hash == hash && code == slot->instrument.code) {
+            return &slot->instrument;
+        }
+        i = (i + 1) & mask;
+        ++n;
+    }
+    throw std::runtime_error("instrument dict is full, capacity: " + std::to_string(kInstrumentDictCapacity));
+}
+
+const Instrument* InstrumentDict::At(int32_t id) const {
+    if (id < 0 || id >= size()) {
+        return nullptr;
+    }
+    const InstrumentSlot* slot = slots_ + ids_[id];
+    if (slot->state.load(std::memory_order_acquire) != 2 || slot->instrument.id != id) {
+        return nullptr;
+    }
+    return &slot->instrument;
+}
+
+void InstrumentDict::SetT0(std::string_view code) {
+    if (auto instrument = const_cast<Instrument*>(Get(code)); instrument) {
+        instrument->flags.fetch_or(kInstrumentFlagT0, std::memory_order_relaxed);
+    }
+}
+
+bool InstrumentDict::Parse(std::string_view code, Instrument* instrument) {
+    if (code.empty() || code.size() >= sizeof(instrument->code)) {
+        return false;
+    }
+    int64_t market = co::CodeToMarket(std::string(code));
+    if (market <= 0) {
+        return false;
+    }
+    memset(instrument->code, 0, sizeof(instrument->code));
+    memset(instrument->product, 0, sizeof(instrument->product));
+    memcpy(instrument->code, code.data(), code.size());
+    instrument->id = -1;
+    instrument->market = market;
+    instrument->repo_days = 0;
+    instrument->tick_size = 0;
+    int32_t flags = 0;
+    if (market == kMarketSH || market == kMarketSZ || market == kMarketBJ) {
+        std::string_view symbol = code.substr(0, code.find('.'));
+        instrument->tick_size = 0.01;
+        if (symbol.size() == 6 && ((market == kMarketSH && symbol[0] == '5') || (market == kMarketSZ && symbol.substr(0, 3) == "159"))) {
+            flags |= kInstrumentFlagETF;
+            instrument->tick_size = 0.001;
+        } else if ((market == kMarketSH && symbol.substr(0, 3) == "204") || (market == kMarketSZ && symbol.substr(0, 4) == "1318")) {
+            flags |= kInstrumentFlagRepo;
+            instrument->tick_size = market == kMarketSH ? 0.005 : 0.001;
+            for (auto& tenor : kRepoTenors) {
+                if (code == tenor.code) {
+                    instrument->repo_days = tenor.days;
+                    break;
+                }
+            }
+        }
+    } else {
+        // 期货期权：代码开头的字母为品种，可以日内平仓
+        size_t n = 0;
+        while (n < code.size() && n + 1 < sizeof(instrument->product) && isalpha((unsigned char)code[n])) {
+            instrument->product[n] = code[n];
+            ++n;
+        }
+        flags |= kInstrumentFlagT0;
+    }
+    instrument->flags.store(flags, std::memory_order_relaxed);
+    return true;
+}
+}  // namespace co
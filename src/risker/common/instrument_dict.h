@@ -0,0 +1,107 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <atomic>
+#include <string>
+#include <string_view>
+
+#include "x/x.h"
+#include "coral/coral.h"
+
+namespace co {
+constexpr int64_t kInstrumentDictMagic = 0x494e535444494331;  // "INSTDIC1"
+constexpr int64_t kInstrumentDictCapacity = 1 << 16;  // 槽位个数，装载率不超过一半时探测次数很少
+
+constexpr int32_t kInstrumentFlagETF = 1;  // 场内ETF
+constexpr int32_t kInstrumentFlagRepo = 2;  // 债券质押式回购
+constexpr int32_t kInstrumentFlagT0 = 4;  // 可以当日回转交易
+
+/**
+ * 证券代码的静态属性，第一次查找时由代码推导，之后只读取整数字段。
+ * T+0标记可以在启动后由broker补充设置，因此单独使用原子变量。
+ */
+struct Instrument {
+    char code[32];
+    int32_t id;  // 紧凑编号，从0开始连续分配
+    int32_t repo_days;  // 回购期限（天），未知期限或非回购为0
+    int64_t market;
+    char product[8];  // 期货期权品种，如IF、cu，证券为空
+    double tick_size;  // 最小价格变动单位，未知为0
+    std::atomic<int32_t> flags;
+
+    [[nodiscard]] inline bool etf() const {
+        return flags.load(std::memory_order_relaxed) & kInstrumentFlagETF;
+    }
+
+    [[nodiscard]] inline bool repo() const {
+        return flags.load(std::memory_order_relaxed) & kInstrumentFlagRepo;
+    }
+
+    [[nodiscard]] inline bool t0() const {
+        return flags.load(std::memory_order_relaxed) & kInstrumentFlagT0;
+    }
+
+    [[nodiscard]] inline std::string_view product_view() const {
+        return product;
+    }
+};
+
+/**
+ * 字典槽位：state为0时空闲，1时正在写入，2时可以读取；写入方通过CAS独占空槽位。
+ */
+struct alignas(64) InstrumentSlot {
+    std::atomic<int32_t> state;
+    uint64_t code_hash;
+    Instrument instrument;
+};
+
+struct InstrumentDictHeader {
+    int64_t magic;
+    int64_t capacity;
+    int64_t slot_size;
+    std::atomic<int32_t> size;  // 已分配的编号个数
+};
+
+/**
+ * 证券代码字典：风控、流控和内部持仓共用，代码只在第一次出现时解析字符串，得到市场、品种、ETF、
+ * 回购期限、T+0和最小价格变动单位，之后每笔委托只做一次哈希查找。
+ * 槽位个数固定，可以映射到共享内存文件，同一台服务器上的broker共用同一份字典；查找无锁，多个线程可以同时使用。
+ */
+class InstrumentDict {
+ public:
+    static InstrumentDict* Instance();
+
+    InstrumentDict();
+    ~InstrumentDict();
+    InstrumentDict(const InstrumentDict&) = delete;
+    InstrumentDict& operator=(const InstrumentDict&) = delete;
+
+    // 改为使用共享内存文件，只能在第一次查找之前调用
+    void Open(const std::string& filename);
+
+    // 查找证券代码，不存在时推导后加入字典；无法识别市场的代码返回nullptr，不加入字典
+    const Instrument* Get(std::string_view code);
+    // 按编号查找，编号不存在时返回nullptr
+    const Instrument* At(int32_t id) const;
+    // 标记为T+0品种
+    void SetT0(std::string_view code);
+
+    [[nodiscard]] inline int32_t size() const {
+        return header_->size.load(std::memory_order_acquire);
+    }
+
+    // 由代码推导证券属性，不包括编号和T+0标记
+    static bool Parse(std::string_view code, Instrument* instrument);
+
+ private:
+    void Map(void* addr, size_t length, bool created, const std::string& filename);
+    void Unmap();
+
+ private:
+    int fd_ = -1;
+    void* addr_ = nullptr;
+    size_t size_ = 0;
+    InstrumentDictHeader* header_ = nullptr;
+    int32_t* ids_ = nullptr;  // 编号 -> 槽位
+    InstrumentSlot* slots_ = nullptr;
+};
+}  // namespace co
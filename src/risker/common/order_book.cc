@@ -1,55 +1,208 @@
 // Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <algorithm>
 #include "order_book.h"
 #include "anti_self_knock_risker.h"
 
 namespace co {
 
-Order::Order()
-: create_time(x::UnixMilli()),
-timestamp(0),
-bs_flag(0),
-price(0),
-volume(0),
-match_volume(0),
-withdraw_failed_time(0),
-finish_flag(false) {
+void Order::Clear() {
+    create_time = 0;
+    message_id[0] = '\0';
+    timestamp = 0;
+    fund_id[0] = '\0';
+    code[0] = '\0';
+    order_no[0] = '\0';
+    batch_no[0] = '\0';
+    bs_flag = 0;
+    price = 0;
+    volume = 0;
+    match_volume = 0;
+    withdraw_failed_time = 0;
+    withdraw_succeed = false;
+    finish_flag = false;
+    deadline = 0;
+    shared_entry = nullptr;
+    shared_serial = 0;
+    in_book = false;
+    book_price = 0;
+    book_next = nullptr;
+    book_prev = nullptr;
 }
 
 bool Order::IsFinished() {
-    if (finish_flag) {
-        return finish_flag;
-    }
-    if (withdraw_succeed || match_volume >= volume) {
+    // 超时由风控线程推进时间轮时判断(IsExpired)，这里不再读取时钟
+    if (!finish_flag && (withdraw_succeed || match_volume >= volume)) {
         finish_flag = true;
-        return finish_flag;
     }
-    int64_t now = x::UnixMilli();
+    return finish_flag;
+}
+
+bool Order::IsExpired(int64_t now) {
     // 等待委托响应超时
-    if (order_no.empty() && (now - create_time) > kOrderTimeoutMS) {
+    if (order_no[0] == '\0' && (now - create_time) > kOrderTimeoutMS) {
         LOG_INFO << "委托响应超时, code: " << code
            << ", message_id: " << message_id
            << ", bs_flag: " << bs_flag
            << ", price: " << price
            << ", volume: " << volume;
-        finish_flag = true;
-        return finish_flag;
+        return true;
     }
     // 撤单失败超过设定阈值
-    if (order_no.length() > 0 && withdraw_failed_time > 0 && (now - withdraw_failed_time) > kOrderTimeoutMS) {
+    if (order_no[0] != '\0' && withdraw_failed_time > 0 && (now - withdraw_failed_time) > kOrderTimeoutMS) {
         LOG_INFO << "撤单失败超过设定阈值, code: " << code
                  << ", message_id: " << message_id
                  << ", order_no: " << order_no
                  << ", bs_flag: " << bs_flag
                  << ", price: " << price
                  << ", volume: " << volume;
-        finish_flag = true;
-        return finish_flag;
+        return true;
     }
     return false;
 }
 
-OrderBook::OrderBook(AntiSelfKnockRisker* risker): risker_(risker) {
+OrderPool::OrderPool(int64_t chunk_size): chunk_size_(chunk_size > 0 ? chunk_size : 1024) {
+}
+
+void OrderPool::Grow() {
+    std::unique_ptr<Order[]> chunk(new Order[chunk_size_]);
+    for (int64_t i = chunk_size_ - 1; i >= 0; --i) {
+        Order* order = chunk.get() + i;
+        order->pool = this;
+        order->pool_next = free_;
+        free_ = order;
+    }
+    chunks_.emplace_back(std::move(chunk));
+    capacity_ += chunk_size_;
+    free_size_ += chunk_size_;
+}
+
+OrderPtr OrderPool::Create() {
+    if (!free_) {
+        Grow();
+    }
+    Order* order = free_;
+    free_ = order->pool_next;
+    order->pool_next = nullptr;
+    --free_size_;
+    return OrderPtr(order);
+}
+
+void OrderPool::Release(Order* order) {
+    // 先清空字段再放回空闲链表，清空book_next时可能级联释放后续委托
+    order->Clear();
+    order->pool_next = free_;
+    free_ = order;
+    ++free_size_;
+}
 
+PriceLevelSide::PriceLevelSide(bool bid): bid_(bid) {
+}
+
+PriceLevelSide::~PriceLevelSide() {
+    // 逐个断开链表，避免长链表析构时递归过深
+    for (auto& level : levels_) {
+        OrderPtr order = std::move(level.head);
+        while (order) {
+            order->in_book = false;
+            order->book_prev = nullptr;
+            order = std::move(order->book_next);
+        }
+    }
+}
+
+std::vector<PriceLevel>::iterator PriceLevelSide::LowerBound(int64_t price) {
+    if (bid_) {
+        return std::lower_bound(levels_.begin(), levels_.end(), price,
+            [](const PriceLevel& level, int64_t value) { return level.price < value; });
+    }
+    return std::lower_bound(levels_.begin(), levels_.end(), price,
+        [](const PriceLevel& level, int64_t value) { return level.price > value; });
+}
+
+PriceLevel* PriceLevelSide::Find(int64_t price) {
+    // 大部分委托都在最优价位附近，先检查最优价位
+    if (!levels_.empty() && levels_.back().price == price) {
+        return &levels_.back();
+    }
+    auto itr = LowerBound(price);
+    if (itr != levels_.end() && itr->price == price) {
+        return &(*itr);
+    }
+    return nullptr;
+}
+
+void PriceLevelSide::Push(OrderPtr order, int64_t price) {
+    PriceLevel* level = Find(price);
+    if (!level) {
+        auto itr = LowerBound(price);
+        itr = levels_.insert(itr, PriceLevel());
+        itr->price = price;
+        level = &(*itr);
+    }
+    order->in_book = true;
+    order->book_price = price;
+    order->book_prev = level->tail;
+    order->book_next = nullptr;
+    Order* raw = order.get();
+    if (level->tail) {
+        level->tail->book_next = std::move(order);
+    } else {
+        level->head = std::move(order);
+    }
+    level->tail = raw;
+    level->size++;
+}
+
+OrderPtr PriceLevelSide::Remove(Order* order) {
+    OrderPtr self = nullptr;
+    if (!order->in_book) {
+        return self;
+    }
+    auto itr = LowerBound(order->book_price);
+    if (itr == levels_.end() || itr->price != order->book_price) {
+        return self;
+    }
+    PriceLevel& level = *itr;
+    Order* prev = order->book_prev;
+    self = prev ? prev->book_next : level.head;
+    OrderPtr next = std::move(order->book_next);
+    if (next) {
+        next->book_prev = prev;
+    } else {
+        level.tail = prev;
+    }
+    if (prev) {
+        prev->book_next = std::move(next);
+    } else {
+        level.head = std::move(next);
+    }
+    order->book_prev = nullptr;
+    order->in_book = false;
+    if (--level.size <= 0) {
+        levels_.erase(itr);
+    }
+    return self;
+}
+
+OrderBook::OrderBook(AntiSelfKnockRisker* risker, std::string_view code)
+: risker_(risker), code_(code), asks_(false), bids_(true) {
+
+}
+
+OrderPtr OrderBook::Unlink(PriceLevelSide* side, Order* order) {
+    auto ret = side->Remove(order);
+    if (ret) {
+        risker_->OnOrderRemoved(order);
+    }
+    return ret;
+}
+
+void OrderBook::UpdateInterest() {
+    bool interested = !asks_.empty() || !bids_.empty();
+    if (interested != interested_) {
+        interested_ = interested;
+        risker_->OnBookInterest(code_, interested);
+    }
 }
 
 std::string OrderBook::HandleTradeOrderReq(MemTradeOrder* order, int64_t bs_flag) {
@@ -69,17 +222,18 @@ std::string OrderBook::HandleTradeOrderReq(MemTradeOrder* order, int64_t bs_flag
     latest_order_timestamp_ = timestamp;
     int64_t order_price = EncodePrice(order->price);
 
+    // 只需从对手方最优价位开始检查，最优价位不交叉时直接返回
     if (bs_flag == kBsFlagBuy) {
-        for (auto itr = asks_.begin(); itr != asks_.end();) {
-            int64_t ask_price = itr->first;
-            if (order_price < ask_price) {
+        while (!asks_.empty()) {
+            PriceLevel& level = asks_.best();
+            if (order_price < level.price) {
                 break;
             }
-            auto active_order = itr->second;
-            bool remove = active_order->IsFinished();
-            if (remove) {
-                itr = asks_.erase(itr);
-                risker_->OnOrderFinish(active_order);
+            Order* active_order = level.head.get();
+            if (active_order->IsFinished()) {
+                auto finished = Unlink(&asks_, active_order);
+                UpdateInterest();
+                risker_->OnOrderFinish(finished);
             } else {
                 std::stringstream ss;
                 ss << "[FAN-RISK-ERROR][防对敲]风控检查失败，存在卖出挂单："
@@ -93,16 +247,16 @@ std::string OrderBook::HandleTradeOrderReq(MemTradeOrder* order, int64_t bs_flag
             }
         }
     } else if (bs_flag == kBsFlagSell) {
-        for (auto itr = bids_.begin(); itr != bids_.end();) {
-            int64_t bid_price = itr->first;
-            if (order_price > bid_price) {
+        while (!bids_.empty()) {
+            PriceLevel& level = bids_.best();
+            if (order_price > level.price) {
                 break;
             }
-            auto active_order = itr->second;
-            bool remove = active_order->IsFinished();
-            if (remove) {
-                itr = bids_.erase(itr);
-                risker_->OnOrderFinish(active_order);
+            Order* active_order = level.head.get();
+            if (active_order->IsFinished()) {
+                auto finished = Unlink(&bids_, active_order);
+                UpdateInterest();
+                risker_->OnOrderFinish(finished);
             } else {
                 std::stringstream ss;
                 ss << "[FAN-RISK-ERROR][防对敲]风控检查失败，存在买入挂单："
@@ -116,87 +270,77 @@ std::string OrderBook::HandleTradeOrderReq(MemTradeOrder* order, int64_t bs_flag
             }
         }
     }
-    return "";
+    // 其它broker的挂单
+    return risker_->CheckSharedBook(order, bs_flag, order_price, timestamp / 1000000000LL);
 }
 
 void OrderBook::OnTradeOrderReqPass(OrderPtr order) {
     int64_t order_price = EncodePrice(order->price);
     if (order->bs_flag == kBsFlagBuy) {
-        bids_.insert(std::make_pair(order_price, order));
+        bids_.Push(order, order_price);
     } else if (order->bs_flag == kBsFlagSell) {
-        asks_.insert(std::make_pair(order_price, order));
+        asks_.Push(order, order_price);
     }
+    UpdateInterest();
 }
 
-OrderPtr OrderBook::HandleTradeOrderRep(MemTradeOrderMessage* rep, MemTradeOrder* order) {
+OrderPtr OrderBook::HandleTradeOrderRep(MemTradeOrderMessage* rep, MemTradeOrder* order, int64_t now) {
     OrderPtr ret = nullptr;
-    int64_t order_price = EncodePrice(order->price);
-    std::string order_no = order->order_no;
-    bool inner_flag = false;
+    PriceLevelSide* side = nullptr;
     if (rep->bs_flag == kBsFlagBuy) {
-        auto range = bids_.equal_range(order_price);
-        for (auto itr = range.first; itr != range.second; ++itr) {
-            auto& active_order = itr->second;
-            if (active_order->message_id.compare(rep->id) == 0) {
-                inner_flag = true;
-                if (order_no.empty()) {
-                    bids_.erase(itr);
-                } else {
-                    active_order->batch_no = rep->batch_no;
-                    active_order->order_no = order_no;
-                    ret = active_order;
-                }
-                break;
-            }
-        }
-        // 其它帐号的单子，只有响应
-        if (!inner_flag && strlen(order->order_no) > 0) {
-            ret = std::make_shared<Order>();
-            ret->message_id = rep->id;
-            ret->timestamp = rep->timestamp;
-            ret->fund_id = rep->fund_id;
-            ret->code = order->code;
-            ret->bs_flag = rep->bs_flag;
-            ret->volume = order->volume;
-            ret->price = order->price;
-            ret->batch_no = rep->batch_no;
-            ret->order_no = order_no;
-            OnTradeOrderReqPass(ret);
-        }
+        side = &bids_;
     } else if (rep->bs_flag == kBsFlagSell) {
-        auto range = asks_.equal_range(order_price);
-        for (auto itr = range.first; itr != range.second; ++itr) {
-            auto& active_order = itr->second;
-            if (active_order->message_id.compare(rep->id) == 0) {
+        side = &asks_;
+    } else {
+        return ret;
+    }
+    int64_t order_price = EncodePrice(order->price);
+    bool has_order_no = order->order_no[0] != '\0';
+    bool inner_flag = false;
+    PriceLevel* level = side->Find(order_price);
+    if (level) {
+        for (Order* active_order = level->head.get(); active_order; active_order = active_order->book_next.get()) {
+            if (strcmp(active_order->message_id, rep->id) == 0) {
                 inner_flag = true;
-                if (order_no.empty()) {
-                    asks_.erase(itr);
+                if (!has_order_no) {
+                    Unlink(side, active_order);
                 } else {
-                    active_order->batch_no = rep->batch_no;
-                    active_order->order_no = order_no;
-                    ret = active_order;
+                    CopyOrderField(active_order->batch_no, rep->batch_no);
+                    CopyOrderField(active_order->order_no, order->order_no);
+                    ret = active_order->book_prev ? active_order->book_prev->book_next : level->head;
                 }
                 break;
             }
         }
-        // 其它broker的单子，只有响应
-        if (!inner_flag && strlen(order->order_no) > 0) {
-            ret = std::make_shared<Order>();
-            ret->message_id = rep->id;
-            ret->timestamp = rep->timestamp;
-            ret->fund_id = rep->fund_id;
-            ret->code = order->code;
-            ret->bs_flag = rep->bs_flag;
-            ret->volume = order->volume;
-            ret->price = order->price;
-            ret->batch_no = rep->batch_no;
-            ret->order_no = order_no;
-            OnTradeOrderReqPass(ret);
-        }
     }
+    // 其它帐号的单子，只有响应
+    if (!inner_flag && has_order_no) {
+        ret = risker_->CreateOrder();
+        ret->create_time = now;
+        CopyOrderField(ret->message_id, rep->id);
+        ret->timestamp = rep->timestamp;
+        CopyOrderField(ret->fund_id, rep->fund_id);
+        CopyOrderField(ret->code, order->code);
+        ret->bs_flag = rep->bs_flag;
+        ret->volume = order->volume;
+        ret->price = order->price;
+        CopyOrderField(ret->batch_no, rep->batch_no);
+        CopyOrderField(ret->order_no, order->order_no);
+        OnTradeOrderReqPass(ret);
+    }
+    UpdateInterest();
     return ret;
 }
 
+void OrderBook::Remove(Order* order) {
+    if (order->bs_flag == kBsFlagBuy) {
+        Unlink(&bids_, order);
+    } else if (order->bs_flag == kBsFlagSell) {
+        Unlink(&asks_, order);
+    }
+    UpdateInterest();
+}
+
 void OrderBook::OnOrderFinish(OrderPtr order) {
     risker_->OnOrderFinish(order);
 }
@@ -253,47 +397,53 @@ void OrderBook::TryHandleTick() {
         min_ask = min_ap1;
     }
     if (max_bid > 0) {
-        for (auto itr = asks_.begin(); itr != asks_.end();) {
-            int64_t ask_price = itr->first;
+        auto& levels = asks_.levels();
+        for (int64_t i = (int64_t)levels.size() - 1; i >= 0; --i) {
+            int64_t ask_price = levels[i].price;
             if (max_bid < ask_price) {
                 break;
             }
             if ((max_bp1 > 0 && max_bp1 >= ask_price) ||
                 (max_new_price > 0 && max_new_price > ask_price)) {
-                LOG_INFO << "delete ask order by tick, code: " << itr->second->code
-                << ", order_no: " << itr->second->order_no
-                << ", ask_price: " << ask_price
-                << ", max_bp1: " << max_bp1
-                << ", max_new_price: " << max_new_price
-                << ", min_ap1: " << min_ap1
-                << ", min_new_price: " << min_new_price;
-                itr = asks_.erase(itr);
-            } else {
-                ++itr;
+                // 整个价位删除，删除后价位数组中只有更优的价位会前移，不影响继续向后遍历
+                while (i < (int64_t)levels.size() && levels[i].price == ask_price) {
+                    Order* active_order = levels[i].head.get();
+                    LOG_INFO << "delete ask order by tick, code: " << active_order->code
+                    << ", order_no: " << active_order->order_no
+                    << ", ask_price: " << ask_price
+                    << ", max_bp1: " << max_bp1
+                    << ", max_new_price: " << max_new_price
+                    << ", min_ap1: " << min_ap1
+                    << ", min_new_price: " << min_new_price;
+                    Unlink(&asks_, active_order);
+                }
             }
         }
     }
     if (min_ask > 0) {
-        for (auto itr = bids_.begin(); itr != bids_.end();) {
-            int64_t bid_price = itr->first;
+        auto& levels = bids_.levels();
+        for (int64_t i = (int64_t)levels.size() - 1; i >= 0; --i) {
+            int64_t bid_price = levels[i].price;
             if (min_ask > bid_price) {
                 break;
             }
             if ((min_ap1 > 0 && min_ap1 <= bid_price) ||
             (min_new_price > 0 && min_new_price < bid_price)) {
-                LOG_INFO << "delete bid order by tick, code: " << itr->second->code
-                << ", order_no: " << itr->second->order_no
-                << ", bid_price: " << bid_price
-                << ", max_bp1: " << max_bp1
-                << ", max_new_price: " << max_new_price
-                << ", min_ap1: " << min_ap1
-                << ", min_new_price: " << min_new_price;
-                itr = bids_.erase(itr);
-            } else {
-                ++itr;
+                while (i < (int64_t)levels.size() && levels[i].price == bid_price) {
+                    Order* active_order = levels[i].head.get();
+                    LOG_INFO << "delete bid order by tick, code: " << active_order->code
+                    << ", order_no: " << active_order->order_no
+                    << ", bid_price: " << bid_price
+                    << ", max_bp1: " << max_bp1
+                    << ", max_new_price: " << max_new_price
+                    << ", min_ap1: " << min_ap1
+                    << ", min_new_price: " << min_new_price;
+                    Unlink(&bids_, active_order);
+                }
             }
         }
     }
+    UpdateInterest();
     ClearTick();
 }
 
@@ -35,19 +35,72 @@ inline double DecodePrice(int64_t price) {
     return static_cast<double> (price) / 10000;
 }
 
+template <size_t N>
+inline void CopyOrderField(char (&dst)[N], const char* src) {
+    strncpy(dst, src, N - 1);
+    dst[N - 1] = '\0';
+}
+
+class Order;
+class OrderPool;
+struct SharedBookEntry;
+
+/**
+ * 委托的侵入式引用计数指针，引用计数归零时委托归还到所属的对象池。
+ * 风控只在RiskMaster的工作线程中访问委托，引用计数不需要原子操作。
+ */
+class OrderPtr {
+ public:
+    OrderPtr() = default;
+    OrderPtr(std::nullptr_t) {}  // NOLINT
+    explicit OrderPtr(Order* order);
+    OrderPtr(const OrderPtr& other);
+    OrderPtr(OrderPtr&& other) noexcept;
+    ~OrderPtr();
+    OrderPtr& operator=(const OrderPtr& other);
+    OrderPtr& operator=(OrderPtr&& other) noexcept;
+    OrderPtr& operator=(std::nullptr_t);
+
+    [[nodiscard]] inline Order* get() const {
+        return order_;
+    }
+
+    inline Order* operator->() const {
+        return order_;
+    }
+
+    inline Order& operator*() const {
+        return *order_;
+    }
+
+    inline explicit operator bool() const {
+        return order_ != nullptr;
+    }
+
+ private:
+    void Reset();
+
+ private:
+    Order* order_ = nullptr;
+};
+
 class Order {
  public:
-    Order();
+    Order() = default;
+    Order(const Order&) = delete;
+    Order& operator=(const Order&) = delete;
     bool IsFinished();
+    bool IsExpired(int64_t now);
+    void Clear();
 
  public:
     int64_t create_time = 0;
-    std::string message_id;
+    char message_id[sizeof(MemTradeOrderMessage::id)] = "";
     int64_t timestamp = 0;
-    std::string fund_id;
-    std::string code;
-    std::string order_no;
-    std::string batch_no;
+    char fund_id[sizeof(MemTradeOrderMessage::fund_id)] = "";
+    char code[sizeof(MemTradeOrder::code)] = "";
+    char order_no[sizeof(MemTradeOrder::order_no)] = "";
+    char batch_no[sizeof(MemTradeOrderMessage::batch_no)] = "";
     int64_t bs_flag = 0;
     double price = 0;
     int64_t volume = 0;
@@ -55,27 +108,173 @@ class Order {
     int64_t withdraw_failed_time = 0;  // 撤单失败的时间，如果撤单失败, 过段时间还没收到撤单成交回报, 自成交检查时认为已经撤单//
     bool withdraw_succeed = false;  // 撤单成功标志, 没收到撤单成交回报, 自成交检查时认为已经撤单//
     bool finish_flag = false;
+    int64_t deadline = 0;  // 超时时间轮中登记的截止时间，0表示未登记
+    SharedBookEntry* shared_entry = nullptr;  // 在共享挂单表中的槽位
+    int64_t shared_serial = 0;
+
+    // 订单薄内部使用，同一价位的委托按时间先后组成侵入式链表
+    bool in_book = false;
+    int64_t book_price = 0;
+    OrderPtr book_next;
+    Order* book_prev = nullptr;
+
+    // 对象池内部使用
+    int64_t ref_count = 0;
+    OrderPool* pool = nullptr;
+    Order* pool_next = nullptr;
+};
+
+/**
+ * 委托对象池：按块预分配委托，释放的委托挂到空闲链表上复用，稳定运行后不再申请内存。
+ * 对象池必须比它分配出去的所有委托活得更久。
+ */
+class OrderPool {
+ public:
+    explicit OrderPool(int64_t chunk_size = 1024);
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    OrderPtr Create();
+    void Release(Order* order);
+
+    [[nodiscard]] inline int64_t capacity() const {
+        return capacity_;
+    }
+
+    [[nodiscard]] inline int64_t free_size() const {
+        return free_size_;
+    }
+
+ private:
+    void Grow();
+
+ private:
+    int64_t chunk_size_ = 0;
+    int64_t capacity_ = 0;
+    int64_t free_size_ = 0;
+    Order* free_ = nullptr;
+    std::vector<std::unique_ptr<Order[]>> chunks_;
 };
 
-typedef std::shared_ptr<Order> OrderPtr;
+inline OrderPtr::OrderPtr(Order* order): order_(order) {
+    if (order_) {
+        ++order_->ref_count;
+    }
+}
+
+inline OrderPtr::OrderPtr(const OrderPtr& other): order_(other.order_) {
+    if (order_) {
+        ++order_->ref_count;
+    }
+}
+
+inline OrderPtr::OrderPtr(OrderPtr&& other) noexcept: order_(other.order_) {
+    other.order_ = nullptr;
+}
+
+inline OrderPtr::~OrderPtr() {
+    Reset();
+}
+
+inline OrderPtr& OrderPtr::operator=(const OrderPtr& other) {
+    if (order_ != other.order_) {
+        OrderPtr tmp(other);
+        std::swap(order_, tmp.order_);
+    }
+    return *this;
+}
+
+inline OrderPtr& OrderPtr::operator=(OrderPtr&& other) noexcept {
+    if (this != &other) {
+        Order* old = order_;
+        order_ = other.order_;
+        other.order_ = nullptr;
+        if (old && --old->ref_count == 0) {
+            old->pool->Release(old);
+        }
+    }
+    return *this;
+}
+
+inline OrderPtr& OrderPtr::operator=(std::nullptr_t) {
+    Reset();
+    return *this;
+}
+
+inline void OrderPtr::Reset() {
+    Order* old = order_;
+    order_ = nullptr;
+    if (old && --old->ref_count == 0) {
+        old->pool->Release(old);
+    }
+}
+
 class AntiSelfKnockRisker;
 
+// 同一价位的挂单链表
+struct PriceLevel {
+    int64_t price = 0;
+    OrderPtr head;
+    Order* tail = nullptr;
+    int64_t size = 0;
+};
+
+/**
+ * 订单薄的一边：价位按价格排序保存在连续数组中，最优价位位于数组末尾，
+ * 卖方按价格从高到低排列，买方按价格从低到高排列，增删最优价位不需要移动其它价位。
+ */
+class PriceLevelSide {
+ public:
+    explicit PriceLevelSide(bool bid);
+    ~PriceLevelSide();
+    PriceLevelSide(const PriceLevelSide&) = delete;
+    PriceLevelSide& operator=(const PriceLevelSide&) = delete;
+
+    void Push(OrderPtr order, int64_t price);
+    OrderPtr Remove(Order* order);
+    PriceLevel* Find(int64_t price);
+
+    [[nodiscard]] inline bool empty() const {
+        return levels_.empty();
+    }
+
+    [[nodiscard]] inline PriceLevel& best() {
+        return levels_.back();
+    }
+
+    [[nodiscard]] inline std::vector<PriceLevel>& levels() {
+        return levels_;
+    }
+
+ private:
+    std::vector<PriceLevel>::iterator LowerBound(int64_t price);
+
+ private:
+    bool bid_ = false;
+    std::vector<PriceLevel> levels_;
+};
+
 class OrderBook {
  public:
-    OrderBook(AntiSelfKnockRisker* risker);
+    OrderBook(AntiSelfKnockRisker* risker, std::string_view code);
 
     std::string HandleTradeOrderReq(MemTradeOrder* order, int64_t bs_flag);
     void OnTradeOrderReqPass(OrderPtr order);
-    OrderPtr HandleTradeOrderRep(MemTradeOrderMessage* rep, MemTradeOrder* order);
+    OrderPtr HandleTradeOrderRep(MemTradeOrderMessage* rep, MemTradeOrder* order, int64_t now);
+    void Remove(Order* order);
     void OnTick(MemQTickBody* tick);
 
  private:
     void OnOrderFinish(OrderPtr order);
+    void UpdateInterest();
+    OrderPtr Unlink(PriceLevelSide* side, Order* order);
     void TryHandleTick();
     void ClearTick();
 
  private:
     AntiSelfKnockRisker* risker_ = nullptr;
+    std::string code_;
+    bool interested_ = false;  // 是否有挂单，有挂单时才需要处理行情
     int64_t latest_order_timestamp_ = 0;  // 最新委托时间
     double has_tick_ = false;
     double max_bp1_ = 0;
@@ -83,8 +282,7 @@ class OrderBook {
     double min_new_price_ = 0;
     double max_new_price_ = 0;
 
-    std::multimap<int64_t, OrderPtr, std::less<int64_t> > asks_;  // price -> orders
-    std::multimap<int64_t, OrderPtr, std::greater<int64_t> > bids_;  // price -> orders
-    std::unordered_map<std::string, OrderPtr> orders_;  // <fund_id>#<order_no> -> order
+    PriceLevelSide asks_;  // 卖方挂单，最优价位为最低价
+    PriceLevelSide bids_;  // 买方挂单，最优价位为最高价
 };
 }  // namespace co
@@ -0,0 +1,60 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#include "order_timer.h"
+
+namespace co {
+OrderTimerWheel::OrderTimerWheel(int64_t tick_ms, int64_t slots): tick_ms_(tick_ms > 0 ? tick_ms : 1) {
+    int64_t n = 1;
+    while (n < slots) {
+        n <<= 1;
+    }
+    mask_ = n - 1;
+    slots_.resize(n);
+}
+
+void OrderTimerWheel::Schedule(const OrderPtr& order, int64_t deadline) {
+    int64_t tick = deadline / tick_ms_;
+    if (tick < current_tick_) {
+        tick = current_tick_;
+    }
+    slots_[tick & mask_].push_back(Entry{order, deadline});
+    ++size_;
+}
+
+void OrderTimerWheel::Advance(int64_t now, std::vector<OrderPtr>* expired) {
+    if (now <= last_now_ || size_ <= 0) {
+        last_now_ = now > last_now_ ? now : last_now_;
+        current_tick_ = last_now_ / tick_ms_;
+        return;
+    }
+    last_now_ = now;
+    int64_t now_tick = now / tick_ms_;
+    if (current_tick_ <= 0) {
+        current_tick_ = now_tick;
+    }
+    // 时间跳跃超过一圈时，每个槽位只需要检查一次
+    int64_t end_tick = now_tick;
+    if (end_tick - current_tick_ > mask_) {
+        end_tick = current_tick_ + mask_;
+    }
+    for (int64_t tick = current_tick_; tick <= end_tick; ++tick) {
+        auto& slot = slots_[tick & mask_];
+        for (size_t i = 0; i < slot.size();) {
+            Entry& entry = slot[i];
+            if (entry.deadline <= now) {
+                Order* order = entry.order.get();
+                if (order->deadline == entry.deadline && !order->finish_flag) {
+                    expired->emplace_back(std::move(entry.order));
+                }
+                if (i + 1 < slot.size()) {
+                    entry = std::move(slot.back());
+                }
+                slot.pop_back();
+                --size_;
+            } else {
+                ++i;
+            }
+        }
+    }
+    current_tick_ = now_tick;
+}
+}  // namespace co
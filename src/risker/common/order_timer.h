@@ -0,0 +1,36 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <vector>
+#include "order_book.h"
+
+namespace co {
+/**
+ * 委托超时时间轮：按截止时间把委托挂到对应的槽位上，风控线程推进时间轮时取出到期的委托。
+ * 委托的截止时间被更新或取消后（Order::deadline 与登记时不一致），原来登记的条目到期时直接丢弃。
+ */
+class OrderTimerWheel {
+ public:
+    explicit OrderTimerWheel(int64_t tick_ms = 16, int64_t slots = 256);
+
+    void Schedule(const OrderPtr& order, int64_t deadline);
+    // 取出截止时间不晚于now的委托
+    void Advance(int64_t now, std::vector<OrderPtr>* expired);
+
+    [[nodiscard]] inline int64_t size() const {
+        return size_;
+    }
+
+ private:
+    struct Entry {
+        OrderPtr order;
+        int64_t deadline = 0;
+    };
+
+    int64_t tick_ms_ = 0;
+    int64_t mask_ = 0;
+    int64_t current_tick_ = 0;
+    int64_t last_now_ = 0;
+    int64_t size_ = 0;
+    std::vector<std::vector<Entry>> slots_;
+};
+}  // namespace co
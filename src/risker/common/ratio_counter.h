@@ -0,0 +1,79 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace co {
+// 滑动窗口内的事件计数
+struct RatioCounts {
+    int64_t orders = 0;  // 委托笔数
+    int64_t withdraws = 0;  // 撤单成功笔数
+    int64_t failures = 0;  // 废单笔数
+    int64_t knocks = 0;  // 成交笔数
+};
+
+/**
+ * 按时间分桶的滑动窗口计数器：每个事件只累加当前桶和窗口合计，桶过期时从合计中减去，
+ * 读取窗口内的计数不需要扫描历史事件。时间倒退的事件计入最新的桶。
+ */
+class RollingRatioCounter {
+ public:
+    explicit RollingRatioCounter(int64_t window_ms = 60000, int32_t buckets = 60)
+        : buckets_(buckets > 0 ? buckets : 1) {
+        bucket_ms_ = window_ms / (int64_t)buckets_.size();
+        if (bucket_ms_ <= 0) {
+            bucket_ms_ = 1;
+        }
+    }
+
+    void AddOrder(int64_t now, int64_t orders, int64_t failures) {
+        RatioCounts& bucket = Advance(now);
+        bucket.orders += orders;
+        bucket.failures += failures;
+        total_.orders += orders;
+        total_.failures += failures;
+    }
+
+    void AddWithdraw(int64_t now) {
+        ++Advance(now).withdraws;
+        ++total_.withdraws;
+    }
+
+    void AddKnock(int64_t now) {
+        ++Advance(now).knocks;
+        ++total_.knocks;
+    }
+
+    // 返回截止到now的窗口内计数
+    const RatioCounts& Counts(int64_t now) {
+        Advance(now);
+        return total_;
+    }
+
+ private:
+    RatioCounts& Advance(int64_t now) {
+        int64_t index = now / bucket_ms_;
+        if (index > head_) {
+            // 最多清空一圈，之后的桶都已经是空的
+            int64_t n = (int64_t)buckets_.size();
+            int64_t steps = index - head_ < n ? index - head_ : n;
+            for (int64_t i = index - steps + 1; i <= index; ++i) {
+                RatioCounts& bucket = buckets_[i % n];
+                total_.orders -= bucket.orders;
+                total_.withdraws -= bucket.withdraws;
+                total_.failures -= bucket.failures;
+                total_.knocks -= bucket.knocks;
+                bucket = RatioCounts();
+            }
+            head_ = index;
+        }
+        return buckets_[head_ % (int64_t)buckets_.size()];
+    }
+
+ private:
+    std::vector<RatioCounts> buckets_;
+    int64_t bucket_ms_ = 1000;
+    int64_t head_ = -1;  // 最新的桶序号
+    RatioCounts total_;
+};
+}  // namespace co
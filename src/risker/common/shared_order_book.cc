@@ -0,0 +1,298 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <filesystem>
+#include "shared_order_book.h"
+#include "hash_index.h"
+#include "order_book.h"
+
+namespace co {
+namespace {
+bool IsProcessAlive(int64_t pid) {
+    return pid > 0 && (::kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH);
+}
+}  // namespace
+
+SharedOrderBook::~SharedOrderBook() {
+    Close();
+}
+
+void SharedOrderBook::Open(const std::string& filename, int64_t slots) {
+    Close();
+    if (slots <= 0) {
+        throw std::runtime_error("illegal shared order book slots: " + std::to_string(slots));
+    }
+    std::filesystem::path path(filename);
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("open shared order book failed: " + filename);
+    }
+    ::flock(fd_, LOCK_EX);
+    struct stat st = {};
+    ::fstat(fd_, &st);
+    bool created = st.st_size == 0;
+    if (!created) {
+        // 所有broker的槽位布局必须一致，以先创建文件的broker的桶容量为准
+        SharedOrderBookHeader header = {};
+        if (::pread(fd_, &header, sizeof(header), 0) != (ssize_t)sizeof(header) || header.magic != kSharedOrderBookMagic ||
+            header.buckets != kSharedOrderBookBuckets || header.slots <= 0 ||
+            header.entry_size != (int64_t)sizeof(SharedBookEntry)) {
+            ::flock(fd_, LOCK_UN);
+            throw std::runtime_error("illegal shared order book header, remove it after all brokers stopped: " + filename);
+        }
+        if (header.slots != slots) {
+            LOG_WARN << "[risk][shared_book] use slots in file: " << header.slots << ", ignore: " << slots;
+        }
+        slots = header.slots;
+    }
+    size_ = sizeof(SharedBookEntry) * (kSharedOrderBookBuckets * slots + 1);
+    if (created && ::ftruncate(fd_, (off_t)size_) != 0) {
+        ::flock(fd_, LOCK_UN);
+        throw std::runtime_error("resize shared order book failed: " + filename);
+    }
+    if (!created && st.st_size != (off_t)size_) {
+        ::flock(fd_, LOCK_UN);
+        throw std::runtime_error("illegal shared order book size: " + std::to_string(st.st_size) + ", file: " + filename);
+    }
+    addr_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr_ == MAP_FAILED) {
+        addr_ = nullptr;
+        ::flock(fd_, LOCK_UN);
+        throw std::runtime_error("mmap shared order book failed: " + filename);
+    }
+    // 第一个槽位的位置存放文件头，保证后面的槽位按缓存行对齐
+    auto header = reinterpret_cast<SharedOrderBookHeader*>(addr_);
+    if (created) {
+        header->buckets = kSharedOrderBookBuckets;
+        header->slots = slots;
+        header->entry_size = sizeof(SharedBookEntry);
+        header->magic = kSharedOrderBookMagic;
+    }
+    slots_ = slots;
+    entries_ = reinterpret_cast<SharedBookEntry*>(addr_) + 1;
+    ::flock(fd_, LOCK_UN);
+    pid_ = ::getpid();
+    // 清理本进程号遗留的挂单（进程号被复用时，上一个进程的挂单不会再被删除）
+    ReleaseOwned();
+    LOG_INFO << "[risk][shared_book] open ok: " << filename << ", slots: " << slots_ << ", created: " << std::boolalpha << created;
+}
+
+void SharedOrderBook::Close() {
+    if (addr_) {
+        ReleaseOwned();
+        ::munmap(addr_, size_);
+        addr_ = nullptr;
+        entries_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+SharedBookEntry* SharedOrderBook::Bucket(std::string_view code, uint64_t* code_hash) {
+    uint64_t h = MixHash(HashBytes(code));
+    *code_hash = h;
+    return entries_ + (h & (kSharedOrderBookBuckets - 1)) * slots_;
+}
+
+bool SharedOrderBook::Lock(SharedBookEntry* entry, uint64_t* seq) {
+    for (int64_t n = 0; ; ++n) {
+        uint64_t v = entry->seq.load(std::memory_order_acquire);
+        if ((v & 1) == 0) {
+            if (entry->seq.compare_exchange_weak(v, v + 1, std::memory_order_acq_rel)) {
+                entry->locker.store(pid_, std::memory_order_release);
+                *seq = v;
+                return true;
+            }
+            continue;
+        }
+        if (n < kSharedOrderBookLockSpin) {
+            continue;
+        }
+        // 本进程是单线程写入，加锁的进程号等于本进程时只能是进程号被复用前遗留的锁
+        int64_t locker = entry->locker.load(std::memory_order_acquire);
+        if (locker != pid_ && IsProcessAlive(locker)) {
+            LOG_WARN << "[risk][shared_book] entry is locked by process: " << locker << ", seq: " << v;
+            return false;
+        }
+        // 接管已退出进程的锁：seq加2后仍为奇数，解锁后变为新的偶数，读取方不会把写了一半的数据当作有效数据
+        if (entry->seq.compare_exchange_strong(v, v + 2, std::memory_order_acq_rel)) {
+            entry->locker.store(pid_, std::memory_order_release);
+            LOG_WARN << "[risk][shared_book] take over entry locked by exited process: " << locker;
+            *seq = v + 1;
+            return true;
+        }
+        n = 0;
+    }
+}
+
+void SharedOrderBook::Unlock(SharedBookEntry* entry, uint64_t seq) {
+    entry->seq.store(seq + 2, std::memory_order_release);
+}
+
+SharedBookEntry* SharedOrderBook::Insert(const char* fund_id, const char* code, int64_t bs_flag, int64_t price,
+                                         int64_t volume, int64_t timestamp, int64_t date, int64_t* serial) {
+    if (!entries_) {
+        return nullptr;
+    }
+    uint64_t code_hash = 0;
+    SharedBookEntry* bucket = Bucket(code, &code_hash);
+    SharedBookEntry* entry = nullptr;
+    uint64_t seq = 0;
+    for (int64_t i = 0; i < slots_ && !entry; ++i) {
+        SharedBookEntry* e = bucket + i;
+        // 先不加锁过滤掉有效槽位，加锁后再确认一次
+        if ((e->order.live && e->order.date == date) || !Lock(e, &seq)) {
+            continue;
+        }
+        if (e->order.live && e->order.date == date) {
+            Unlock(e, seq);
+            continue;
+        }
+        entry = e;
+    }
+    // 桶已满时回收已退出进程的挂单
+    for (int64_t i = 0; i < slots_ && !entry; ++i) {
+        SharedBookEntry* e = bucket + i;
+        if (e->order.owner == pid_ || IsProcessAlive(e->order.owner) || !Lock(e, &seq)) {
+            continue;
+        }
+        if (e->order.owner == pid_ || IsProcessAlive(e->order.owner)) {
+            Unlock(e, seq);
+            continue;
+        }
+        entry = e;
+    }
+    if (!entry) {
+        LOG_ERROR << "[risk][shared_book] bucket is full, slots: " << slots_ << ", code: " << code;
+        return nullptr;
+    }
+    SharedBookOrder& order = entry->order;
+    memset(&order, 0, sizeof(order));
+    order.live = 1;
+    order.date = date;
+    order.owner = pid_;
+    order.serial = ++serial_;
+    order.code_hash = code_hash;
+    order.bs_flag = bs_flag;
+    order.price = price;
+    order.volume = volume;
+    order.timestamp = timestamp;
+    strncpy(order.code, code, sizeof(order.code) - 1);
+    strncpy(order.fund_id, fund_id, sizeof(order.fund_id) - 1);
+    Unlock(entry, seq);
+    *serial = serial_;
+    return entry;
+}
+
+void SharedOrderBook::SetOrderNo(SharedBookEntry* entry, int64_t serial, const char* order_no) {
+    uint64_t seq = 0;
+    if (!Lock(entry, &seq)) {
+        return;
+    }
+    if (entry->order.owner == pid_ && entry->order.serial == serial) {
+        strncpy(entry->order.order_no, order_no, sizeof(entry->order.order_no) - 1);
+    }
+    Unlock(entry, seq);
+}
+
+void SharedOrderBook::Remove(SharedBookEntry* entry, int64_t serial) {
+    uint64_t seq = 0;
+    if (!Lock(entry, &seq)) {
+        return;
+    }
+    if (entry->order.owner == pid_ && entry->order.serial == serial) {
+        entry->order.live = 0;
+    }
+    Unlock(entry, seq);
+}
+
+int64_t SharedOrderBook::FindCross(const char* code, int64_t bs_flag, int64_t price, int64_t date, SharedBookOrder* out) {
+    if (!entries_) {
+        return kSharedBookPass;
+    }
+    uint64_t code_hash = 0;
+    SharedBookEntry* bucket = Bucket(code, &code_hash);
+    int64_t opposite = bs_flag == kBsFlagBuy ? kBsFlagSell : kBsFlagBuy;
+    int64_t free_slots = 0;
+    for (int64_t i = 0; i < slots_; ++i) {
+        SharedBookEntry* entry = bucket + i;
+        // 槽位正在被写入时重新读取，多次读取失败则加锁读取，加锁的进程已退出时接管
+        bool ok = false;
+        for (int retry = 0; retry < 1000 && !ok; ++retry) {
+            uint64_t seq = entry->seq.load(std::memory_order_acquire);
+            if (seq & 1) {
+                continue;
+            }
+            memcpy(out, &entry->order, sizeof(*out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            ok = entry->seq.load(std::memory_order_relaxed) == seq;
+        }
+        if (!ok) {
+            uint64_t seq = 0;
+            if (!Lock(entry, &seq)) {
+                return kSharedBookBusy;
+            }
+            memcpy(out, &entry->order, sizeof(*out));
+            Unlock(entry, seq);
+        }
+        if (!out->live || out->date != date) {
+            ++free_slots;
+            continue;
+        }
+        if (out->owner == pid_ || out->bs_flag != opposite || out->code_hash != code_hash || strcmp(out->code, code) != 0) {
+            continue;
+        }
+        bool cross = bs_flag == kBsFlagBuy ? price >= out->price : price <= out->price;
+        if (!cross) {
+            continue;
+        }
+        if (!IsProcessAlive(out->owner)) {
+            // 所属broker已退出，挂单作废
+            uint64_t locked = 0;
+            if (Lock(entry, &locked)) {
+                if (entry->order.owner == out->owner) {
+                    entry->order.live = 0;
+                }
+                Unlock(entry, locked);
+            }
+            ++free_slots;
+            continue;
+        }
+        return kSharedBookCross;
+    }
+    if (free_slots == 0) {
+        // 已退出进程的挂单在写入时回收，不算满
+        for (int64_t i = 0; i < slots_; ++i) {
+            int64_t owner = bucket[i].order.owner;
+            if (owner != pid_ && !IsProcessAlive(owner)) {
+                return kSharedBookPass;
+            }
+        }
+        return kSharedBookFull;
+    }
+    return kSharedBookPass;
+}
+
+void SharedOrderBook::ReleaseOwned() {
+    for (int64_t i = 0; i < kSharedOrderBookBuckets * slots_; ++i) {
+        SharedBookEntry* entry = entries_ + i;
+        uint64_t seq = 0;
+        if (entry->order.live && entry->order.owner == pid_ && Lock(entry, &seq)) {
+            if (entry->order.owner == pid_) {
+                entry->order.live = 0;
+            }
+            Unlock(entry, seq);
+        }
+    }
+}
+}  // namespace co
@@ -0,0 +1,102 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <atomic>
+#include <string>
+#include <string_view>
+
+#include "x/x.h"
+#include "coral/coral.h"
+
+namespace co {
+constexpr int64_t kSharedOrderBookMagic = 0x534b424f4f4b3032;  // "SKBOOK02"
+constexpr int64_t kSharedOrderBookBuckets = 4096;  // 按证券代码哈希分桶
+constexpr int64_t kSharedOrderBookSlots = 16;  // 每个桶默认的挂单槽位数，创建文件时确定
+constexpr int64_t kSharedOrderBookLockSpin = 1 << 20;  // 槽位被其它进程锁住时的最大自旋次数
+
+// 查找对手方挂单的结果
+constexpr int64_t kSharedBookPass = 0;  // 没有交叉的挂单
+constexpr int64_t kSharedBookCross = 1;  // 存在交叉的挂单
+constexpr int64_t kSharedBookBusy = 2;  // 槽位一直被存活的进程锁住，无法读取
+constexpr int64_t kSharedBookFull = 3;  // 桶已满，通过后无法写入挂单，其它broker检查不到
+
+struct SharedBookOrder {
+    int64_t live;  // 1-有效挂单
+    int64_t date;  // 交易日，非当日的槽位视为空闲
+    int64_t owner;  // 所属broker的进程号
+    int64_t serial;  // 所属broker内的写入序号，删除时校验，避免误删槽位被复用后的挂单
+    uint64_t code_hash;
+    int64_t bs_flag;
+    int64_t price;  // EncodePrice后的价格
+    int64_t volume;
+    int64_t timestamp;
+    char code[32];
+    char fund_id[kMemFundIdSize];
+    char order_no[64];
+};
+
+/**
+ * 共享挂单槽位：seq为奇数时表示正在写入，读取方在前后两次读到相同的偶数seq时数据才有效；
+ * 写入方（占用空槽位的broker或槽位所属的broker）通过CAS把seq改为奇数后独占写入，并记录加锁的进程号；
+ * 加锁方异常退出时槽位停留在奇数，其它进程自旋超过上限后确认加锁进程已退出再接管。
+ */
+struct alignas(64) SharedBookEntry {
+    std::atomic<uint64_t> seq;
+    std::atomic<int64_t> locker;  // 加锁的进程号
+    SharedBookOrder order;
+};
+
+struct SharedOrderBookHeader {
+    int64_t magic;
+    int64_t buckets;
+    int64_t slots;  // 每个桶的槽位数
+    int64_t entry_size;
+};
+
+/**
+ * 同一台服务器上所有broker共用的防对敲挂单表（mem_dir下的共享内存文件）。
+ * 每个broker在委托通过风控后写入自己的挂单，委托结束后删除，风控检查时直接扫描对应代码的桶，
+ * 不再需要回放其它broker的委托回报。
+ */
+class SharedOrderBook {
+ public:
+    SharedOrderBook() = default;
+    ~SharedOrderBook();
+    SharedOrderBook(const SharedOrderBook&) = delete;
+    SharedOrderBook& operator=(const SharedOrderBook&) = delete;
+
+    // 文件已存在时使用文件中的桶容量，slots只在创建文件时生效
+    void Open(const std::string& filename, int64_t slots = kSharedOrderBookSlots);
+    void Close();
+
+    SharedBookEntry* Insert(const char* fund_id, const char* code, int64_t bs_flag, int64_t price, int64_t volume,
+                            int64_t timestamp, int64_t date, int64_t* serial);
+    void SetOrderNo(SharedBookEntry* entry, int64_t serial, const char* order_no);
+    void Remove(SharedBookEntry* entry, int64_t serial);
+    // 查找其它broker与委托价格交叉的对手方挂单，返回kSharedBook*，存在交叉时复制到out
+    int64_t FindCross(const char* code, int64_t bs_flag, int64_t price, int64_t date, SharedBookOrder* out);
+
+    [[nodiscard]] inline bool is_open() const {
+        return entries_ != nullptr;
+    }
+
+    [[nodiscard]] inline int64_t slots() const {
+        return slots_;
+    }
+
+ private:
+    SharedBookEntry* Bucket(std::string_view code, uint64_t* code_hash);
+    // 加锁成功返回true，槽位被存活的进程锁住超过自旋上限时返回false
+    bool Lock(SharedBookEntry* entry, uint64_t* seq);
+    static void Unlock(SharedBookEntry* entry, uint64_t seq);
+    void ReleaseOwned();
+
+ private:
+    int fd_ = -1;
+    void* addr_ = nullptr;
+    size_t size_ = 0;
+    int64_t slots_ = 0;
+    int64_t pid_ = 0;
+    int64_t serial_ = 0;
+    SharedBookEntry* entries_ = nullptr;
+};
+}  // namespace co
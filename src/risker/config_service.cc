@@ -0,0 +1,230 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <filesystem>
+#include <thread>
+#include "yaml-cpp/yaml.h"
+#include "x/x.h"
+#include "config_service.h"
+#include "common/instrument_dict.h"
+
+namespace co {
+ConfigService* ConfigService::Instance() {
+    static ConfigService* instance = new ConfigService();  // 不析构，监听线程由Unwatch停止
+    return instance;
+}
+
+std::shared_ptr<const BrokerConfig> ConfigService::Get() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (config_) {
+            return config_;
+        }
+    }
+    if (!Reload()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!config_) {
+            config_ = std::make_shared<BrokerConfig>();
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+bool ConfigService::Reload() {
+    try {
+        std::string filename;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            filename = config_ ? config_->filename : "";
+        }
+        if (filename.empty()) {
+            filename = x::FindFile("broker.yaml");
+        }
+        Publish(Parse(filename));
+        return true;
+    } catch (std::exception& e) {
+        LOG_ERROR << "[config] load broker.yaml failed: " << e.what();
+        return false;
+    }
+}
+
+void ConfigService::Publish(std::shared_ptr<BrokerConfig> config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config->version = version_.load() + 1;
+    config_ = config;
+    version_.store(config->version, std::memory_order_release);
+    LOG_INFO << "[config] publish config ok, version: " << config->version << ", file: " << config->filename;
+}
+
+void ConfigService::Watch() {
+    std::string filename = Get()->filename;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (watching_ || filename.empty()) {
+        return;
+    }
+    stop_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd_ < 0) {
+        LOG_ERROR << "[config] create eventfd failed: " << filename;
+        return;
+    }
+    watching_ = true;
+    watch_thread_ = std::thread(std::bind(&ConfigService::RunWatch, this, filename));
+}
+
+void ConfigService::Unwatch() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!watching_) {
+            return;
+        }
+        watching_ = false;
+    }
+    uint64_t value = 1;
+    if (write(stop_fd_, &value, sizeof(value)) != sizeof(value)) {
+        LOG_ERROR << "[config] notify watch thread failed";
+    }
+    if (watch_thread_.joinable()) {
+        watch_thread_.join();
+    }
+    close(stop_fd_);
+    stop_fd_ = -1;
+    LOG_INFO << "[config] stop watching config file";
+}
+
+void ConfigService::RunWatch(const std::string& filename) {
+    // 监听所在目录而不是文件本身，编辑器保存时可能先写临时文件再改名覆盖
+    std::filesystem::path path(filename);
+    std::string dir = path.has_parent_path() ? path.parent_path().string() : ".";
+    std::string name = path.filename().string();
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        LOG_ERROR << "[config] watch config file failed: " << filename;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    LOG_INFO << "[config] watch config file: " << filename;
+    alignas(struct inotify_event) char buffer[4096];
+    struct pollfd fds[2] = {{fd, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR << "[config] poll inotify event failed: " << filename;
+            break;
+        }
+        if (fds[1].revents) {  // Unwatch
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR << "[config] read inotify event failed: " << filename;
+            break;
+        }
+        bool changed = false;
+        for (char* p = buffer; p < buffer + n;) {
+            auto event = (struct inotify_event*)p;
+            if (event->len > 0 && name == event->name) {
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+        if (changed) {
+            Reload();
+        }
+    }
+    close(fd);
+}
+
+std::shared_ptr<BrokerConfig> ConfigService::Parse(const std::string& filename) {
+    auto getStr = [&](const YAML::Node& node, const std::string& name) {
+        try {
+            return node[name] && !node[name].IsNull() ? node[name].as<std::string>() : "";
+        } catch (std::exception& e) {
+            LOG_ERROR << "load configuration failed: name = " << name << ", error = " << e.what();
+            throw std::runtime_error(e.what());
+        }
+    };
+    auto getBool = [&](const YAML::Node& node, const std::string& name) {
+        try {
+            return node[name] && !node[name].IsNull() ? node[name].as<bool>() : false;
+        } catch (std::exception& e) {
+            LOG_ERROR << "load configuration failed: name = " << name << ", error = " << e.what();
+            throw std::runtime_error(e.what());
+        }
+    };
+    auto getInt = [&](const YAML::Node& node, const std::string& name, const int64_t& default_value = 0) {
+        try {
+            return node[name] && !node[name].IsNull() ? node[name].as<int64_t>() : default_value;
+        } catch (std::exception& e) {
+            LOG_ERROR << "load configuration failed: name = " << name << ", error = " << e.what();
+            throw std::runtime_error(e.what());
+        }
+    };
+    auto config = std::make_shared<BrokerConfig>();
+    config->filename = filename;
+    YAML::Node root = YAML::LoadFile(filename);
+    auto broker = root["broker"];
+    config->mem_dir = getStr(broker, "mem_dir");
+    config->mem_rep_file = getStr(broker, "mem_rep_file");
+    auto flow_control = broker["flow_control"];
+    if (flow_control && !flow_control.IsNull()) {
+        for (auto fc : flow_control) {
+            std::string suffix = getStr(fc, "market");
+            FlowControlLimit limit;
+            limit.market = co::SuffixToMarket(suffix);
+            if (limit.market <= 0) {
+                throw std::runtime_error("illegal market suffix: " + suffix);
+            }
+            limit.th_tps_limit = getInt(fc, "th_tps_limit");
+            limit.th_daily_warning = getInt(fc, "th_daily_warning");
+            limit.th_daily_limit = getInt(fc, "th_daily_limit");
+            if (limit.th_daily_warning > 0 && limit.th_tps_limit >= limit.th_daily_warning) {
+                throw std::invalid_argument("flow control config error, th_tps_limit >= th_daily_warning");
+            }
+            if (limit.th_daily_limit > 0 && limit.th_daily_warning >= limit.th_daily_limit) {
+                throw std::invalid_argument("flow control config error, th_daily_warning >= th_daily_limit");
+            }
+            config->flow_controls.push_back(limit);
+        }
+    }
+    auto cffex = root["cffex"];
+    config->cffex.forbid_closing_today = getBool(cffex, "forbid_closing_today");
+    config->cffex.max_today_opening_volume = getInt(cffex, "max_today_opening_volume");
+    auto product_limits = cffex["product_limits"];
+    if (product_limits && !product_limits.IsNull()) {
+        for (auto it : product_limits) {
+            std::string product = it.first.as<std::string>();
+            if (product.empty() || product.size() >= sizeof(Instrument::product)) {
+                throw std::runtime_error("illegal cffex product: " + product);
+            }
+            config->cffex.product_limits[product] = it.second.as<int64_t>();
+        }
+    }
+    auto risk = root["risk"];
+    config->feeder_dir = getStr(risk, "feeder_dir");
+    config->enable_shared_book = getBool(risk, "enable_shared_book");
+    config->shared_book_slots = getInt(risk, "shared_book_slots", 16);
+    if (config->shared_book_slots <= 0) {
+        throw std::runtime_error("illegal risk.shared_book_slots: " + std::to_string(config->shared_book_slots));
+    }
+    config->enable_tick = getBool(risk, "enable_tick");
+    config->tick_batch_size = getInt(risk, "tick_batch_size", 1000);
+    if (config->tick_batch_size <= 0) {
+        config->tick_batch_size = 1000;
+    }
+    config->risk_accounts = RiskOptions::Load(filename);
+    return config;
+}
+}  // namespace co
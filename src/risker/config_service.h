@@ -0,0 +1,112 @@
+// Copyright 2025 Fancapital Inc.  All rights reserved.
+#pragma once
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "risk_options.h"
+
+namespace co {
+// 股指期货自动开平仓参数
+struct CffexConfig {
+    bool forbid_closing_today = false;  // 禁止股指期货自动开平仓时平今仓
+    int64_t max_today_opening_volume = 0;  // 股指期货当日最大开仓数，-1-不限制
+    std::map<std::string, int64_t, std::less<>> product_limits;  // 中金所品种 -> 当日最大开仓数，优先于max_today_opening_volume
+};
+
+// 单个市场的流控阈值
+struct FlowControlLimit {
+    int64_t market = 0;
+    int64_t th_tps_limit = 0;
+    int64_t th_daily_warning = 0;
+    int64_t th_daily_limit = 0;
+};
+
+/**
+ * broker.yaml的只读快照，解析一次后不再修改；配置文件变化时整体替换为新的快照。
+ * 共享内存目录等启动参数在运行时修改不生效，只有限额类参数会被各组件重新读取。
+ */
+struct BrokerConfig {
+    int64_t version = 0;  // 每发布一个新快照加1
+    std::string filename;
+
+    std::string mem_dir;
+    std::string mem_rep_file;
+
+    std::vector<FlowControlLimit> flow_controls;
+    CffexConfig cffex;
+
+    std::string feeder_dir;
+    bool enable_shared_book = false;
+    int64_t shared_book_slots = 16;  // 共享挂单表每个桶的槽位数，创建文件时确定
+    bool enable_tick = false;
+    int64_t tick_batch_size = 1000;
+    std::vector<std::shared_ptr<RiskOptions>> risk_accounts;
+};
+
+/**
+ * 配置服务：进程内只解析一次broker.yaml，通过inotify监听配置文件，文件变化后解析成新的快照并原子替换，
+ * 解析失败时保留原快照。热点组件只比较版本号，版本变化后才取新的快照，在两条消息之间生效，不需要重启。
+ */
+class ConfigService {
+ public:
+    static ConfigService* Instance();
+
+    // 当前快照，第一次调用时加载配置文件，找不到配置文件时返回默认配置
+    std::shared_ptr<const BrokerConfig> Get();
+
+    [[nodiscard]] inline int64_t version() const {
+        return version_.load(std::memory_order_acquire);
+    }
+
+    // 重新解析配置文件并发布新的快照，返回是否成功
+    bool Reload();
+    void Publish(std::shared_ptr<BrokerConfig> config);
+    // 启动监听线程，只启动一次
+    void Watch();
+    // 停止监听线程并等待退出
+    void Unwatch();
+
+    static std::shared_ptr<BrokerConfig> Parse(const std::string& filename);
+
+ private:
+    ConfigService() = default;
+    void RunWatch(const std::string& filename);
+
+ private:
+    std::mutex mutex_;
+    std::shared_ptr<const BrokerConfig> config_;
+    std::atomic<int64_t> version_ = 0;
+    bool watching_ = false;
+    std::thread watch_thread_;
+    int stop_fd_ = -1;  // 通知监听线程退出的eventfd
+};
+
+// 组件持有的配置快照，使用前调用Refresh，只有版本变化时才重新获取
+class ConfigSnapshot {
+ public:
+    // 返回快照是否有变化，第一次调用总是返回true
+    bool Refresh() {
+        ConfigService* service = ConfigService::Instance();
+        if (config_ && config_->version == service->version()) {
+            return false;
+        }
+        config_ = service->Get();
+        return true;
+    }
+
+    inline const BrokerConfig* operator->() const {
+        return config_.get();
+    }
+
+    inline const BrokerConfig& operator*() const {
+        return *config_;
+    }
+
+ private:
+    std::shared_ptr<const BrokerConfig> config_;
+};
+}  // namespace co
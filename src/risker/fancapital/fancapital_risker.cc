@@ -1,4 +1,6 @@
 // Copyright 2025 Fancapital Inc.  All rights reserved.
+#include <algorithm>
+#include <cstring>
 #include <utility>
 #include <functional>
 #include "yaml-cpp/yaml.h"
@@ -7,28 +9,438 @@
 
 namespace co {
 
+    FancapitalRiskRules FancapitalRisker::CompileRules(const RiskOptions& opt) {
+        FancapitalRiskRules rules;
+        // 配置值小于等于0表示不限制
+        auto limit = [&](const std::string& name, double* value) {
+            double v = opt.GetFloat64(name);
+            if (v > 0) {
+                *value = v;
+            }
+        };
+        limit("max_order_volume", &rules.max_order_volume);
+        limit("max_order_amount", &rules.max_order_amount);
+        limit("min_order_price", &rules.min_order_price);
+        limit("max_order_price", &rules.max_order_price);
+        limit("withdraw_ratio", &rules.withdraw_ratio);
+        limit("knock_ratio", &rules.knock_ratio);
+        limit("failure_ratio", &rules.failure_ratio);
+        int64_t window_seconds = opt.GetInt64("ratio_window_seconds");
+        if (window_seconds > 0) {
+            rules.ratio_window_ms = window_seconds * 1000;
+        }
+        int64_t min_orders = opt.GetInt64("ratio_min_orders");
+        if (min_orders > 0) {
+            rules.ratio_min_orders = min_orders;
+        }
+        rules.ratio_by_code = opt.GetBool("ratio_by_code");
+        if (rules.min_order_price > rules.max_order_price) {
+            throw std::invalid_argument("[FAN-RISK-ERROR] min_order_price is greater than max_order_price: " + opt.fund_id());
+        }
+        return rules;
+    }
+
     void FancapitalRisker::Init(std::shared_ptr<RiskOptions> opt) {
-        LOG_INFO << "[risk][fancapital] init ok: options = " << opt->data();
-    }
-//
-//    void FancapitalRisker::HandleTradeOrderReq(MemTradeOrderMessage* req, std::string* error) {
-//
-//    }
-//
-//    void FancapitalRisker::HandleTradeOrderRep(const co::fbs::TradeOrderMessage* rep) {
-//
-//    }
-//
-//    void FancapitalRisker::HandleTradeWithdrawReq(MemTradeWithdrawMessage* req, std::string* error) {
-//
-//    }
-//
-//    void FancapitalRisker::HandleTradeWithdrawRep(const co::fbs::TradeWithdrawMessage* rep) {
-//
-//    }
-//
-//    void FancapitalRisker::OnTradeKnock(const co::fbs::TradeKnock* knock) {
-//
-//    }
+        rules_ = CompileRules(*opt);
+        ratio_enabled_ = rules_.withdraw_ratio > 0 || rules_.knock_ratio > 0 || rules_.failure_ratio > 0;
+        fund_counter_ = RollingRatioCounter(rules_.ratio_window_ms);
+        tag_ = "[" + opt->fund_id() + "-" + opt->GetStr("name") + "]";
+        LOG_INFO << "[risk][fancapital] init ok: options = " << opt->data()
+                 << ", max_order_volume: " << rules_.max_order_volume
+                 << ", max_order_amount: " << rules_.max_order_amount
+                 << ", min_order_price: " << rules_.min_order_price
+                 << ", max_order_price: " << rules_.max_order_price
+                 << ", withdraw_ratio: " << rules_.withdraw_ratio
+                 << ", knock_ratio: " << rules_.knock_ratio
+                 << ", failure_ratio: " << rules_.failure_ratio
+                 << ", ratio_window_ms: " << rules_.ratio_window_ms
+                 << ", ratio_min_orders: " << rules_.ratio_min_orders
+                 << ", ratio_by_code: " << (rules_.ratio_by_code ? "true" : "false");
+    }
+
+    void FancapitalRisker::UpdateRules(const RiskOptions& opt) {
+        FancapitalRiskRules rules = CompileRules(opt);
+        if (rules.ratio_window_ms != rules_.ratio_window_ms) {
+            fund_counter_ = RollingRatioCounter(rules.ratio_window_ms);
+            for (auto& counter : code_counters_) {
+                counter = RollingRatioCounter(rules.ratio_window_ms);
+            }
+        }
+        rules_ = rules;
+        ratio_enabled_ = rules_.withdraw_ratio > 0 || rules_.knock_ratio > 0 || rules_.failure_ratio > 0;
+        LOG_INFO << "[risk][fancapital] update rules ok: " << tag_ << ", options = " << opt.data();
+    }
+
+    std::string FancapitalRisker::HandleTradeOrderReq(MemTradeOrderMessage* req) {
+        const FancapitalRiskRules& rules = rules_;
+        MemTradeOrder* items = req->items;
+        for (int i = 0; i < req->items_size; i++) {
+            MemTradeOrder* order = items + i;
+            double volume = static_cast<double>(order->volume);
+            double price = order->price;
+            // 先合并所有规则的检查结果，只有不通过时才逐条确认原因；市价委托的价格为0，不检查价格区间
+            bool limit = order->price_type == kQOrderTypeLimit;
+            bool bad = (volume > rules.max_order_volume) | (price * volume > rules.max_order_amount) |
+                (limit & ((price < rules.min_order_price) | (price > rules.max_order_price)));
+            if (bad) {
+                if (volume > rules.max_order_volume) {
+                    return CreateError(order, "单笔委托数量超限", rules.max_order_volume);
+                } else if (price * volume > rules.max_order_amount) {
+                    return CreateError(order, "单笔委托金额超限", rules.max_order_amount);
+                } else if (price < rules.min_order_price) {
+                    return CreateError(order, "委托价格低于下限", rules.min_order_price);
+                } else {
+                    return CreateError(order, "委托价格高于上限", rules.max_order_price);
+                }
+            }
+        }
+        if (ratio_enabled_) {
+            int64_t now = x::UnixMilli();
+            std::string error = CheckRatio(fund_counter_.Counts(now), nullptr);
+            if (!error.empty()) {
+                return error;
+            }
+            if (rules.ratio_by_code) {
+                for (int i = 0; i < req->items_size; i++) {
+                    int32_t id = codes_.Find(items[i].code);
+                    if (id >= 0 && id < (int32_t)code_counters_.size()) {
+                        error = CheckRatio(code_counters_[id].Counts(now), items[i].code);
+                        if (!error.empty()) {
+                            return error;
+                        }
+                    }
+                }
+            }
+        }
+        return "";
+    }
+
+    std::string FancapitalRisker::CheckRatio(const RatioCounts& counts, const char* code) {
+        // 样本太少时比例没有意义，不检查
+        if (counts.orders < rules_.ratio_min_orders) {
+            return "";
+        }
+        double orders = static_cast<double>(counts.orders);
+        const char* rule = nullptr;
+        double limit = 0;
+        double value = 0;
+        if (rules_.withdraw_ratio > 0 && counts.withdraws > rules_.withdraw_ratio * orders) {
+            rule = "撤单比例超限";
+            limit = rules_.withdraw_ratio;
+            value = counts.withdraws / orders;
+        } else if (rules_.failure_ratio > 0 && counts.failures > rules_.failure_ratio * orders) {
+            rule = "废单比例超限";
+            limit = rules_.failure_ratio;
+            value = counts.failures / orders;
+        } else if (rules_.knock_ratio > 0 && counts.knocks < rules_.knock_ratio * orders) {
+            rule = "成交比例过低";
+            limit = rules_.knock_ratio;
+            value = counts.knocks / orders;
+        } else {
+            return "";
+        }
+        std::stringstream ss;
+        ss << "[FAN-RISK-ERROR][" << rule << "]风控检查失败：" << tag_;
+        if (code) {
+            ss << "[" << code << "]";
+        }
+        ss << " orders: " << counts.orders
+           << ", withdraws: " << counts.withdraws
+           << ", failures: " << counts.failures
+           << ", knocks: " << counts.knocks
+           << ", ratio: " << value
+           << ", limit: " << limit;
+        return ss.str();
+    }
+
+    RollingRatioCounter* FancapitalRisker::GetCodeCounter(int32_t code) {
+        while (code >= (int32_t)code_counters_.size()) {
+            code_counters_.emplace_back(rules_.ratio_window_ms);
+        }
+        return &code_counters_[code];
+    }
+
+    int32_t FancapitalRisker::FindOrder(const char* order_no) {
+        const int32_t* index = order_index_.Find(MixHash(HashBytes(order_no)), [&](int32_t v) {
+            return strcmp(orders_[v].order_no, order_no) == 0;
+        });
+        return index ? *index : -1;
+    }
+
+    int32_t FancapitalRisker::TrackOrder(const char* order_no, int64_t now) {
+        int32_t index = FindOrder(order_no);
+        if (index >= 0) {
+            orders_[index].timestamp = now;
+            return index;
+        }
+        if (!free_orders_.empty()) {
+            index = free_orders_.back();
+            free_orders_.pop_back();
+            orders_[index] = FancapitalOrder();
+        } else {
+            index = (int32_t)orders_.size();
+            orders_.emplace_back();
+        }
+        strncpy(orders_[index].order_no, order_no, sizeof(orders_[index].order_no) - 1);
+        orders_[index].timestamp = now;
+        order_index_.Insert(MixHash(HashBytes(order_no)), index);
+        return index;
+    }
+
+    int32_t FancapitalRisker::TrackBatch(const char* batch_no) {
+        uint64_t key = MixHash(HashBytes(batch_no));
+        const int32_t* found = batch_index_.Find(key, [&](int32_t v) { return batches_[v].batch_no == batch_no; });
+        if (found) {
+            return *found;
+        }
+        int32_t index = 0;
+        if (!free_batches_.empty()) {
+            index = free_batches_.back();
+            free_batches_.pop_back();
+        } else {
+            index = (int32_t)batches_.size();
+            batches_.emplace_back();
+        }
+        FancapitalBatch& batch = batches_[index];
+        batch.batch_no = batch_no;
+        batch.orders.clear();
+        batch.live = 0;
+        batch_index_.Insert(key, index);
+        return index;
+    }
+
+    void FancapitalRisker::CountWithdraw(int32_t index, int64_t now) {
+        FancapitalOrder& order = orders_[index];
+        order.timestamp = now;
+        if (order.withdrawn) {
+            return;
+        }
+        order.withdrawn = true;
+        fund_counter_.AddWithdraw(now);
+        if (rules_.ratio_by_code && order.code >= 0) {
+            GetCodeCounter(order.code)->AddWithdraw(now);
+        }
+    }
+
+    void FancapitalRisker::FinishOrder(int32_t index) {
+        FancapitalOrder& order = orders_[index];
+        order_index_.Erase(MixHash(HashBytes(order.order_no)), [&](int32_t v) { return v == index; });
+        if (order.batch >= 0) {
+            int32_t b = order.batch;
+            FancapitalBatch& batch = batches_[b];
+            if (--batch.live <= 0) {
+                batch_index_.Erase(MixHash(HashBytes(batch.batch_no)), [&](int32_t v) { return v == b; });
+                free_batches_.emplace_back(b);
+            }
+        }
+        order.order_no[0] = '\0';
+        free_orders_.emplace_back(index);
+    }
+
+    int32_t FancapitalRisker::FindRequest(const char* id) {
+        const int32_t* index = request_index_.Find(MixHash(HashBytes(id)), [&](int32_t v) {
+            return requests_[v].id == id;
+        });
+        return index ? *index : -1;
+    }
+
+    void FancapitalRisker::FinishRequest(int32_t index) {
+        FancapitalRequest& req = requests_[index];
+        request_index_.Erase(MixHash(HashBytes(req.id.c_str())), [&](int32_t v) { return v == index; });
+        req.id.clear();
+        free_requests_.emplace_back(index);
+    }
+
+    void FancapitalRisker::Evict(int64_t now) {
+        // 响应丢失的请求和收不到结束回报的委托不能一直占用槽位，每个统计窗口清理一次
+        if (now < next_evict_ms_) {
+            return;
+        }
+        next_evict_ms_ = now + rules_.ratio_window_ms;
+        int64_t expire = now - rules_.ratio_window_ms;
+        for (int32_t i = 0; i < (int32_t)requests_.size(); i++) {
+            if (!requests_[i].id.empty() && requests_[i].timestamp < expire) {
+                FinishRequest(i);
+            }
+        }
+        for (int32_t i = 0; i < (int32_t)orders_.size(); i++) {
+            if (orders_[i].order_no[0] != '\0' && orders_[i].timestamp < expire) {
+                FinishOrder(i);
+            }
+        }
+    }
+
+    void FancapitalRisker::OnTradeOrderReqPass(MemTradeOrderMessage* req) {
+        if (!ratio_enabled_) {
+            return;
+        }
+        int64_t now = x::UnixMilli();
+        Evict(now);
+        if (FindRequest(req->id) >= 0) {
+            return;
+        }
+        int32_t index = 0;
+        if (!free_requests_.empty()) {
+            index = free_requests_.back();
+            free_requests_.pop_back();
+        } else {
+            index = (int32_t)requests_.size();
+            requests_.emplace_back();
+        }
+        requests_[index].id = req->id;
+        requests_[index].timestamp = now;
+        requests_[index].items = req->items_size;
+        request_index_.Insert(MixHash(HashBytes(req->id)), index);
+    }
+
+    void FancapitalRisker::HandleTradeOrderRep(MemTradeOrderMessage* rep) {
+        // 只统计本风控检查通过的请求：风控拒单重试时如果也计为废单，比例超限后会一直拒单
+        if (!ratio_enabled_) {
+            return;
+        }
+        int32_t req = FindRequest(rep->id);
+        if (req < 0) {
+            return;
+        }
+        requests_[req].items -= rep->items_size;
+        if (requests_[req].items <= 0) {
+            FinishRequest(req);
+        }
+        // 流控、超时等本进程生成的拒单没有报到柜台，没有合同号的委托不计数
+        bool local = strncmp(rep->error, "[FAN-", 5) == 0;
+        int64_t now = x::UnixMilli();
+        int64_t orders = 0;
+        int64_t failures = 0;
+        int32_t batch = -1;
+        bool knock_first = false;
+        for (int i = 0; i < rep->items_size; i++) {
+            MemTradeOrder* item = rep->items + i;
+            bool failed = item->order_no[0] == '\0';
+            if (failed && local) {
+                continue;
+            }
+            ++orders;
+            failures += failed;
+            int32_t code = -1;
+            if (rules_.ratio_by_code) {
+                code = codes_.Intern(item->code);
+                GetCodeCounter(code)->AddOrder(now, 1, failed);
+            }
+            if (failed) {
+                continue;
+            }
+            int32_t index = TrackOrder(item->order_no, now);
+            FancapitalOrder& order = orders_[index];
+            if (order.volume > 0) {  // 重复的委托响应
+                continue;
+            }
+            order.code = code;
+            order.volume = item->volume;
+            knock_first |= order.done_volume > 0;
+            if (rep->batch_no[0] != '\0') {
+                if (batch < 0) {
+                    batch = TrackBatch(rep->batch_no);
+                }
+                order.batch = batch;
+                batches_[batch].orders.emplace_back(index);
+                ++batches_[batch].live;
+            }
+        }
+        if (orders > 0) {
+            fund_counter_.AddOrder(now, orders, failures);
+        }
+        if (knock_first) {  // 先收到的成交回报可能已经全部成交
+            for (int i = 0; i < rep->items_size; i++) {
+                int32_t index = rep->items[i].order_no[0] != '\0' ? FindOrder(rep->items[i].order_no) : -1;
+                if (index >= 0 && orders_[index].done_volume >= orders_[index].volume) {
+                    FinishOrder(index);
+                }
+            }
+        }
+    }
+
+    void FancapitalRisker::HandleTradeWithdrawRep(MemTradeWithdrawMessage* rep) {
+        // 按撤单的委托笔数计数，批量撤单计入批次内所有未撤单的委托；没有跟踪的委托（如重启前的委托）按1笔计
+        if (!ratio_enabled_ || rep->error[0] != '\0') {
+            return;
+        }
+        int64_t now = x::UnixMilli();
+        if (rep->order_no[0] != '\0') {
+            int32_t index = FindOrder(rep->order_no);
+            if (index >= 0) {
+                CountWithdraw(index, now);
+                return;
+            }
+        } else if (rep->batch_no[0] != '\0') {
+            const int32_t* found = batch_index_.Find(MixHash(HashBytes(rep->batch_no)), [&](int32_t v) {
+                return batches_[v].batch_no == rep->batch_no;
+            });
+            if (found) {
+                int32_t b = *found;
+                for (int32_t index : batches_[b].orders) {
+                    if (orders_[index].batch == b && orders_[index].order_no[0] != '\0') {
+                        CountWithdraw(index, now);
+                    }
+                }
+                return;
+            }
+        }
+        fund_counter_.AddWithdraw(now);
+    }
+
+    void FancapitalRisker::OnTradeKnock(MemTradeKnock* knock) {
+        // 成交笔数按委托计数，只在委托第一次成交时累加；撤单完成和废单的回报用于结束跟踪
+        if (!ratio_enabled_) {
+            return;
+        }
+        int64_t match_type = knock->match_type;
+        if (knock->order_no[0] == '\0') {
+            if (match_type == kMatchTypeOK) {
+                int64_t now = x::UnixMilli();
+                fund_counter_.AddKnock(now);
+                if (rules_.ratio_by_code) {
+                    GetCodeCounter(codes_.Intern(knock->code))->AddKnock(now);
+                }
+            }
+            return;
+        }
+        int64_t now = x::UnixMilli();
+        int32_t index = match_type == kMatchTypeOK ? TrackOrder(knock->order_no, now) : FindOrder(knock->order_no);
+        if (index < 0) {
+            return;
+        }
+        FancapitalOrder& order = orders_[index];
+        order.timestamp = now;
+        if (match_type == kMatchTypeOK) {
+            if (!order.knocked) {
+                order.knocked = true;
+                fund_counter_.AddKnock(now);
+                if (rules_.ratio_by_code) {
+                    if (order.code < 0) {
+                        order.code = codes_.Intern(knock->code);
+                    }
+                    GetCodeCounter(order.code)->AddKnock(now);
+                }
+            }
+            order.done_volume += knock->match_volume;
+        } else if (match_type == kMatchTypeWithdrawOK) {
+            order.done_volume += knock->match_volume;
+        } else if (match_type == kMatchTypeFailed) {
+            order.done_volume = std::max(order.volume, order.done_volume);
+        }
+        if (order.volume > 0 && order.done_volume >= order.volume) {
+            FinishOrder(index);
+        }
+    }
+
+    std::string FancapitalRisker::CreateError(MemTradeOrder* order, const char* rule, double limit) {
+        std::stringstream ss;
+        ss << "[FAN-RISK-ERROR][" << rule << "]风控检查失败：" << tag_
+           << "[" << order->code << "]"
+           << " price: " << order->price
+           << ", volume: " << order->volume
+           << ", limit: " << limit;
+        return ss.str();
+    }
 
 }   // namespace co
\ No newline at end of file
@@ -3,11 +3,61 @@
 #include <vector>
 #include <string>
 #include <memory>
-#include <unordered_map>
+#include <limits>
 #include "../base_risker.h"
+#include "../common/hash_index.h"
+#include "../common/ratio_counter.h"
 
 namespace co {
 
+    /**
+     * 账户风控规则，Init时由RiskOptions的JSON配置编译而来，检查时不再查找JSON；
+     * 未配置的限额取不会触发的边界值，逐笔检查时不需要判断是否配置。
+     * 价格上下限是账户级的绝对区间，对所有代码生效，用于拦截价格多写一位等明显的错价，不是相对参考价的价格笼子：
+     * 风控线程只读取有挂单代码的行情，也没有昨收价的来源，按参考价的涨跌幅检查由柜台和交易所的价格笼子负责。
+     */
+    struct FancapitalRiskRules {
+        double max_order_volume = std::numeric_limits<double>::infinity();  // 单笔委托最大数量
+        double max_order_amount = std::numeric_limits<double>::infinity();  // 单笔委托最大金额
+        double min_order_price = -std::numeric_limits<double>::infinity();  // 委托价格绝对下限，所有代码共用
+        double max_order_price = std::numeric_limits<double>::infinity();  // 委托价格绝对上限，所有代码共用
+        double withdraw_ratio = 0;  // 撤单比例上限，0-不检查
+        double knock_ratio = 0;  // 成交比例下限，0-不检查
+        double failure_ratio = 0;  // 废单比例上限，0-不检查
+        int64_t ratio_window_ms = 60000;  // 比例统计的滑动窗口长度
+        int64_t ratio_min_orders = 100;  // 窗口内委托笔数达到该值后才检查比例
+        bool ratio_by_code = false;  // 是否同时按证券代码检查比例
+    };
+
+    /**
+     * 比例统计中跟踪的委托：撤单和成交按委托去重，委托结束（全部成交、撤单完成或废单）后删除，槽位复用；
+     * 超过统计窗口没有任何回报的委托也删除，之后的回报按没有跟踪的委托计数
+     */
+    struct FancapitalOrder {
+        char order_no[64] = "";  // 空表示槽位空闲
+        int32_t code = -1;  // 证券代码编号，只在按代码统计时记录
+        int32_t batch = -1;  // 所属批次在batches_中的下标，-1表示单笔委托
+        int64_t volume = 0;  // 委托数量，0表示还没有收到委托响应（先收到成交回报）
+        int64_t done_volume = 0;  // 已成交和已撤单的数量
+        bool knocked = false;  // 是否已计入成交笔数
+        bool withdrawn = false;  // 是否已计入撤单笔数
+        int64_t timestamp = 0;  // 最近一次收到回报的时间
+    };
+
+    // 检查通过、等待委托响应的请求，只有这些请求的响应计入委托笔数和废单笔数
+    struct FancapitalRequest {
+        std::string id;  // 空表示槽位空闲
+        int64_t timestamp = 0;  // 检查通过的时间，超过统计窗口仍没有响应时删除
+        int64_t items = 0;  // 还没有收到响应的委托个数，拆分篮子到期后的响应可能分多次返回
+    };
+
+    // 比例统计中跟踪的批次，批量撤单按批次内未撤单的委托计数
+    struct FancapitalBatch {
+        std::string batch_no;
+        std::vector<int32_t> orders;  // 批次内的委托在orders_中的下标
+        int64_t live = 0;  // 未结束的委托个数，为0时删除
+    };
+
     /**
      * 平凡投资风控
      */
@@ -18,38 +68,95 @@ namespace co {
             * @param opts: 每个资金账号一个配置，data字段为JSON字符串，其具体内容由底层实现来定义；
             */
         virtual void Init(std::shared_ptr<RiskOptions> opt);
-//
-//        /**
-//            * 处理委托请求，如果风控检查失败则返回错误信息，检查通过返回空字符串；
-//            * @params req: 委托请求消息
-//            * @return 错误信息
-//            */
-//        virtual void HandleTradeOrderReq(MemTradeOrderMessage* req, std::string* error);
-//
-//        /**
-//            * 处理委托响应
-//            * @params rep: 委托响应消息
-//            */
-//        virtual void HandleTradeOrderRep(const co::fbs::TradeOrderMessage* rep);
-//
-//        /**
-//            * 处理撤单请求，如果风控检查失败则返回错误信息，检查通过返回空字符串；
-//            * @params req: 撤单请求消息
-//            * @return 错误信息
-//            */
-//        virtual void HandleTradeWithdrawReq(MemTradeWithdrawMessage* req, std::string* error);
-//
-//        /**
-//            * 处理撤单响应
-//            * @params rep: 撤单响应消息
-//            */
-//        virtual void HandleTradeWithdrawRep(const co::fbs::TradeWithdrawMessage* rep);
-//
-//        /**
-//            * 处理成交回报
-//            * @params knock: 成交回报
-//            */
-//        virtual void OnTradeKnock(const co::fbs::TradeKnock* knock);
 
+        /**
+            * 处理委托请求，如果风控检查失败则返回错误信息，检查通过返回空字符串；
+            * @params req: 委托请求消息
+            * @return 错误信息
+            */
+        virtual std::string HandleTradeOrderReq(MemTradeOrderMessage* req);
+
+        /**
+            * 委托请求检查通过，记录等待响应的请求
+            * @params req: 委托请求消息
+            */
+        virtual void OnTradeOrderReqPass(MemTradeOrderMessage* req);
+
+        /**
+            * 处理委托响应，累计委托笔数和废单笔数；风控、流控等本进程生成的拒单响应不计数
+            * @params rep: 委托响应消息
+            */
+        virtual void HandleTradeOrderRep(MemTradeOrderMessage* rep);
+
+        /**
+            * 处理撤单响应，累计撤单成功笔数
+            * @params rep: 撤单响应消息
+            */
+        virtual void HandleTradeWithdrawRep(MemTradeWithdrawMessage* rep);
+
+        /**
+            * 处理成交回报，累计成交笔数
+            * @params knock: 成交回报
+            */
+        virtual void OnTradeKnock(MemTradeKnock* knock);
+
+        static FancapitalRiskRules CompileRules(const RiskOptions& opt);
+
+        /**
+            * 运行时更新规则，配置错误时抛出异常并保留原规则；比例统计窗口变化时重新计数
+            * @param opt: 新的配置
+            */
+        void UpdateRules(const RiskOptions& opt);
+
+        [[nodiscard]] inline const FancapitalRiskRules& rules() const {
+            return rules_;
+        }
+
+        // 跟踪中（未结束）的委托个数
+        [[nodiscard]] inline size_t tracked_orders() const {
+            return order_index_.size();
+        }
+
+        // 等待响应的请求个数
+        [[nodiscard]] inline size_t pending_requests() const {
+            return request_index_.size();
+        }
+
+        // 窗口内的资金账号计数
+        const RatioCounts& counts(int64_t now) {
+            return fund_counter_.Counts(now);
+        }
+
+    private:
+        std::string CreateError(MemTradeOrder* order, const char* rule, double limit);
+        std::string CheckRatio(const RatioCounts& counts, const char* code);
+        RollingRatioCounter* GetCodeCounter(int32_t code);
+        int32_t FindOrder(const char* order_no);
+        int32_t TrackOrder(const char* order_no, int64_t now);
+        int32_t TrackBatch(const char* batch_no);
+        void CountWithdraw(int32_t index, int64_t now);
+        void FinishOrder(int32_t index);
+        int32_t FindRequest(const char* id);
+        void FinishRequest(int32_t index);
+        void Evict(int64_t now);
+
+    private:
+        std::string tag_;
+        FancapitalRiskRules rules_;
+        bool ratio_enabled_ = false;
+        RollingRatioCounter fund_counter_;
+        StringInterner codes_;
+        std::vector<RollingRatioCounter> code_counters_;  // 下标为codes_的编号
+        // 跟踪中的委托和批次，撤单响应和成交回报中没有委托数量和批次信息；删除后下标放入空闲列表复用，不逐笔分配内存
+        std::vector<FancapitalOrder> orders_;
+        std::vector<int32_t> free_orders_;
+        HashIndex<int32_t> order_index_;  // 合同号 -> orders_下标
+        std::vector<FancapitalBatch> batches_;
+        std::vector<int32_t> free_batches_;
+        HashIndex<int32_t> batch_index_;  // 批次号 -> batches_下标
+        std::vector<FancapitalRequest> requests_;
+        std::vector<int32_t> free_requests_;
+        HashIndex<int32_t> request_index_;  // 请求id -> requests_下标
+        int64_t next_evict_ms_ = 0;  // 下次清理超时请求和委托的时间，每个统计窗口清理一次
     };
 }  // namespace co
\ No newline at end of file
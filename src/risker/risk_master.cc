@@ -1,9 +1,10 @@
 // Copyright 2025 Fancapital Inc.  All rights reserved.
 #include <unordered_map>
-#include "yaml-cpp/yaml.h"
 #include "coral/coral.h"
 #include "risk_master.h"
+#include "config_service.h"
 #include "common/anti_self_knock_risker.h"
+#include "common/exposure_risker.h"
 #include "fancapital/fancapital_risker.h"
 
 const char kRiskerFancapital[] = "fancapital";
@@ -23,10 +24,16 @@ class RiskMaster::RiskMasterImpl {
     void Run();
 
     std::vector<Risker*>* GetRiskers(const std::string& fund_id);
+    // 配置文件变化后，更新配置有变化的帐号的风控限额
+    void UpdateRiskLimits(const BrokerConfig& config);
 
     // fund_id -> [账户风控，公共风控1，公共风控2, ...]
     std::unordered_map<std::string, std::vector<Risker*>*> routes_;
     AntiSelfKnockRisker anti_risker_;
+    std::vector<std::unique_ptr<ExposureRisker>> exposure_riskers_;
+    std::unordered_map<std::string, FancapitalRisker*> fancapital_riskers_;  // fund_id -> 账户风控
+    std::unordered_map<std::string, ExposureRisker*> exposure_routes_;  // fund_id -> 敞口风控
+    std::unordered_map<std::string, std::string> risk_data_;  // fund_id -> 当前生效的风控配置
     StringQueue trade_queue_;
 
     std::atomic_int8_t async_state_ = 0;  // 0-空转，1-运行中，2-已结束
@@ -63,7 +70,9 @@ void RiskMaster::RiskMasterImpl::Init(const std::vector<std::shared_ptr<RiskOpti
 
         Risker* account_risker = nullptr;
         if (risker_id == kRiskerFancapital) {
-            account_risker = new FancapitalRisker();
+            auto fancapital_risker = new FancapitalRisker();
+            fancapital_riskers_[fund_id] = fancapital_risker;
+            account_risker = fancapital_risker;
         } else {
             LOG_INFO << "[risk] unknown risker_id: " << risker_id << ", fund_id: " << fund_id;
         }
@@ -74,6 +83,16 @@ void RiskMaster::RiskMasterImpl::Init(const std::vector<std::shared_ptr<RiskOpti
             riskers->push_back(account_risker);
         }
 
+        // 持仓和资金敞口风控，每个帐号一个
+        if (opt->GetBool("enable_exposure")) {
+            auto exposure_risker = std::make_unique<ExposureRisker>();
+            exposure_risker->Init(opt);
+            riskers->push_back(exposure_risker.get());
+            exposure_routes_[fund_id] = exposure_risker.get();
+            exposure_riskers_.emplace_back(std::move(exposure_risker));
+        }
+        risk_data_[fund_id] = opt->data();
+
         // 所有帐号共用防对敲
         bool enable_prevent_self_knock = opt->GetBool("enable_prevent_self_knock");
         if (enable_prevent_self_knock) {
@@ -90,33 +109,45 @@ void RiskMaster::RiskMasterImpl::Start() {
 
 void RiskMaster::RiskMasterImpl::Run() {
     try {
-        auto getStr = [&](const YAML::Node& node, const std::string& name) {
-            try {
-                return node[name] && !node[name].IsNull() ? node[name].as<std::string>() : "";
-            } catch (std::exception& e) {
-                LOG_ERROR << "load configuration failed: name = " << name << ", error = " << e.what();
-                throw std::runtime_error(e.what());
-            }
-        };
-
-        auto filename = x::FindFile("broker.yaml");
-        YAML::Node root = YAML::LoadFile(filename);
-        auto broker = root["broker"];
-        string mem_dir = getStr(broker, "mem_dir");
-        string mem_rep_file = getStr(broker, "mem_rep_file");
-        auto risk = root["risk"];
-        string feeder_dir = getStr(risk, "feeder_dir");
+        ConfigSnapshot config;
+        config.Refresh();
+        // 找不到broker.yaml时（单元测试、基准测试）使用默认配置，只做本broker的事前风控，不读取响应共享内存
+        bool enable_rep_reader = !config->filename.empty();
+        if (!enable_rep_reader) {
+            LOG_WARN << "[risk][master] broker.yaml not found, use default configuration";
+        }
+        string mem_dir = config->mem_dir;
+        string mem_rep_file = config->mem_rep_file;
+        string feeder_dir = config->feeder_dir;
+        bool enable_shared_book = config->enable_shared_book;
+        bool enable_tick = config->enable_tick;
+        int64_t tick_batch_size = config->tick_batch_size;
+        if (enable_shared_book) {
+            anti_risker_.EnableSharedBook(mem_dir + "/anti_self_knock_book", config->shared_book_slots);
+        }
         x::MMapReader reader;
-        // broker内，事前风控; 其它broker，事后风控
-        reader.Open(mem_dir, mem_rep_file, true);
-        // 机器上的broker多，暂时不加载行情
-        // reader.Open(feeder_dir, "data", true);
-        LOG_INFO << "[risk][master] load configuration ok";
+        // broker内，事前风控; 其它broker，事后风控；开启共享挂单表后，其它broker的挂单直接从共享挂单表中读取
+        if (enable_rep_reader) {
+            reader.Open(mem_dir, mem_rep_file, true);
+        }
+        // 机器上的broker多，默认不加载行情；开启后只处理有挂单的代码，每轮最多处理tick_batch_size条，不阻塞交易消息
+        x::MMapReader tick_reader;
+        if (enable_tick) {
+            tick_reader.Open(feeder_dir, "data", true);
+        }
+        LOG_INFO << "[risk][master] load configuration ok, enable_shared_book: " << std::boolalpha << enable_shared_book
+                 << ", enable_tick: " << enable_tick
+                 << ", tick_batch_size: " << tick_batch_size;
         string broker_fund;
         std::string raw;
         int64_t type = 0;
         const void* data = nullptr;
         while (true) {
+            anti_risker_.OnTimer(x::UnixMilli());
+            if (config.Refresh()) {  // 共享内存和行情的开关需要重启，只更新限额
+                tick_batch_size = config->tick_batch_size;
+                UpdateRiskLimits(*config);
+            }
             while (!trade_queue_.Empty()) {
                 type = trade_queue_.Pop(&raw);
                 if (type == 0) {
@@ -216,22 +247,41 @@ void RiskMaster::RiskMasterImpl::Run() {
                         }
                         break;
                     }
+                    case kMemTypeTradeAsset: {
+                        MemTradeAsset *asset = reinterpret_cast<MemTradeAsset*>(raw.data());
+                        auto riskers = GetRiskers(asset->fund_id);
+                        if (riskers) {
+                            for (auto& risker : *riskers) {
+                                risker->OnTradeAsset(asset);
+                            }
+                        }
+                        break;
+                    }
+                    case kMemTypeTradePosition: {
+                        MemTradePosition *position = reinterpret_cast<MemTradePosition*>(raw.data());
+                        auto riskers = GetRiskers(position->fund_id);
+                        if (riskers) {
+                            for (auto& risker : *riskers) {
+                                risker->OnTradePosition(position);
+                            }
+                        }
+                        break;
+                    }
+                    case kMemTypeQTickBody: {
+                        anti_risker_.OnTick(reinterpret_cast<MemQTickBody*>(raw.data()));
+                        break;
+                    }
                     default: {
                         break;
                     }
                 }
             }
-            while (true) {
+            while (enable_rep_reader) {
                 int32_t type = reader.Next(&data);
                 switch (type) {
-//                    case kMemTypeQTickBody : {
-//                        MemQTickBody *tick = (MemQTickBody *) data;
-//                        anti_risker_.OnTick(tick);
-//                        break;
-//                    }
                     case kMemTypeTradeOrderRep: {
-                        MemTradeOrderMessage *rep = reinterpret_cast<MemTradeOrderMessage*>(raw.data());
-                        if (broker_fund.compare(rep->fund_id) != 0) {
+                        MemTradeOrderMessage *rep = reinterpret_cast<MemTradeOrderMessage*>(const_cast<void*>(data));
+                        if (!enable_shared_book && broker_fund.compare(rep->fund_id) != 0) {
                             auto riskers = GetRiskers(rep->fund_id);
                             if (riskers) {
                                 for (auto& risker : *riskers) {
@@ -242,8 +292,8 @@ void RiskMaster::RiskMasterImpl::Run() {
                         break;
                     }
                     case kMemTypeTradeWithdrawRep: {
-                        MemTradeWithdrawMessage *rep = reinterpret_cast<MemTradeWithdrawMessage*>(raw.data());
-                        if (broker_fund.compare(rep->fund_id) != 0) {
+                        MemTradeWithdrawMessage *rep = reinterpret_cast<MemTradeWithdrawMessage*>(const_cast<void*>(data));
+                        if (!enable_shared_book && broker_fund.compare(rep->fund_id) != 0) {
                             auto riskers = GetRiskers(rep->fund_id);
                             if (riskers) {
                                 for (auto &risker : *riskers) {
@@ -254,8 +304,8 @@ void RiskMaster::RiskMasterImpl::Run() {
                         break;
                     }
                     case kMemTypeTradeKnock: {
-                        MemTradeKnock *knock = reinterpret_cast<MemTradeKnock*>(raw.data());
-                        if (broker_fund.compare(knock->fund_id) != 0) {
+                        MemTradeKnock *knock = reinterpret_cast<MemTradeKnock*>(const_cast<void*>(data));
+                        if (!enable_shared_book && broker_fund.compare(knock->fund_id) != 0) {
                             auto riskers = GetRiskers(knock->fund_id);
                             if (riskers) {
                                 for (auto &risker : *riskers) {
@@ -273,12 +323,44 @@ void RiskMaster::RiskMasterImpl::Run() {
                     break;
                 }
             }
+            if (enable_tick) {
+                for (int64_t i = 0; i < tick_batch_size; ++i) {
+                    int32_t type = tick_reader.Next(&data);
+                    if (type == 0) {
+                        break;
+                    }
+                    if (type == kMemTypeQTickBody) {
+                        anti_risker_.OnTick(reinterpret_cast<MemQTickBody*>(const_cast<void*>(data)));
+                    }
+                }
+            }
         }
     } catch (std::exception& e) {
         LOG_ERROR << "[risk][master] risk master is crashed: " << e.what();
     }
 }
 
+void RiskMaster::RiskMasterImpl::UpdateRiskLimits(const BrokerConfig& config) {
+    for (auto& opt : config.risk_accounts) {
+        std::string fund_id = opt->fund_id();
+        auto itr = risk_data_.find(fund_id);
+        if (opt->disabled() || itr == risk_data_.end() || itr->second == opt->data()) {
+            continue;
+        }
+        try {
+            if (auto risker = fancapital_riskers_.find(fund_id); risker != fancapital_riskers_.end()) {
+                risker->second->UpdateRules(*opt);
+            }
+            if (auto risker = exposure_routes_.find(fund_id); risker != exposure_routes_.end()) {
+                risker->second->UpdateLimits(*opt);
+            }
+            itr->second = opt->data();
+        } catch (std::exception& e) {
+            LOG_ERROR << "[risk][master] update risk limits failed, fund_id: " << fund_id << ", error: " << e.what();
+        }
+    }
+}
+
 std::vector<Risker*>* RiskMaster::RiskMasterImpl::GetRiskers(const std::string& fund_id) {
     std::vector<Risker*>* riskers = nullptr;
     auto itr = routes_.find(fund_id);
@@ -345,7 +427,16 @@ void RiskMaster::OnTradeKnock(MemTradeKnock* knock) {
     m_->trade_queue_.Push(kMemTypeTradeKnock, string(reinterpret_cast<const char *>(knock), sizeof(MemTradeKnock)));
 }
 
+void RiskMaster::OnTradeAsset(MemTradeAsset* asset) {
+    m_->trade_queue_.Push(kMemTypeTradeAsset, string(reinterpret_cast<const char *>(asset), sizeof(MemTradeAsset)));
+}
+
+void RiskMaster::OnTradePosition(MemTradePosition* position) {
+    m_->trade_queue_.Push(kMemTypeTradePosition, string(reinterpret_cast<const char *>(position), sizeof(MemTradePosition)));
+}
+
 void RiskMaster::OnTick(MemQTickBody* tick) {
-    m_->anti_risker_.OnTick(tick);
+    // 与行情共享内存中的行情一样由风控线程处理，不在调用方线程修改订单薄
+    m_->trade_queue_.Push(kMemTypeQTickBody, string(reinterpret_cast<const char *>(tick), sizeof(MemQTickBody)));
 }
 }  // namespace co
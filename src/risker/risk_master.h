@@ -25,6 +25,11 @@ class RiskMaster {
 
     void OnTradeKnock(MemTradeKnock* knock);
 
+    // 柜台的资金和持仓快照，用于持仓和资金敞口风控
+    void OnTradeAsset(MemTradeAsset* asset);
+
+    void OnTradePosition(MemTradePosition* position);
+
     void OnTick(MemQTickBody* tick);
 
  private: